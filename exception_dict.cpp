@@ -0,0 +1,70 @@
+#include "exception_dict.h"
+#include "sp0256.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+#include <ctype.h>
+
+
+
+//the allophone with this name (in any case), or -1
+int allophoneByName(const std::string& strName)
+{
+	for (int nIdx = 0; nIdx < SP0256_ALLOPHONES; ++nIdx)
+	{
+		if (strName.size() == strlen(g_apszSP0256Name[nIdx]) &&
+				std::equal(strName.begin(), strName.end(), g_apszSP0256Name[nIdx],
+				[](char a, char b) { return toupper((unsigned char)a) == b; }))
+			return nIdx;
+	}
+	return -1;
+}
+
+
+
+bool loadExceptionDict(const char* pszFile, MAP_EXCEPTIONS& dict, std::ostream& osErr)
+{
+	std::ifstream ifs(pszFile);
+	if (!ifs)
+	{
+		osErr << "can't read " << pszFile << std::endl;
+		return false;
+	}
+	bool bOK = true;
+	std::string strLine;
+	for (int nLine = 1; std::getline(ifs, strLine); ++nLine)
+	{
+		std::istringstream iss(strLine);
+		std::string strWord;
+		if (!(iss >> strWord) || '#' == strWord[0])
+			continue;
+		std::transform(strWord.begin(), strWord.end(), strWord.begin(), ::tolower);
+		VEC_BYTE phon;
+		std::string strName;
+		int nAllophone = 0;
+		while (nAllophone >= 0 && iss >> strName)
+		{
+			nAllophone = allophoneByName(strName);
+			if (nAllophone < 0)
+			{
+				osErr << pszFile << ":" << nLine << ": unknown allophone '" << strName << "'" << std::endl;
+				bOK = false;
+			}
+			phon.push_back((uint8_t)nAllophone);
+		}
+		if (nAllophone < 0)
+			continue;
+		if (phon.empty() || strWord.size() > 255 || phon.size() > 255)
+		{
+			osErr << pszFile << ":" << nLine << ": bad entry for '" << strWord << "'" << std::endl;
+			bOK = false;
+			continue;
+		}
+		if (dict.end() != dict.find(strWord))
+			osErr << pszFile << ":" << nLine << ": '" << strWord << "' again; using this one" << std::endl;
+		dict[strWord] = phon;
+	}
+	return bOK;
+}
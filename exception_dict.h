@@ -0,0 +1,18 @@
+#ifndef __EXCEPTION_DICT_H
+#define __EXCEPTION_DICT_H
+
+#include <ostream>
+
+#include "make_compact_ruleset.h"
+
+
+//read an exception dictionary for make_compact_ruleset.  Each line is a word
+//followed by its phonemes as SP0256 allophone names, e.g.
+//	colonel	KK1 ER1 NN1 EL
+//Blank lines, and those starting with '#', are ignored.  Words are
+//lower-cased.  Problems are reported to osErr (with the line number), and make
+//it return false.
+bool loadExceptionDict(const char* pszFile, MAP_EXCEPTIONS& dict, std::ostream& osErr);
+
+
+#endif
@@ -1,185 +1,970 @@
 #include "make_compact_ruleset.h"
 #include "tts_rules.h"
+#include "text_to_speech.h"
 
 #include <string>
 #include <map>
-#include <set>
+#include <unordered_map>
 #include <algorithm>
+#include <chrono>
+#include <string.h>
 
 
-typedef std::set<std::string>	SET_STR;
-typedef std::set<VEC_BYTE>	SET_BLOB;
-typedef std::map<std::string,size_t>	MAP_STR_OFFSET;
-typedef std::map<VEC_BYTE, size_t>	MAP_BLOB_OFFSET;
+typedef std::unordered_map<std::string, uint32_t>	MAP_STR_ID;
+typedef std::vector<uint32_t>	VEC_U32;
 
 
+//The compiler has to cope with rulesets far bigger than the 700-odd rules
+//of _rules (e.g. from dictionary-sized inputs), so nothing in it is worse than
+//n log n in the number of rules.  The strings and phoneme sequences are
+//interned by hash as the rules are read, once; after that, everything is done
+//by id, and the output is laid out in buffers of the size it is known to be.
+//(The blob is byte for byte what it was when this was done with std::set and
+//std::map, except that a packed one may refer to a different copy of a string
+//that is in the pool more than once.)
+
+
+//the deduped strings and phoneme sequences of a set of rules, and which of
+//them each rule uses.  Phoneme sequences are kept as bytes in a std::string
+//(which compares the same as a VEC_BYTE would), with the +1 already undone.
+struct InternedRules
+{
+	MAP_STR_ID	strids;
+	MAP_STR_ID	binids;
+	std::vector<const std::string*>	strs;	//by id (keys of strids)
+	std::vector<const std::string*>	bins;	//by id (keys of binids, or phon6)
+	VEC_U32	binlens;	//how many phonemes in each
+	std::vector<std::string>	phon6;	//the bins packed 6 bits to a phoneme, if wanted
+	VEC_U32	refs;	//per rule:  left, bracket, right (string ids), phonemes (bin id)
+	size_t	anGroupRules[27];	//how many rules in each group
+	size_t	nRules;
+};
+
+
+//the id of a string, adding it if it's new
+uint32_t internPiece(MAP_STR_ID& ids, std::vector<const std::string*>& pieces,
+		const std::string& str)
+{
+	std::pair<MAP_STR_ID::iterator, bool> ins =
+			ids.insert(MAP_STR_ID::value_type(str, (uint32_t)pieces.size()));
+	if (ins.second)
+		pieces.push_back(&ins.first->first);	//(these stay put)
+	return ins.first->second;
+}
+
 
 //whizz through all the rules and collect deduped data
-void makeDeDups(SET_STR& strs, SET_BLOB& bins)
+void makeDeDups(const TTSRule* const* apRules, InternedRules& interned)
 {
+	interned.nRules = 0;
+	for (size_t nIdx = 0; nIdx < 27; ++nIdx)
+	{
+		interned.anGroupRules[nIdx] = 0;
+		for (const TTSRule* pRule = apRules[nIdx]; NULL != pRule->_bracket; ++pRule)
+			++interned.anGroupRules[nIdx];
+		interned.nRules += interned.anGroupRules[nIdx];
+	}
+	interned.refs.resize(interned.nRules * 4);
+	interned.strids.reserve(interned.nRules);
+	interned.binids.reserve(interned.nRules);
+
 	//whizz through all the rules
+	uint32_t* pnRef = interned.refs.data();
+	std::string str;
 	for (size_t nIdx = 0; nIdx < 27; ++nIdx)
 	{
-		const TTSRule* pRule = _rules[nIdx];	//this group of rules; length unknown
+		const TTSRule* pRule = apRules[nIdx];	//this group of rules; length unknown
 		while (NULL != pRule->_bracket)	//not at sentinel
 		{
-			//stick them in the sets to de-dupe
-			strs.insert(pRule->_left);
-			strs.insert(pRule->_bracket);
-			strs.insert(pRule->_right);
-			VEC_BYTE abyPhon((const uint8_t*)pRule->_phone._phone,
-				(const uint8_t*)pRule->_phone._phone + pRule->_phone._len);
+			//intern them to de-dupe
+			*pnRef++ = internPiece(interned.strids, interned.strs, str.assign(pRule->_left));
+			*pnRef++ = internPiece(interned.strids, interned.strs, str.assign(pRule->_bracket));
+			*pnRef++ = internPiece(interned.strids, interned.strs, str.assign(pRule->_right));
 			//the rules are defined such that the phoneme values are all +1;
 			//this is a hack so that C string merging can be exploited to
 			//simplify declaring the rules in source code.  However, for our
 			//compact rules, we must reverse this transformation.
-			std::transform(abyPhon.begin(), abyPhon.end(), abyPhon.begin(),
-					[](uint8_t by) { return by - 1; });
-			bins.insert(abyPhon);
+			str.assign(pRule->_phone._phone, pRule->_phone._len);
+			std::transform(str.begin(), str.end(), str.begin(),
+					[](char ch) { return (char)(ch - 1); });
+			*pnRef++ = internPiece(interned.binids, interned.bins, str);
 
 			++pRule;	//next rule in group
 		}
 	}
+	interned.binlens.resize(interned.bins.size());
+	for (size_t nId = 0; nId < interned.bins.size(); ++nId)
+		interned.binlens[nId] = (uint32_t)interned.bins[nId]->size();
 }
 
 
+//pack the phoneme sequences 6 bits to a phoneme (see TTS_BLOB_V2_PHON6), so
+//that the data is made of those instead.  Their lengths stay as they were.
+//returns false if a phoneme doesn't fit.
+bool makePhon6Bins(InternedRules& interned)
+{
+	interned.phon6.resize(interned.bins.size());
+	for (size_t nId = 0; nId < interned.bins.size(); ++nId)
+	{
+		const std::string& bin = *interned.bins[nId];
+		for (char ch : bin)
+		{
+			if ((uint8_t)ch >= 64)
+				return false;
+		}
+		std::string& packed = interned.phon6[nId];
+		packed.resize(TTS_PHON6_LEN(bin.size()));
+		ttsPhon6Pack((const uint8_t*)bin.data(), bin.size(), (uint8_t*)&packed[0]);
+		interned.bins[nId] = &packed;
+	}
+	return true;
+}
+
 
-//make string blob
-//here, we take the set of strings and concatenate them as length-prefixed
-//instead of nul-term.  we make a separate index of string to offset to be
-//used during rule encoding.
-void makeStringBlob(VEC_BYTE& abyBlob, SET_STR& strs, MAP_STR_OFFSET& strsidx )
+//the ids of some pieces, in the order of their content (as a std::set of them
+//would have them)
+VEC_U32 sortedIds(const std::vector<const std::string*>& pieces)
 {
-	for (const std::string& str : strs)
+	VEC_U32 ids(pieces.size());
+	for (uint32_t nId = 0; nId < ids.size(); ++nId)
+		ids[nId] = nId;
+	std::sort(ids.begin(), ids.end(), [&](uint32_t a, uint32_t b)
+			{ return *pieces[a] < *pieces[b]; });
+	return ids;
+}
+
+
+
+//make data blob
+//here, we take the strings, then the phoneme sequences, in order, and
+//concatenate them as length-prefixed instead of nul-term.  we note the offset
+//of each, by id, to be used during rule encoding.  returns false if one is
+//too long for its 8-bit prefix.
+bool makeDataBlob(VEC_BYTE& abyBlob, const InternedRules& interned,
+		VEC_U32& stroffs, VEC_U32& binoffs)
+{
+	VEC_U32 strorder = sortedIds(interned.strs);
+	VEC_U32 binorder = sortedIds(interned.bins);
+	size_t nSize = interned.strs.size() + interned.bins.size();	//(the prefixes)
+	for (const std::string* pstr : interned.strs)
+		nSize += pstr->size();
+	for (const std::string* pbin : interned.bins)
+		nSize += pbin->size();
+	abyBlob.resize(nSize);
+
+	size_t nIdx = 0;
+	stroffs.resize(interned.strs.size());
+	binoffs.resize(interned.bins.size());
+	for (int nPass = 0; nPass < 2; ++nPass)
 	{
-		size_t nIdx = abyBlob.size();	//index where we are appending
-		abyBlob.push_back((uint8_t)str.length());	//length prefix
-		//append ASCII
-		abyBlob.insert(abyBlob.end(),
-				(uint8_t*)str.c_str(),
-				(uint8_t*)str.c_str() + str.length());
-		//add to index
-		strsidx.insert(MAP_STR_OFFSET::value_type(str, nIdx));
+		const VEC_U32& order = (0 == nPass) ? strorder : binorder;
+		const std::vector<const std::string*>& pieces = (0 == nPass) ? interned.strs : interned.bins;
+		VEC_U32& offs = (0 == nPass) ? stroffs : binoffs;
+		for (uint32_t nId : order)
+		{
+			const std::string& piece = *pieces[nId];
+			size_t nLen = (0 == nPass) ? piece.size() : interned.binlens[nId];	//(in phonemes)
+			if (nLen > 0xff)
+				return false;
+			offs[nId] = (uint32_t)nIdx;	//index where we are putting it
+			abyBlob[nIdx++] = (uint8_t)nLen;	//length prefix
+			memcpy(&abyBlob[nIdx], piece.data(), piece.size());
+			nIdx += piece.size();
+		}
 	}
+	return true;
 }
 
 
-//make (or append) phoneme blob
-//same thing for the phoneme blobs.
-void makePhonemeBlob(VEC_BYTE& abyBlob, SET_BLOB& bins, MAP_BLOB_OFFSET& binsidx)
+
+//make the data blob packed (see TTS_BLOB_V2_PACKED)
+//Since the rules will give the length of each string, it needn't be prefixed,
+//and so strings are free to overlap.  Those that occur inside another aren't
+//stored at all, and the rest are joined, most overlap first, into chains
+//(greedy shortest common superstring); e.g. 'ring' then 'ingl' is 'ringl'.
+//The strings and phoneme sequences all go into the one pool, and the offsets
+//into it are noted by id.
+//The obvious way of doing this compares every string with every other; here
+//the substrings, prefixes, and so on are hashed instead, so that it is
+//(nearly) linear in the number of strings.
+void makePackedDataBlob(VEC_BYTE& abyBlob, const InternedRules& interned,
+		VEC_U32& stroffs, VEC_U32& binoffs)
 {
-	for (const VEC_BYTE& bin : bins)
+	//everything (deduped once more; a string may be the same bytes as some
+	//phonemes), longest first, then in order
+	std::vector<const std::string*> pieces(interned.strs);
+	pieces.insert(pieces.end(), interned.bins.begin(), interned.bins.end());
+	std::sort(pieces.begin(), pieces.end(), [](const std::string* a, const std::string* b)
+			{ return a->size() != b->size() ? a->size() > b->size() : *a < *b; });
+	pieces.erase(std::unique(pieces.begin(), pieces.end(),
+			[](const std::string* a, const std::string* b) { return *a == *b; }), pieces.end());
+	MAP_STR_ID pieceids;
+	pieceids.reserve(pieces.size());
+	for (uint32_t nIdx = 0; nIdx < pieces.size(); ++nIdx)
+		pieceids[*pieces[nIdx]] = nIdx;
+
+	//only those not inside another need placing.  Every piece inside the ones
+	//kept so far is noted (they are short), with which one and where in it.
+	const uint32_t NOTYET = (uint32_t)-1;
+	std::vector<const std::string*> keep;
+	VEC_U32 inkeep(pieces.size(), NOTYET);
+	VEC_U32 inoff(pieces.size(), 0);
+	std::string str;
+	for (uint32_t nIdx = 0; nIdx < pieces.size(); ++nIdx)
+	{
+		const std::string& piece = *pieces[nIdx];
+		if (piece.empty() || NOTYET != inkeep[nIdx])
+			continue;
+		for (size_t nStart = 0; nStart < piece.size(); ++nStart)
+		{
+			for (size_t nLen = 1; nStart + nLen <= piece.size(); ++nLen)
+			{
+				MAP_STR_ID::const_iterator it = pieceids.find(str.assign(piece, nStart, nLen));
+				if (pieceids.end() != it && NOTYET == inkeep[it->second])
+				{
+					inkeep[it->second] = (uint32_t)keep.size();
+					inoff[it->second] = (uint32_t)nStart;
+				}
+			}
+		}
+		keep.push_back(&piece);
+	}
+
+	//who starts with what (in order); none is inside another, so only the
+	//proper prefixes are of interest.  For each prefix is a list, linked
+	//through startnext, of those it starts.
+	const size_t NONE = (size_t)-1;
+	std::unordered_map<std::string, std::pair<uint32_t, uint32_t> > starts;	//first, last
+	VEC_U32 startto;
+	VEC_U32 startnext;
+	starts.reserve(keep.size() * 2);
+	size_t nMaxLen = 0;
+	for (uint32_t nTo = 0; nTo < keep.size(); ++nTo)
+	{
+		nMaxLen = std::max(nMaxLen, keep[nTo]->size());
+		for (size_t nLen = 1; nLen < keep[nTo]->size(); ++nLen)
+		{
+			uint32_t nEntry = (uint32_t)startto.size();
+			startto.push_back(nTo);
+			startnext.push_back((uint32_t)NONE);
+			std::pair<std::unordered_map<std::string, std::pair<uint32_t, uint32_t> >::iterator, bool> ins =
+					starts.insert(std::make_pair(str.assign(*keep[nTo], 0, nLen), std::make_pair(nEntry, nEntry)));
+			if (!ins.second)
+			{
+				startnext[ins.first->second.second] = nEntry;
+				ins.first->second.second = nEntry;
+			}
+		}
+	}
+
+	//join them, most overlap first (and then in order), as long as each has
+	//one successor and one predecessor, and it doesn't make a loop
+	std::vector<size_t> next(keep.size(), NONE);
+	std::vector<size_t> nextlen(keep.size(), 0);
+	std::vector<bool> hasprev(keep.size(), false);
+	std::vector<size_t> chain(keep.size());	//(union-find of chains)
+	for (size_t nIdx = 0; nIdx < keep.size(); ++nIdx)
+		chain[nIdx] = nIdx;
+	auto findChain = [&](size_t nIdx)
+	{
+		while (chain[nIdx] != nIdx)
+			nIdx = chain[nIdx] = chain[chain[nIdx]];
+		return nIdx;
+	};
+	for (size_t nLen = (nMaxLen > 0 ? nMaxLen - 1 : 0); nLen > 0; --nLen)
+	{
+		for (size_t nFrom = 0; nFrom < keep.size(); ++nFrom)
+		{
+			const std::string& from = *keep[nFrom];
+			if (NONE != next[nFrom] || from.size() <= nLen)
+				continue;
+			std::unordered_map<std::string, std::pair<uint32_t, uint32_t> >::const_iterator it =
+					starts.find(str.assign(from, from.size() - nLen, nLen));
+			if (starts.end() == it)
+				continue;
+			for (uint32_t nEntry = it->second.first; (uint32_t)NONE != nEntry; nEntry = startnext[nEntry])
+			{
+				uint32_t nTo = startto[nEntry];
+				if (nTo == nFrom || hasprev[nTo])
+					continue;
+				size_t nChainFrom = findChain(nFrom);
+				size_t nChainTo = findChain(nTo);
+				if (nChainFrom == nChainTo)
+					continue;
+				next[nFrom] = nTo;
+				nextlen[nFrom] = nLen;
+				hasprev[nTo] = true;
+				chain[nChainTo] = nChainFrom;
+				break;
+			}
+		}
+	}
+
+	//lay out each chain, noting where each one kept went
+	size_t nSize = 0;
+	for (size_t nIdx = 0; nIdx < keep.size(); ++nIdx)
+		nSize += keep[nIdx]->size() - nextlen[nIdx];
+	abyBlob.reserve(nSize);
+	VEC_U32 keepoffs(keep.size());
+	for (size_t nIdx = 0; nIdx < keep.size(); ++nIdx)
 	{
-		size_t nIdx = abyBlob.size();	//index where we are appending
-		abyBlob.push_back((uint8_t)bin.size());	//length prefix
-		//append bin
-		if (0 != bin.size())	//avoid crash on deref
+		if (hasprev[nIdx])
+			continue;
+		size_t nSkip = 0;
+		for (size_t nAt = nIdx; NONE != nAt; nAt = next[nAt])
 		{
-			abyBlob.insert(abyBlob.end(),
-				&bin[0],
-				&bin[0] + bin.size());
+			keepoffs[nAt] = (uint32_t)(abyBlob.size() - nSkip);
+			abyBlob.insert(abyBlob.end(), keep[nAt]->begin() + nSkip, keep[nAt]->end());
+			nSkip = nextlen[nAt];
 		}
-		//add to index
-		binsidx.insert(MAP_BLOB_OFFSET::value_type(bin, nIdx));
 	}
+
+	//now, where everything ended up:  in (or as) one of those kept
+	for (int nPass = 0; nPass < 2; ++nPass)
+	{
+		const std::vector<const std::string*>& ids = (0 == nPass) ? interned.strs : interned.bins;
+		VEC_U32& offs = (0 == nPass) ? stroffs : binoffs;
+		offs.assign(ids.size(), 0);	//(which is right for "")
+		for (uint32_t nId = 0; nId < ids.size(); ++nId)
+		{
+			uint32_t nIdx = pieceids[*ids[nId]];
+			if (NOTYET != inkeep[nIdx])
+				offs[nId] = keepoffs[inkeep[nIdx]] + inoff[nIdx];
+		}
+	}
+}
+
+
+
+//put an offset of nWidth bytes at nIdx, noting if it doesn't fit
+void putOffset(VEC_BYTE& abyBlob, size_t nIdx, size_t nOff, int nWidth, bool& bFits)
+{
+	if (sizeof(uint16_t) == nWidth)
+	{
+		if (nOff > 0xffff)
+			bFits = false;
+		*(uint16_t*)&abyBlob[nIdx] = (uint16_t)nOff;
+	}
+	else
+	{
+		if (nOff > 0xffffffff)
+			bFits = false;
+		*(uint32_t*)&abyBlob[nIdx] = (uint32_t)nOff;
+	}
+}
+
+
+//put a rule's reference to some data at nIdx; either the offset of
+//length-prefixed data, or packed as the offset from the start of the data and
+//the length.
+void putRef(VEC_BYTE& abyBlob, size_t nIdx, size_t nIdxDataOffset, size_t nIdxData,
+		size_t nLen, int nWidth, bool bPacked, bool& bFits)
+{
+	if (!bPacked)
+	{
+		putOffset(abyBlob, nIdx, nIdxDataOffset + nIdxData, nWidth, bFits);
+		return;
+	}
+	int nLenBits = TTS_BLOB_PACKED_LENBITS(nWidth);
+	if (nLen >= ((size_t)1 << nLenBits))
+		bFits = false;
+	putOffset(abyBlob, nIdx, (nIdxData << nLenBits) | nLen, nWidth, bFits);
 }
 
 
 
 //The ruleset blob will precede the data blob.  These will consist of 16-bit
-//values.
+//(or for a v2 blob, possibly 32-bit) values.
 //The first section will be an array of indices to each rule group.  There will
 //actually be 28 entries (instead of 27, the number of groups) because this
 //will simplify calculating the length of the rule group based on index --
 //particularly the last one (len = (idxnext - idxthis) / sizeof(rule).
-//Each rule will be 4 16-bit indices into the data blob for the deduped data
+//If extensions are wanted, there will be more entries after those; they are
+//left as 0 here and filled in when the extension is appended.  (For v2 the
+//extensions go in the directory instead.)
+//Each rule will be 4 indices into the data blob for the deduped data
 //values.  The data values (already computed) will be 8-bit length-prefixed
 //byte sequences -- ascii for the strings and binary for the phoneme sequences.
-void makeRulesetBlob(VEC_BYTE& abyBlob, 
-		VEC_BYTE& abyDataBlob,
-		MAP_STR_OFFSET& strsidx,
-		MAP_BLOB_OFFSET& binsidx)
+//(Or if bPacked, the indices are packed with the length instead; see
+//makePackedDataBlob.)
+//Everything is appended to abyBlob, which may already contain a v2 header;
+//offsets are from the start of abyBlob.  Returns false if an offset did not
+//fit in nWidth.
+bool makeRulesetBlob(VEC_BYTE& abyBlob,
+		const InternedRules& interned,
+		const VEC_BYTE& abyDataBlob,
+		const VEC_U32& stroffs,
+		const VEC_U32& binoffs,
+		size_t nIdxEntries,
+		int nWidth,
+		bool bPacked)
 {
-	//XXX could reserve ((27+1) + 706*4)*sizeof(uint16_t) + abyDataBlob.size();
+	bool bFits = true;
 
-	//first, we know that the rule group index will be 27+1 entries, so just
-	//set that up now, so we can directly index into it.
-	abyBlob.resize((27 + 1) * sizeof(uint16_t));
-	uint16_t nIdxRuleOffset = (uint16_t)abyBlob.size();
+	//first, we know that the rule group index will be 27+1 entries (plus any
+	//extensions), and how many rules there are, so just set that all up now,
+	//so we can directly index into it.
+	size_t nIdxGroupIdx = abyBlob.size();
+	size_t nIdxRuleOffset = nIdxGroupIdx + nIdxEntries * nWidth;
+	size_t nIdxDataOffset = nIdxRuleOffset + interned.nRules * 4 * nWidth;
+	abyBlob.resize(nIdxDataOffset + abyDataBlob.size());
 
+	size_t nIdxRule = nIdxRuleOffset;
+	const uint32_t* pnRef = interned.refs.data();
 	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
 	{
 		//setup the index to this rule group's start
-		uint16_t* pidxgroup = (uint16_t*) &abyBlob[nIdxGroup * sizeof(uint16_t)];
-		*pidxgroup = (uint16_t)abyBlob.size();
-		const TTSRule* pRule = _rules[nIdxGroup];	//this group of rules; length unknown
-		while (NULL != pRule->_bracket)	//not at sentinel
+		putOffset(abyBlob, nIdxGroupIdx + nIdxGroup * nWidth, nIdxRule, nWidth, bFits);
+		for (size_t nIdx = 0; nIdx < interned.anGroupRules[nIdxGroup]; ++nIdx)
 		{
-			//four 16-bit values:  indices into data blob for
+			//four values:  indices into data blob for
 			//left, bracket, right, phoneme data.
-			//these will be relative to the start of the data blob, and we don't know
-			//where that is yet, so we will do a second pass through all the rules
-			//and fix these values up later.
-			uint16_t nIdxLeft = (uint16_t)strsidx[pRule->_left];
-			uint16_t nIdxBracket = (uint16_t)strsidx[pRule->_bracket];
-			uint16_t nIdxRight = (uint16_t)strsidx[pRule->_right];
-			VEC_BYTE phone((const uint8_t*)pRule->_phone._phone,
-				(const uint8_t*)pRule->_phone._phone + pRule->_phone._len);
-			//once again, untransform the phoneme data
-			std::transform(phone.begin(), phone.end(), phone.begin(),
-					[](uint8_t by) { return by - 1; });
-			uint16_t nIdxPhoneme = (uint16_t)binsidx[phone];
-			//now moosh them on
-			abyBlob.insert(abyBlob.end(), (uint8_t*)&nIdxLeft, (uint8_t*)&nIdxLeft + sizeof(nIdxLeft));
-			abyBlob.insert(abyBlob.end(), (uint8_t*)&nIdxBracket, (uint8_t*)&nIdxBracket + sizeof(nIdxBracket));
-			abyBlob.insert(abyBlob.end(), (uint8_t*)&nIdxRight, (uint8_t*)&nIdxRight + sizeof(nIdxRight));
-			abyBlob.insert(abyBlob.end(), (uint8_t*)&nIdxPhoneme, (uint8_t*)&nIdxPhoneme + sizeof(nIdxPhoneme));
-
-			++pRule;	//next rule in group
+			//these are relative to the start of the data blob, which we
+			//already know is right after the rules.
+			for (int nIdxRef = 0; nIdxRef < 3; ++nIdxRef)
+			{
+				putRef(abyBlob, nIdxRule + nIdxRef * nWidth, nIdxDataOffset,
+						stroffs[pnRef[nIdxRef]], interned.strs[pnRef[nIdxRef]]->size(),
+						nWidth, bPacked, bFits);
+			}
+			putRef(abyBlob, nIdxRule + 3 * nWidth, nIdxDataOffset,
+					binoffs[pnRef[3]], interned.binlens[pnRef[3]],
+					nWidth, bPacked, bFits);
+			nIdxRule += 4 * nWidth;
+			pnRef += 4;
 		}
 	}
 	//set the pseudo-index to the last group, which also happens to be the
 	//offset to the start of the data blob.
-	uint16_t nIdxDataOffset = (uint16_t)abyBlob.size();
-	*(uint16_t*)&abyBlob[27 * sizeof(uint16_t)] = nIdxDataOffset;
+	putOffset(abyBlob, nIdxGroupIdx + 27 * nWidth, nIdxDataOffset, nWidth, bFits);
+
+	//now the data blob
+	if (!abyDataBlob.empty())
+		memcpy(&abyBlob[nIdxDataOffset], abyDataBlob.data(), abyDataBlob.size());
+
+	return bFits;
+}
+
+
+
+//a node of the bracket trie, used while building it
+struct TrieNode
+{
+	std::map<uint8_t, TrieNode>	children;
+	std::vector<uint16_t>	own;	//rules whose bracket ends here
+};
+typedef std::vector<uint16_t>	VEC_U16;
+
+
+//emit a trie node (and, recursively, its children) to the end of the trie
+//blob, returning the offset of the node.  The candidates for a node are its
+//parent's plus its own; if it has none of its own it simply shares its
+//parent's list.
+uint16_t makeTrieNode(VEC_BYTE& abyTrie, const TrieNode& node,
+		const VEC_U16& parentcands, uint16_t nParentListOff)
+{
+	VEC_U16 cands(parentcands);
+	cands.insert(cands.end(), node.own.begin(), node.own.end());
+	std::sort(cands.begin(), cands.end());	//must be in order of precedence
+
+	//node header; the list offset and child offsets get fixed up below
+	uint16_t nNodeOff = (uint16_t)abyTrie.size();
+	uint16_t nListOff = nParentListOff;
+	uint16_t nCands = (uint16_t)cands.size();
+	abyTrie.insert(abyTrie.end(), (uint8_t*)&nListOff, (uint8_t*)&nListOff + sizeof(nListOff));
+	abyTrie.insert(abyTrie.end(), (uint8_t*)&nCands, (uint8_t*)&nCands + sizeof(nCands));
+	abyTrie.push_back((uint8_t)node.children.size());
+	for (const auto& child : node.children)
+	{
+		abyTrie.push_back(child.first);
+	}
+	if (0 != abyTrie.size() % 2)
+		abyTrie.push_back(0);	//pad so child offsets are aligned
+	size_t nIdxChildOff = abyTrie.size();
+	abyTrie.resize(abyTrie.size() + node.children.size() * sizeof(uint16_t));
+
+	//our own list, if we have something to add to our parent's
+	if (!node.own.empty())
+	{
+		nListOff = (uint16_t)abyTrie.size();
+		*(uint16_t*)&abyTrie[nNodeOff] = nListOff;
+		abyTrie.insert(abyTrie.end(), (uint8_t*)cands.data(),
+				(uint8_t*)(cands.data() + cands.size()));
+	}
+
+	//now the children
+	for (const auto& child : node.children)
+	{
+		uint16_t nChildOff = makeTrieNode(abyTrie, child.second, cands, nListOff);
+		*(uint16_t*)&abyTrie[nIdxChildOff] = nChildOff;
+		nIdxChildOff += sizeof(uint16_t);
+	}
+
+	return nNodeOff;
+}
+
+
+//make the bracket trie extension
+//for each rule group, build a trie of the bracket strings, so that the engine
+//can walk the text down it to find just the rules whose bracket matches,
+//rather than testing every rule in the group.  (See _transforminputTrie.)
+//Returns false if it is too big for its 16-bit offsets.
+bool makeTrieBlob(VEC_BYTE& abyTrie, const TTSRule* const* apRules)
+{
+	//room for the root offset of each group
+	abyTrie.resize(27 * sizeof(uint16_t));
+
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+	{
+		TrieNode root;
+		uint16_t nIdxRule = 0;
+		const TTSRule* pRule = apRules[nIdxGroup];	//this group of rules; length unknown
+		while (NULL != pRule->_bracket)	//not at sentinel
+		{
+			TrieNode* pNode = &root;
+			for (const char* pch = pRule->_bracket; '\0' != *pch; ++pch)
+			{
+				pNode = &pNode->children[(uint8_t)*pch];
+			}
+			pNode->own.push_back(nIdxRule);
+
+			++pRule;	//next rule in group
+			++nIdxRule;
+		}
+
+		uint16_t nRootOff = makeTrieNode(abyTrie, root, VEC_U16(), 0);
+		*(uint16_t*)&abyTrie[nIdxGroup * sizeof(uint16_t)] = nRootOff;
+		if (abyTrie.size() > 0xffff)
+			return false;	//(and some offsets were truncated)
+	}
+	return true;
+}
+
 
-	//now append the data blob
-	abyBlob.insert(abyBlob.end(), abyDataBlob.begin(), abyDataBlob.end());
 
-	//now, whizz through all the rules, fixing up the indices by adding the
-	//offset to the data start
-	for (size_t nIdxRule = nIdxRuleOffset; nIdxRule < nIdxDataOffset; )
+//compile a context string into bytecode (see TTS_CTX_xxx).  This must agree
+//with the engine's _matchLeft and _matchRight as to what every character means.
+VEC_BYTE compileContext(const char* pszCtx, bool bLeft)
+{
+	std::string strCtx(pszCtx);
+	if (bLeft)	//left contexts are matched backwards from the bracket
+		std::reverse(strCtx.begin(), strCtx.end());
+
+	VEC_BYTE abyCode;
+	for (char ch : strCtx)
 	{
-		//for each of the 4 values, add on the offset to the data blob
-		for (size_t nIterVal = 0; nIterVal < 4; ++nIterVal)
+		if ((ch >= 'a' && ch <= 'z') || '\'' == ch || ' ' == ch)
+		{
+			abyCode.push_back(TTS_CTX_LIT);
+			abyCode.push_back((uint8_t)ch);
+			continue;
+		}
+		switch (ch)
 		{
-			uint16_t* val = (uint16_t*)&abyBlob[nIdxRule];
-			*val += nIdxDataOffset;
-			nIdxRule += sizeof(uint16_t);	//next value
+		case '$':
+			abyCode.push_back(TTS_CTX_BOUND);
+		break;
+		case '#':
+			abyCode.push_back(TTS_CTX_ONEPLUS);
+			abyCode.push_back(TTS_CLS_VOWEL);
+		break;
+		case ':':
+			abyCode.push_back(TTS_CTX_ZEROPLUS);
+			abyCode.push_back(TTS_CLS_CONSONANT);
+		break;
+		case '^':
+			abyCode.push_back(TTS_CTX_ONE);
+			abyCode.push_back(TTS_CLS_CONSONANT);
+		break;
+		case '.':
+			abyCode.push_back(TTS_CTX_ONE);
+			abyCode.push_back(TTS_CLS_VOICED);
+		break;
+		case '+':
+			abyCode.push_back(TTS_CTX_ONE);
+			abyCode.push_back(TTS_CLS_FRONT);
+		break;
+		case '%':	//can't be in left context
+			abyCode.push_back(bLeft ? TTS_CTX_FAIL : TTS_CTX_ESUFFIX);
+		break;
+		default:	//horror unknown
+			abyCode.push_back(TTS_CTX_FAIL);
+		break;
 		}
 	}
+	abyCode.push_back(TTS_CTX_END);
+	return abyCode;
 }
 
 
+//make the precompiled contexts extension
+//this is the 256-entry character class table, then for each rule (in the
+//order they are in the blob) two 16-bit offsets of the left and right context
+//code, then the deduped code itself.  Offsets are relative to the start of the
+//extension.  (See _matchCode.)  Each distinct context is compiled just once.
+//Returns false if it is too big for its 16-bit offsets.
+bool makeCtxCodeBlob(VEC_BYTE& abyCode, const InternedRules& interned)
+{
+	//the character class table
+	abyCode.resize(256);
+	for (const char* pch = "aeiouy"; '\0' != *pch; ++pch)
+		abyCode[(uint8_t)*pch] |= TTS_CLS_VOWEL;
+	for (const char* pch = "bcdfghjklmnpqrstvwxz"; '\0' != *pch; ++pch)
+		abyCode[(uint8_t)*pch] |= TTS_CLS_CONSONANT;
+	for (const char* pch = "bdgjlmnrvwz"; '\0' != *pch; ++pch)
+		abyCode[(uint8_t)*pch] |= TTS_CLS_VOICED;
+	for (const char* pch = "eiy"; '\0' != *pch; ++pch)
+		abyCode[(uint8_t)*pch] |= TTS_CLS_FRONT;
+
+	//room for the per-rule offsets
+	size_t nIdxCodeOff = abyCode.size();
+	abyCode.resize(abyCode.size() + interned.nRules * 2 * sizeof(uint16_t));
+
+	//compile the contexts, and de-dupe the code as we go.  (A left and a
+	//right context may compile to the same code, so that is deduped too.)
+	bool bFits = true;
+	const uint32_t NONE = (uint32_t)-1;
+	VEC_U32 aoffs[2] = { VEC_U32(interned.strs.size(), NONE), VEC_U32(interned.strs.size(), NONE) };
+	std::unordered_map<std::string, uint32_t> codeidx;
+	for (size_t nIdxRule = 0; nIdxRule < interned.nRules; ++nIdxRule)
+	{
+		for (int nSide = 0; nSide < 2; ++nSide)	//left, then right
+		{
+			uint32_t nId = interned.refs[nIdxRule * 4 + (0 == nSide ? 0 : 2)];
+			uint32_t& nOff = aoffs[nSide][nId];
+			if (NONE == nOff)
+			{
+				VEC_BYTE code = compileContext(interned.strs[nId]->c_str(), 0 == nSide);
+				std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> ins =
+						codeidx.insert(std::make_pair(std::string(code.begin(), code.end()),
+						(uint32_t)abyCode.size()));
+				if (ins.second)
+					abyCode.insert(abyCode.end(), code.begin(), code.end());
+				nOff = ins.first->second;
+			}
+			if (nOff > 0xffff)
+				bFits = false;
+			*(uint16_t*)&abyCode[nIdxCodeOff] = (uint16_t)nOff;
+			nIdxCodeOff += sizeof(uint16_t);
+		}
+	}
+	return bFits;
+}
+
+
+
+//make the prefilter extension (see TTS_BLOB_EXT_PREFILTER).  The arrays are
+//padded so that the engine can load a full TTS_PF_LANES from any rule.
+//Returns false if there are too many rules for its 16-bit counts.
+bool makePrefilterBlob(VEC_BYTE& abyPF, const TTSRule* const* apRules, size_t nRules)
+{
+	size_t nStride = (nRules + TTS_PF_LANES + 3) & ~(size_t)3;
+	if (nStride > 0xffff)
+		return false;
+	abyPF.assign(2 * sizeof(uint16_t) + (1 + TTS_PF_CHARS + 1) * nStride, 0);
+	((uint16_t*)&abyPF[0])[0] = (uint16_t)nRules;
+	((uint16_t*)&abyPF[0])[1] = (uint16_t)nStride;
+	uint8_t* pbyLen = &abyPF[2 * sizeof(uint16_t)];
+	uint8_t* pbyChars = pbyLen + nStride;
+	uint8_t* pbyFlags = pbyChars + TTS_PF_CHARS * nStride;
+
+	size_t nIdxRuleAll = 0;
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+	{
+		for (const TTSRule* pRule = apRules[nIdxGroup]; NULL != pRule->_bracket; ++pRule)
+		{
+			size_t nLen = strlen(pRule->_bracket);
+			pbyLen[nIdxRuleAll] = (uint8_t)std::min(nLen, (size_t)TTS_PF_MAXLEN);
+			for (size_t nIdxChar = 0; nIdxChar < TTS_PF_CHARS && nIdxChar < nLen; ++nIdxChar)
+				pbyChars[nIdxChar * nStride + nIdxRuleAll] = (uint8_t)pRule->_bracket[nIdxChar];
+			pbyFlags[nIdxRuleAll] = ('\0' == pRule->_left[0] ? TTS_PF_LEFTANY : 0) |
+					('\0' == pRule->_right[0] ? TTS_PF_RIGHTANY : 0);
+			++nIdxRuleAll;
+		}
+	}
+	return true;
+}
+
+
+
+//make the exception dictionary extension
+//The words are placed with a minimal perfect hash (see TTS_DICT_DIRECT in
+//text_to_speech.h), by 'hash and displace':  the words are split into buckets
+//of about four by their hash, and then, biggest bucket first, we search for a
+//seed that puts all of a bucket's words in slots that are still free.  The
+//last buckets have just one word, and those can simply be given a free slot.
+//With bPhone6, the phonemes are packed (see TTS_BLOB_V2_PHON6).
+//returns false if a word or its phonemes are too long, or (unlikely) no seed
+//could be found.
+bool makeDictBlob(VEC_BYTE& abyDict, const MAP_EXCEPTIONS& dict, bool bPhone6)
+{
+	std::vector<const MAP_EXCEPTIONS::value_type*> entries;
+	for (const MAP_EXCEPTIONS::value_type& entry : dict)
+	{
+		if (entry.first.size() > 255 || entry.second.size() > 255)
+			return false;
+		if (bPhone6 && entry.second.end() != std::find_if(entry.second.begin(), entry.second.end(),
+				[](uint8_t by) { return by >= 64; }))
+			return false;
+		entries.push_back(&entry);
+	}
+	uint32_t nSlots = (uint32_t)entries.size();
+	uint32_t nBuckets = (nSlots + 3) / 4;
+
+	//bucket the words
+	std::vector<std::vector<uint32_t> > buckets(nBuckets);
+	for (uint32_t nIdx = 0; nIdx < nSlots; ++nIdx)
+	{
+		const std::string& str = entries[nIdx]->first;
+		buckets[_hashDictWord(str.data(), (int)str.size(), 0) % nBuckets].push_back(nIdx);
+	}
+	std::vector<uint32_t> order(nBuckets);
+	for (uint32_t nIdxBucket = 0; nIdxBucket < nBuckets; ++nIdxBucket)
+		order[nIdxBucket] = nIdxBucket;
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b)
+			{ return buckets[a].size() > buckets[b].size(); });
+
+	//find each bucket's seed
+	std::vector<uint32_t> seeds(nBuckets, 0);
+	std::vector<uint32_t> slots(nSlots);	//which word is in each slot
+	std::vector<bool> used(nSlots, false);
+	uint32_t nIdxFree = 0;	//(for the singletons)
+	for (uint32_t nIdxBucket : order)
+	{
+		const std::vector<uint32_t>& bucket = buckets[nIdxBucket];
+		if (bucket.empty())
+			continue;
+		if (1 == bucket.size())
+		{
+			while (used[nIdxFree])
+				++nIdxFree;
+			seeds[nIdxBucket] = TTS_DICT_DIRECT | nIdxFree;
+			used[nIdxFree] = true;
+			slots[nIdxFree] = bucket[0];
+			continue;
+		}
+		std::vector<uint32_t> tried;
+		uint32_t nSeed;
+		for (nSeed = 1; nSeed < TTS_DICT_DIRECT; ++nSeed)
+		{
+			tried.clear();
+			for (uint32_t nIdx : bucket)
+			{
+				const std::string& str = entries[nIdx]->first;
+				uint32_t nSlot = _hashDictWord(str.data(), (int)str.size(), nSeed) % nSlots;
+				if (used[nSlot] || tried.end() != std::find(tried.begin(), tried.end(), nSlot))
+					break;
+				tried.push_back(nSlot);
+			}
+			if (tried.size() == bucket.size())
+				break;
+		}
+		if (TTS_DICT_DIRECT == nSeed)
+			return false;
+		seeds[nIdxBucket] = nSeed;
+		for (size_t nIdx = 0; nIdx < bucket.size(); ++nIdx)
+		{
+			used[tried[nIdx]] = true;
+			slots[tried[nIdx]] = bucket[nIdx];
+		}
+	}
+
+	//now lay it out
+	abyDict.resize((2 + nBuckets + nSlots) * sizeof(uint32_t));
+	uint32_t* pnDict = (uint32_t*)abyDict.data();
+	pnDict[0] = nSlots;
+	pnDict[1] = nBuckets;
+	std::copy(seeds.begin(), seeds.end(), &pnDict[2]);
+	for (uint32_t nSlot = 0; nSlot < nSlots; ++nSlot)
+	{
+		const MAP_EXCEPTIONS::value_type& entry = *entries[slots[nSlot]];
+		*(uint32_t*)&abyDict[(2 + nBuckets + nSlot) * sizeof(uint32_t)] = (uint32_t)abyDict.size();
+		abyDict.push_back((uint8_t)entry.first.size());
+		abyDict.insert(abyDict.end(), entry.first.begin(), entry.first.end());
+		abyDict.push_back((uint8_t)entry.second.size());
+		if (bPhone6)
+		{
+			size_t nIdxPhon = abyDict.size();
+			abyDict.resize(nIdxPhon + TTS_PHON6_LEN(entry.second.size()));
+			ttsPhon6Pack(entry.second.data(), entry.second.size(), &abyDict[nIdxPhon]);
+		}
+		else
+			abyDict.insert(abyDict.end(), entry.second.begin(), entry.second.end());
+	}
+	return true;
+}
+
+
+
+//set a v2 blob's directory entry
+void setDirEntry(VEC_BYTE& abyBlob, int& nIdxSect, int nId, size_t nOff, size_t nLen)
+{
+	uint8_t* pbyEntry = &abyBlob[TTS_BLOB_V2_HDRLEN + nIdxSect * TTS_BLOB_V2_DIRLEN];
+	((uint16_t*)pbyEntry)[0] = (uint16_t)nId;
+	((uint16_t*)pbyEntry)[1] = 0;
+	((uint32_t*)pbyEntry)[1] = (uint32_t)nOff;
+	((uint32_t*)pbyEntry)[2] = (uint32_t)nLen;
+	++nIdxSect;
+}
+
+
+//append an extension to the blob, and set its entry in the index (or for v2,
+//the directory).  Returns false if its offset didn't fit.
+bool appendExtension(VEC_BYTE& abyBlob, int nIdxExt, const VEC_BYTE& abyExt,
+		bool bV2, int& nIdxSect)
+{
+	while (0 != abyBlob.size() % 4)
+		abyBlob.push_back(0);	//pad so the extension is aligned
+	bool bFits = true;
+	if (bV2)
+		setDirEntry(abyBlob, nIdxSect, nIdxExt, abyBlob.size(), abyExt.size());
+	else
+		putOffset(abyBlob, nIdxExt * sizeof(uint16_t), abyBlob.size(), sizeof(uint16_t), bFits);
+	abyBlob.insert(abyBlob.end(), abyExt.begin(), abyExt.end());
+	return bFits;
+}
+
+
+
+//seconds since tmStart, and restart it
+double lapTime(std::chrono::steady_clock::time_point& tmStart)
+{
+	std::chrono::steady_clock::time_point tmNow = std::chrono::steady_clock::now();
+	double dSecs = std::chrono::duration<double>(tmNow - tmStart).count();
+	tmStart = tmNow;
+	return dSecs;
+}
+
 
 //do the whole thing
-void make_compact_ruleset ( VEC_BYTE& abyBlob )
+bool make_compact_ruleset ( VEC_BYTE& abyBlob, unsigned int nOpts,
+		const TTSRule* const* apRules, const MAP_EXCEPTIONS* pDict,
+		MCRTimings* pTimings )
 {
+	if (NULL == apRules)
+		apRules = _rules;
+	MCRTimings timings = MCRTimings();
+	if (NULL != pTimings)
+		*pTimings = timings;	//(in case of failing early)
+	std::chrono::steady_clock::time_point tmStart = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point tmLap = tmStart;
+
 	//make deduped data sets
-	SET_STR strs;
-	SET_BLOB bins;
-	makeDeDups(strs, bins);
+	InternedRules interned;
+	makeDeDups(apRules, interned);
+	bool bPhone6 = 0 != (nOpts & MCR_OPT_PHON6);
+	if (bPhone6 && !makePhon6Bins(interned))
+		return false;
+	timings._dDeDup = lapTime(tmLap);
 
 	//make indexed data blob of deduped data
+	bool bPacked = 0 != (nOpts & MCR_OPT_PACK);
 	VEC_BYTE abyDataBlob;
-	MAP_STR_OFFSET strsidx;
-	makeStringBlob(abyDataBlob, strs, strsidx);
-	MAP_BLOB_OFFSET binsidx;
-	makePhonemeBlob(abyDataBlob, bins, binsidx);
+	VEC_U32 stroffs;
+	VEC_U32 binoffs;
+	if (bPacked)
+	{
+		makePackedDataBlob(abyDataBlob, interned, stroffs, binoffs);
+	}
+	else
+	{
+		if (!makeDataBlob(abyDataBlob, interned, stroffs, binoffs))
+			return false;
+	}
+	timings._dData = lapTime(tmLap);
+
+	//the index has 27+1 entries, plus room for any extensions (v1), or the
+	//extensions go in the directory (v2)
+	bool bV2 = 0 != (nOpts & (MCR_OPT_V2 | MCR_OPT_WIDE | MCR_OPT_PACK | MCR_OPT_PHON6));
+	int nWidth = (nOpts & MCR_OPT_WIDE) ? sizeof(uint32_t) : sizeof(uint16_t);
+	size_t nIdxEntries = 27 + 1;
+	int nSects = 3;	//(v2) groups, rules, data
+	if (nOpts & MCR_OPT_TRIE)
+	{
+		if (!bV2)
+			nIdxEntries = std::max(nIdxEntries, (size_t)TTS_BLOB_EXT_TRIE + 1);
+		++nSects;
+	}
+	if (nOpts & MCR_OPT_CTXCODE)
+	{
+		if (!bV2)
+			nIdxEntries = std::max(nIdxEntries, (size_t)TTS_BLOB_EXT_CTXCODE + 1);
+		++nSects;
+	}
+	bool bDict = NULL != pDict && !pDict->empty();
+	if (bDict)
+	{
+		if (!bV2)
+			nIdxEntries = std::max(nIdxEntries, (size_t)TTS_BLOB_EXT_DICT + 1);
+		++nSects;
+	}
+	if (nOpts & MCR_OPT_PREFILTER)
+	{
+		if (!bV2)
+			nIdxEntries = std::max(nIdxEntries, (size_t)TTS_BLOB_EXT_PREFILTER + 1);
+		++nSects;
+	}
 
-	//std::cout << "dstrs: " << strs.size() << ", dbins: " << bins.size() << 
-	//		", blobsize: " << abyBlob.size() << std::endl;
+	//the v2 header and directory; the directory is filled in as we go
+	abyBlob.clear();
+	int nIdxSect = 0;
+	if (bV2)
+	{
+		abyBlob.resize(TTS_BLOB_V2_HDRLEN + nSects * TTS_BLOB_V2_DIRLEN);
+		memcpy(&abyBlob[0], TTS_BLOB_MAGIC, 4);
+		abyBlob[4] = 2;
+		abyBlob[5] = (uint8_t)nWidth | (bPacked ? TTS_BLOB_V2_PACKED : 0) |
+				(bPhone6 ? TTS_BLOB_V2_PHON6 : 0);
+		*(uint16_t*)&abyBlob[6] = (uint16_t)nSects;
+	}
 
 	//now, make list-of-rulegroups-lengths, and list-of-all-rules
-	makeRulesetBlob(abyBlob, abyDataBlob, strsidx, binsidx);
+	size_t nIdxGroups = abyBlob.size();
+	bool bFits = makeRulesetBlob(abyBlob, interned, abyDataBlob, stroffs, binoffs,
+			nIdxEntries, nWidth, bPacked);
+	if (bV2)
+	{
+		size_t nIdxRules = nIdxGroups + nIdxEntries * nWidth;
+		size_t nIdxData = abyBlob.size() - abyDataBlob.size();
+		setDirEntry(abyBlob, nIdxSect, TTS_BLOB_SECT_GROUPS, nIdxGroups, nIdxRules - nIdxGroups);
+		setDirEntry(abyBlob, nIdxSect, TTS_BLOB_SECT_RULES, nIdxRules, nIdxData - nIdxRules);
+		setDirEntry(abyBlob, nIdxSect, TTS_BLOB_SECT_DATA, nIdxData, abyDataBlob.size());
+	}
+	timings._dRules = lapTime(tmLap);
+
+	//optional extensions
+	if (nOpts & MCR_OPT_TRIE)
+	{
+		VEC_BYTE abyTrie;
+		bFits &= makeTrieBlob(abyTrie, apRules);
+		bFits &= appendExtension(abyBlob, TTS_BLOB_EXT_TRIE, abyTrie, bV2, nIdxSect);
+		timings._dTrie = lapTime(tmLap);
+	}
+	if (nOpts & MCR_OPT_CTXCODE)
+	{
+		VEC_BYTE abyCode;
+		bFits &= makeCtxCodeBlob(abyCode, interned);
+		bFits &= appendExtension(abyBlob, TTS_BLOB_EXT_CTXCODE, abyCode, bV2, nIdxSect);
+		timings._dCtxCode = lapTime(tmLap);
+	}
+	if (bDict)
+	{
+		VEC_BYTE abyDict;
+		if (!makeDictBlob(abyDict, *pDict, bPhone6))
+			return false;
+		bFits &= appendExtension(abyBlob, TTS_BLOB_EXT_DICT, abyDict, bV2, nIdxSect);
+		timings._dDict = lapTime(tmLap);
+	}
+	if (nOpts & MCR_OPT_PREFILTER)
+	{
+		VEC_BYTE abyPF;
+		bFits &= makePrefilterBlob(abyPF, apRules, interned.nRules);
+		bFits &= appendExtension(abyBlob, TTS_BLOB_EXT_PREFILTER, abyPF, bV2, nIdxSect);
+		timings._dPrefilter = lapTime(tmLap);
+	}
+
+	timings._dTotal = lapTime(tmStart);
+	if (NULL != pTimings)
+		*pTimings = timings;
+	return bFits;
 }
@@ -3,11 +3,53 @@
 
 #include <stdint.h>
 #include <vector>
+#include <map>
+#include <string>
+#include "tts_rules.h"
 
 typedef std::vector<uint8_t>	VEC_BYTE;
 
-//do the whole thing
-void make_compact_ruleset ( VEC_BYTE& abyBlob );
+//an exception dictionary:  whole (lower case) words, and their phonemes
+typedef std::map<std::string, VEC_BYTE>	MAP_EXCEPTIONS;
+
+//optional things to include in the blob; bitwise-or these together.  With
+//none of them, the blob is the plain form the embedded target has always
+//consumed.
+enum MCR_OPTS
+{
+	MCR_OPT_NONE = 0x0000,
+	MCR_OPT_TRIE = 0x0001,	//per-section bracket trie; faster rule lookup
+	MCR_OPT_CTXCODE = 0x0002,	//precompiled contexts; no faster, as measured (see README)
+	MCR_OPT_V2 = 0x0004,	//v2 format; header and section directory
+	MCR_OPT_WIDE = 0x0008,	//v2 format with 32-bit offsets; for big rulesets
+	MCR_OPT_PACK = 0x0010,	//v2 format with overlapping data; smaller
+	MCR_OPT_PREFILTER = 0x0020,	//bracket summary arrays; faster rule lookup
+	MCR_OPT_PHON6 = 0x0040,	//v2 format with 6-bit phonemes; smaller
+};
+
+//how long make_compact_ruleset took over each part of the job, in seconds
+struct MCRTimings
+{
+	double	_dDeDup;	//interning the rules' strings and phonemes
+	double	_dData;	//laying out (or packing) the data
+	double	_dRules;	//the group index and the rules
+	double	_dTrie;	//the extensions, if wanted
+	double	_dCtxCode;
+	double	_dDict;
+	double	_dPrefilter;
+	double	_dTotal;
+};
+
+//do the whole thing.  the rules are _rules, unless some other (e.g. reordered)
+//set of 27 groups is given.  If an exception dictionary is given (and isn't
+//empty), it is included too.  returns false if the blob is too big for 16-bit
+//offsets (see MCR_OPT_WIDE; the trie, precompiled contexts, and prefilter are
+//always 16-bit), or (unless MCR_OPT_PACK) a rule's string or phonemes are
+//longer than 255, or the dictionary can't be made, or (MCR_OPT_PHON6) there is
+//a phoneme that doesn't fit in 6 bits.  If pTimings is given, it is filled in.
+bool make_compact_ruleset ( VEC_BYTE& abyBlob, unsigned int nOpts = MCR_OPT_NONE,
+		const TTSRule* const* apRules = NULL, const MAP_EXCEPTIONS* pDict = NULL,
+		MCRTimings* pTimings = NULL );
 
 
 #endif
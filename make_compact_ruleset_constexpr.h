@@ -0,0 +1,201 @@
+#ifndef __MAKE_COMPACT_RULESET_CONSTEXPR_H
+#define __MAKE_COMPACT_RULESET_CONSTEXPR_H
+
+//This is make_compact_ruleset() with no options -- i.e. the plain blob the
+//embedded target consumes -- but as C++20 constexpr, so that the blob can be
+//made at compile time, straight from the rule tables.  It is byte for byte
+//what make_compact_ruleset() makes:  the strings sorted and deduped, then the
+//phoneme sequences likewise, each length-prefixed, after the group index and
+//the rules.  The compile-time evaluator has no std::set or std::map, so the
+//deduping is done with a sorted vector instead.  (The optional extensions are
+//only to be had from make_compact_ruleset().)
+//
+//Since the size of the blob has to be known to make the std::array, that's
+//figured first:
+//	constexpr size_t n = mcr_constexpr::ruleset_blob_size(apRules);
+//	constexpr auto blob = mcr_constexpr::make_ruleset_blob<n>(apRules);
+//where apRules are constexpr rule groups (see tts_rules_compact_constexpr.h).
+
+#if (defined(_MSVC_LANG) ? _MSVC_LANG : __cplusplus) < 202002L
+#error make_compact_ruleset_constexpr.h needs C++20
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include "tts_rules.h"
+
+
+namespace mcr_constexpr
+{
+
+//a string or phoneme sequence of a rule.  The rules' phonemes are all +1 (see
+//makeDeDups), so for those the bytes are the rule's less one.
+struct Piece
+{
+	const char*	_pch;
+	size_t	_len;
+	bool	_bPhone;
+
+	constexpr uint8_t at(size_t nIdx) const
+	{
+		return (uint8_t)((uint8_t)_pch[nIdx] - (_bPhone ? 1 : 0));
+	}
+};
+
+
+//the order of the data:  strings, then phoneme sequences, each in the order a
+//std::set would have them
+constexpr bool lessPiece(const Piece& a, const Piece& b)
+{
+	if (a._bPhone != b._bPhone)
+		return b._bPhone;
+	for (size_t nIdx = 0; nIdx < a._len && nIdx < b._len; ++nIdx)
+	{
+		if (a.at(nIdx) != b.at(nIdx))
+			return a.at(nIdx) < b.at(nIdx);
+	}
+	return a._len < b._len;
+}
+
+
+constexpr Piece stringPiece(const char* psz)
+{
+	size_t nLen = 0;
+	while ('\0' != psz[nLen])
+		++nLen;
+	return Piece{ psz, nLen, false };
+}
+
+
+constexpr Piece phonemePiece(const PhonSeq& phone)
+{
+	return Piece{ phone._phone, phone._len, true };
+}
+
+
+constexpr size_t countRules(const TTSRule* const* apRules)
+{
+	size_t nRules = 0;
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+	{
+		for (const TTSRule* pRule = apRules[nIdxGroup]; NULL != pRule->_bracket; ++pRule)
+			++nRules;
+	}
+	return nRules;
+}
+
+
+//collect deduped data (as makeDeDups), in blob order
+constexpr std::vector<Piece> makeDeDups(const TTSRule* const* apRules)
+{
+	std::vector<Piece> pieces;
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+	{
+		for (const TTSRule* pRule = apRules[nIdxGroup]; NULL != pRule->_bracket; ++pRule)
+		{
+			pieces.push_back(stringPiece(pRule->_left));
+			pieces.push_back(stringPiece(pRule->_bracket));
+			pieces.push_back(stringPiece(pRule->_right));
+			pieces.push_back(phonemePiece(pRule->_phone));
+		}
+	}
+	std::sort(pieces.begin(), pieces.end(), lessPiece);
+	pieces.erase(std::unique(pieces.begin(), pieces.end(),
+			[](const Piece& a, const Piece& b) { return !lessPiece(a, b) && !lessPiece(b, a); }),
+			pieces.end());
+	return pieces;
+}
+
+
+//the size of the data, with the length prefixes
+constexpr size_t dataSize(const std::vector<Piece>& pieces)
+{
+	size_t nSize = 0;
+	for (const Piece& piece : pieces)
+		nSize += 1 + piece._len;
+	return nSize;
+}
+
+
+//how big the blob will be
+constexpr size_t ruleset_blob_size(const TTSRule* const* apRules)
+{
+	return (27 + 1) * sizeof(uint16_t) + countRules(apRules) * 4 * sizeof(uint16_t) +
+			dataSize(makeDeDups(apRules));
+}
+
+
+//put a 16-bit offset at nIdx.  If it doesn't fit, this is not a constant
+//expression, so the blob won't compile (rather than being silently truncated).
+template <size_t N>
+constexpr void putOffset(std::array<uint8_t, N>& abyBlob, size_t nIdx, size_t nOff)
+{
+	if (nOff > 0xffff)
+		throw "ruleset too big for 16-bit offsets";
+	//(little-endian, as the target is)
+	abyBlob[nIdx] = (uint8_t)nOff;
+	abyBlob[nIdx + 1] = (uint8_t)(nOff >> 8);
+}
+
+
+//the offset of a piece in the data, which is there (see makeDeDups)
+constexpr size_t dataOffset(const std::vector<Piece>& pieces,
+		const std::vector<size_t>& offsets, const Piece& piece)
+{
+	return offsets[std::lower_bound(pieces.begin(), pieces.end(), piece, lessPiece) -
+			pieces.begin()];
+}
+
+
+//do the whole thing (as makeRulesetBlob); N must be ruleset_blob_size()
+template <size_t N>
+constexpr std::array<uint8_t, N> make_ruleset_blob(const TTSRule* const* apRules)
+{
+	std::array<uint8_t, N> abyBlob{};
+	std::vector<Piece> pieces = makeDeDups(apRules);
+	size_t nIdxRuleOffset = (27 + 1) * sizeof(uint16_t);
+	size_t nIdxDataOffset = nIdxRuleOffset + countRules(apRules) * 4 * sizeof(uint16_t);
+	if (N != nIdxDataOffset + dataSize(pieces))
+		throw "wrong size for the blob; see ruleset_blob_size()";
+
+	//the data blob, and where each thing is in it
+	std::vector<size_t> offsets;
+	size_t nIdxData = nIdxDataOffset;
+	for (const Piece& piece : pieces)
+	{
+		offsets.push_back(nIdxData);
+		abyBlob[nIdxData++] = (uint8_t)piece._len;	//length prefix
+		for (size_t nIdx = 0; nIdx < piece._len; ++nIdx)
+			abyBlob[nIdxData++] = piece.at(nIdx);
+	}
+
+	//the group index and the rules
+	size_t nIdxRule = nIdxRuleOffset;
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+	{
+		putOffset(abyBlob, nIdxGroup * sizeof(uint16_t), nIdxRule);
+		for (const TTSRule* pRule = apRules[nIdxGroup]; NULL != pRule->_bracket; ++pRule)
+		{
+			putOffset(abyBlob, nIdxRule + 0 * sizeof(uint16_t),
+					dataOffset(pieces, offsets, stringPiece(pRule->_left)));
+			putOffset(abyBlob, nIdxRule + 1 * sizeof(uint16_t),
+					dataOffset(pieces, offsets, stringPiece(pRule->_bracket)));
+			putOffset(abyBlob, nIdxRule + 2 * sizeof(uint16_t),
+					dataOffset(pieces, offsets, stringPiece(pRule->_right)));
+			putOffset(abyBlob, nIdxRule + 3 * sizeof(uint16_t),
+					dataOffset(pieces, offsets, phonemePiece(pRule->_phone)));
+			nIdxRule += 4 * sizeof(uint16_t);
+		}
+	}
+	putOffset(abyBlob, 27 * sizeof(uint16_t), nIdxDataOffset);
+
+	return abyBlob;
+}
+
+}	//namespace mcr_constexpr
+
+
+#endif
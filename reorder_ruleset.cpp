@@ -0,0 +1,327 @@
+#include "reorder_ruleset.h"
+#include "make_compact_ruleset.h"
+#include "text_to_speech.h"
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <string.h>
+
+
+
+bool loadWordFreq(const char* pszFile, VEC_WORDFREQ& words)
+{
+	std::ifstream ifs(pszFile);
+	if (!ifs)
+		return false;
+	std::string strLine;
+	while (std::getline(ifs, strLine))
+	{
+		std::istringstream iss(strLine);
+		std::string strWord;
+		unsigned long nCount = 1;
+		if (!(iss >> strWord))
+			continue;
+		iss >> nCount;
+		std::transform(strWord.begin(), strWord.end(), strWord.begin(), ::tolower);
+		words.push_back(VEC_WORDFREQ::value_type(strWord, nCount));
+	}
+	return true;
+}
+
+
+
+void ruleGroupsArray(const VEC_RULEGROUPS& groups, const TTSRule* apRules[27])
+{
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+		apRules[nIdxGroup] = groups[nIdxGroup].data();
+}
+
+
+
+//What a rule requires of the text, one character at a time, going away from
+//the start of the bracket (forwards for the bracket and right context,
+//backwards for the left).  We only go as far as we can say something definite
+//about a single character; after that, anything is possible.
+enum CTX_TOK_KIND
+{
+	CTX_TOK_LIT,	//this exact character
+	CTX_TOK_CLASS,	//a character of this class
+	CTX_TOK_END,	//the word ends (begins) here
+};
+struct CtxTok
+{
+	CTX_TOK_KIND	eKind;
+	uint8_t	by;	//the character, or class bits (TTS_CLS_xxx)
+	bool	bInWord;	//(bracket characters are known to be in the word)
+};
+typedef std::vector<CtxTok>	VEC_CTXTOK;
+
+
+//character class table, as per makeCtxCodeBlob
+uint8_t charClass(uint8_t ch)
+{
+	uint8_t byCls = 0;
+	if (NULL != strchr("aeiouy", ch))
+		byCls |= TTS_CLS_VOWEL;
+	if (NULL != strchr("bcdfghjklmnpqrstvwxz", ch))
+		byCls |= TTS_CLS_CONSONANT;
+	if (NULL != strchr("bdgjlmnrvwz", ch))
+		byCls |= TTS_CLS_VOICED;
+	if (NULL != strchr("eiy", ch))
+		byCls |= TTS_CLS_FRONT;
+	return ('\0' == ch) ? 0 : byCls;
+}
+
+
+//tokenize a context, until we can't say anything definite
+void tokenizeContext(const char* pszCtx, bool bLeft, VEC_CTXTOK& toks)
+{
+	std::string strCtx(pszCtx);
+	if (bLeft)
+		std::reverse(strCtx.begin(), strCtx.end());
+	for (size_t nIdx = 0; nIdx < strCtx.size(); ++nIdx)
+	{
+		char ch = strCtx[nIdx];
+		CtxTok tok = { CTX_TOK_LIT, (uint8_t)ch, false };
+		if ((ch >= 'a' && ch <= 'z') || '\'' == ch || ' ' == ch)
+		{
+			toks.push_back(tok);
+			continue;
+		}
+		tok.eKind = CTX_TOK_CLASS;
+		switch (ch)
+		{
+		case '$':	//only meaningful right next to the bracket
+			if (0 != nIdx)
+				return;
+			tok.eKind = CTX_TOK_END;
+		break;
+		case '^': tok.by = TTS_CLS_CONSONANT; break;
+		case '.': tok.by = TTS_CLS_VOICED; break;
+		case '+': tok.by = TTS_CLS_FRONT; break;
+		case '#':	//we know the first is a vowel, but not how many more
+			tok.by = TTS_CLS_VOWEL;
+			toks.push_back(tok);
+			return;
+		default:	//':', '%', and anything else; who knows
+			return;
+		}
+		toks.push_back(tok);
+	}
+}
+
+
+//could these two requirements on the same character both be satisfied?
+bool tokensCompatible(const CtxTok& tokA, const CtxTok& tokB)
+{
+	//the end of the word can't be where the other has a bracket character.
+	//Otherwise it tells us nothing, since contexts can look beyond the word
+	//into whatever memory is there.
+	if (CTX_TOK_END == tokA.eKind || CTX_TOK_END == tokB.eKind)
+	{
+		if (CTX_TOK_END == tokA.eKind && CTX_TOK_END == tokB.eKind)
+			return true;
+		return !(tokA.bInWord || tokB.bInWord);
+	}
+	if (CTX_TOK_LIT == tokA.eKind && CTX_TOK_LIT == tokB.eKind)
+		return tokA.by == tokB.by;
+	if (CTX_TOK_LIT == tokA.eKind)
+		return 0 != (charClass(tokA.by) & tokB.by);
+	if (CTX_TOK_LIT == tokB.eKind)
+		return 0 != (charClass(tokB.by) & tokA.by);
+	//two classes; is there any character in both?
+	for (int ch = 'a'; ch <= 'z'; ++ch)
+	{
+		if ((charClass((uint8_t)ch) & tokA.by) && (charClass((uint8_t)ch) & tokB.by))
+			return true;
+	}
+	return false;
+}
+
+
+bool sequencesCompatible(const VEC_CTXTOK& toksA, const VEC_CTXTOK& toksB)
+{
+	size_t nLen = std::min(toksA.size(), toksB.size());
+	for (size_t nIdx = 0; nIdx < nLen; ++nIdx)
+	{
+		if (!tokensCompatible(toksA[nIdx], toksB[nIdx]))
+			return false;
+	}
+	return true;
+}
+
+
+//the forward and backward requirements of a rule
+struct RuleShape
+{
+	VEC_CTXTOK	fwd;
+	VEC_CTXTOK	back;
+};
+
+RuleShape ruleShape(const TTSRule& rule)
+{
+	RuleShape shape;
+	for (const char* pch = rule._bracket; '\0' != *pch; ++pch)
+	{
+		CtxTok tok = { CTX_TOK_LIT, (uint8_t)*pch, true };
+		shape.fwd.push_back(tok);
+	}
+	tokenizeContext(rule._right, false, shape.fwd);
+	tokenizeContext(rule._left, true, shape.back);
+	return shape;
+}
+
+
+//might these two rules both match at the same place in the same text?  (This
+//errs on the side of 'yes'.)
+bool rulesOverlap(const RuleShape& shapeA, const RuleShape& shapeB)
+{
+	return sequencesCompatible(shapeA.fwd, shapeB.fwd) &&
+			sequencesCompatible(shapeA.back, shapeB.back);
+}
+
+
+
+//run the corpus through the rules in a blob, as _transforminput does,
+//counting how often each rule fires and how many rules get tried overall
+void countRuleHits(const VEC_BYTE& abyBlob, const VEC_WORDFREQ& words,
+		std::vector<std::vector<unsigned long> >& hits, unsigned long long& nProbes,
+		unsigned long long& nLookups)
+{
+	hits.assign(27, std::vector<unsigned long>());
+	for (int nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+		hits[nIdxGroup].resize(_getRuleSectionLength(abyBlob.data(), nIdxGroup));
+	nProbes = 0;
+	nLookups = 0;
+
+	for (const VEC_WORDFREQ::value_type& wf : words)
+	{
+		const char* pszWord = wf.first.c_str();
+		size_t nWordLen = wf.first.size();
+		size_t nIdxWord = 0;
+		while (nIdxWord < nWordLen)
+		{
+			char ch = pszWord[nIdxWord];
+			int nIdxGroup = (ch >= 'a' && ch <= 'z') ? ch - 'a' + 1 : 0;
+			size_t nConsumed = 1;
+			int nRules = (int)hits[nIdxGroup].size();
+			int nIdxRule;
+			for (nIdxRule = 0; nIdxRule < nRules; ++nIdxRule)
+			{
+				TTSRule_compact rule;
+				_reconstitute_rule(abyBlob.data(), nIdxGroup, nIdxRule, &rule);
+				size_t nBracketLen = rule._nBracket;
+				if (nIdxWord + nBracketLen > nWordLen ||
+						0 != memcmp(&pszWord[nIdxWord], rule._bracket, nBracketLen))
+					continue;
+				if (_matchLeft(pszWord, nWordLen, nIdxWord, rule._left, rule._nLeft) &&
+						_matchRight(pszWord, nWordLen, nIdxWord + nBracketLen, rule._right, rule._nRight))
+				{
+					nConsumed = nBracketLen;
+					hits[nIdxGroup][nIdxRule] += wf.second;
+					break;
+				}
+			}
+			nProbes += (unsigned long long)std::min(nIdxRule + 1, nRules) * wf.second;
+			nLookups += wf.second;
+			nIdxWord += nConsumed;
+		}
+	}
+}
+
+
+
+bool reorder_ruleset(const VEC_WORDFREQ& words, VEC_RULEGROUPS& groups,
+		std::ostream& osLog)
+{
+	//start with the rules as they are
+	groups.assign(27, std::vector<TTSRule>());
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+	{
+		const TTSRule* pRule = _rules[nIdxGroup];
+		while (NULL != pRule->_bracket)
+			groups[nIdxGroup].push_back(*pRule++);
+		groups[nIdxGroup].push_back(*pRule);	//(the sentinel)
+	}
+
+	//how do they get used?
+	VEC_BYTE abyBlob;
+	make_compact_ruleset(abyBlob);
+	std::vector<std::vector<unsigned long> > hits;
+	unsigned long long nProbesBefore, nLookups;
+	countRuleHits(abyBlob, words, hits, nProbesBefore, nLookups);
+
+	VEC_RULEGROUPS reordered(27);
+	size_t nMoved = 0;
+	for (size_t nIdxGroup = 0; nIdxGroup < 27; ++nIdxGroup)
+	{
+		const std::vector<TTSRule>& group = groups[nIdxGroup];
+		size_t nRules = group.size() - 1;
+		std::vector<RuleShape> shapes;
+		for (size_t nIdxRule = 0; nIdxRule < nRules; ++nIdxRule)
+			shapes.push_back(ruleShape(group[nIdxRule]));
+
+		//a rule can go once every earlier rule it overlaps has gone
+		std::vector<size_t> anBlockers(nRules, 0);
+		std::vector<std::vector<size_t> > aBlocks(nRules);
+		for (size_t nIdxA = 0; nIdxA < nRules; ++nIdxA)
+		{
+			for (size_t nIdxB = nIdxA + 1; nIdxB < nRules; ++nIdxB)
+			{
+				if (rulesOverlap(shapes[nIdxA], shapes[nIdxB]))
+				{
+					aBlocks[nIdxA].push_back(nIdxB);
+					anBlockers[nIdxB] += 1;
+				}
+			}
+		}
+		//of those that can go, the most used goes first (ties in source order)
+		std::vector<bool> abDone(nRules, false);
+		for (size_t nPlaced = 0; nPlaced < nRules; ++nPlaced)
+		{
+			size_t nBest = nRules;
+			for (size_t nIdxRule = 0; nIdxRule < nRules; ++nIdxRule)
+			{
+				if (abDone[nIdxRule] || 0 != anBlockers[nIdxRule])
+					continue;
+				if (nRules == nBest || hits[nIdxGroup][nIdxRule] > hits[nIdxGroup][nBest])
+					nBest = nIdxRule;
+			}
+			abDone[nBest] = true;
+			for (size_t nIdxBlocked : aBlocks[nBest])
+				anBlockers[nIdxBlocked] -= 1;
+			if (nBest != nPlaced)
+				++nMoved;
+			reordered[nIdxGroup].push_back(group[nBest]);
+		}
+		reordered[nIdxGroup].push_back(group[nRules]);	//(the sentinel)
+	}
+
+	//prove it on the corpus
+	const TTSRule* apRules[27];
+	ruleGroupsArray(reordered, apRules);
+	VEC_BYTE abyReordered;
+	make_compact_ruleset(abyReordered, MCR_OPT_NONE, apRules);
+	for (const VEC_WORDFREQ::value_type& wf : words)
+	{
+		uint8_t abyBefore[256], abyAfter[256];
+		int nBefore = ttsWord(wf.first.c_str(), (int)wf.first.size(), abyBlob.data(),
+				abyBefore, sizeof(abyBefore));
+		int nAfter = ttsWord(wf.first.c_str(), (int)wf.first.size(), abyReordered.data(),
+				abyAfter, sizeof(abyAfter));
+		if (nBefore != nAfter || (nBefore > 0 && 0 != memcmp(abyBefore, abyAfter, nBefore)))
+		{
+			osLog << "reorder: differs on '" << wf.first << "'; keeping source order" << std::endl;
+			return false;
+		}
+	}
+
+	unsigned long long nProbesAfter;
+	countRuleHits(abyReordered, words, hits, nProbesAfter, nLookups);
+	osLog << "reorder: " << words.size() << " words, " << nMoved << " rules moved, " <<
+			"probes per lookup " << (nLookups ? (double)nProbesBefore / nLookups : 0) <<
+			" -> " << (nLookups ? (double)nProbesAfter / nLookups : 0) << std::endl;
+	groups.swap(reordered);
+	return true;
+}
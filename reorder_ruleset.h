@@ -0,0 +1,37 @@
+#ifndef __REORDER_RULESET_H
+#define __REORDER_RULESET_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "tts_rules.h"
+
+//a corpus of words and how often each occurs
+typedef std::vector<std::pair<std::string, unsigned long> >	VEC_WORDFREQ;
+
+//a modifiable copy of the rule groups, each terminated with the sentinel rule
+typedef std::vector<std::vector<TTSRule> >	VEC_RULEGROUPS;
+
+
+//read a word-frequency corpus.  Each line is a word, optionally followed by
+//whitespace and a count (1 if absent).  Words are lower-cased.
+bool loadWordFreq(const char* pszFile, VEC_WORDFREQ& words);
+
+
+//Within a group, only the relative order of rules that can match the same
+//input matters.  Given a corpus, reorder the rules of each group so that those
+//that fire most often come first, while keeping every pair that might overlap
+//in its original order.  The result is checked against the original order on
+//the corpus; if it differs in any way, the original order is returned instead
+//(and false).  What was done is written to osLog.
+bool reorder_ruleset(const VEC_WORDFREQ& words, VEC_RULEGROUPS& groups,
+		std::ostream& osLog);
+
+
+//the groups as an array suitable for make_compact_ruleset()
+void ruleGroupsArray(const VEC_RULEGROUPS& groups, const TTSRule* apRules[27]);
+
+
+#endif
@@ -0,0 +1,26 @@
+#include "sp0256.h"
+
+
+//(see the symbolic constants in tts_rules.c; the AH pseudo-phoneme is AX)
+const char* const g_apszSP0256Name[SP0256_ALLOPHONES] = {
+	"PA1", "PA2", "PA3", "PA4", "PA5", "OY",  "AY",  "EH",
+	"KK3", "PP",  "JH",  "NN1", "IH",  "TT2", "RR1", "AX",
+	"MM",  "TT1", "DH1", "IY",  "EY",  "DD1", "UW1", "AO",
+	"AA",  "YY2", "AE",  "HH1", "BB1", "TH",  "UH",  "UW2",
+	"AW",  "DD2", "GG3", "VV",  "GG1", "SH",  "ZH",  "RR2",
+	"FF",  "KK2", "KK1", "ZZ",  "NG",  "LL",  "WW",  "XR",
+	"WH",  "YY1", "CH",  "ER1", "ER2", "OW",  "DH2", "SS",
+	"NN2", "HH2", "OR",  "AR",  "YR",  "GG2", "EL",  "BB2",
+};
+
+
+const uint16_t g_anSP0256DurMs[SP0256_ALLOPHONES] = {
+	 10,  30,  50, 100, 200, 420, 260,  70,	//PA1..EH
+	120, 210, 140, 140,  70, 140, 170,  70,	//KK3..AX
+	180, 100, 290, 250, 280,  70, 100, 100,	//MM..AO
+	100, 180, 120, 130,  80, 180, 100, 260,	//AA..UW2
+	370, 160, 140, 190,  80, 160, 190, 120,	//AW..RR2
+	150, 190, 160, 210, 220, 110, 180, 360,	//FF..XR
+	200, 130, 190, 160, 300, 240, 240,  90,	//WH..SS
+	190, 180, 330, 290, 350,  40, 190,  50,	//NN2..BB2
+};
@@ -0,0 +1,38 @@
+
+
+#ifndef __SP0256_H
+#define __SP0256_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+
+//facts about the SP0256-AL2's 64 allophones, as produced by ttsWord.  These
+//are the same as documented with the symbolic constants in tts_rules.c (less
+//the +1 used there).
+
+#define SP0256_ALLOPHONES	64
+
+//symbolic name of each allophone, e.g. "HH1"
+extern const char* const g_apszSP0256Name[SP0256_ALLOPHONES];
+
+//nominal duration of each allophone, in milliseconds
+extern const uint16_t g_anSP0256DurMs[SP0256_ALLOPHONES];
+
+//the pauses are the first five allophones
+#define SP0256_PA1	0x00
+#define SP0256_PA2	0x01
+#define SP0256_PA3	0x02
+#define SP0256_PA4	0x03
+#define SP0256_PA5	0x04
+#define SP0256_ISPAUSE(by)	((by) <= SP0256_PA5)
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
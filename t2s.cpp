@@ -0,0 +1,527 @@
+// t2s.cpp : command line text-to-speech for Linux.  Reads text from stdin or
+//a file, and streams the phonemes to stdout.
+//
+//This is a separate program from text2speech001; build it with something like:
+//	g++ -O2 -o t2s t2s.cpp make_compact_ruleset.cpp text_to_speech.c tts_rules.c sp0256.c tts_blob.c tts_reload.cpp exception_dict.cpp tts_peephole.c tts_normalize.c tts_render.c
+//
+//Memory use is fixed regardless of the size of the input:  text goes through a
+//fixed buffer, from which whole words are converted (see ttsText) and the
+//trailing partial word is kept for the next fill.  A file is memory mapped,
+//but only read from, a window at a time, into that same buffer.
+//
+//To get per-rule statistics (-stats), also compile tts_stats.cpp and define
+//TTS_STATS for everything.
+//
+//Rather than compiling the rules at startup, a blob file made by
+//'text2speech001 -bin' can be mapped with -blob (see tts_blob.h); add
+//tts_blob.c and tts_reload.cpp to the build.  Sending the process SIGHUP then
+//reloads that file (e.g. after it has been replaced with a new one), between
+//one buffer of text and the next.  For -dict, add exception_dict.cpp.
+//
+//-peep merges the runs of pauses (see tts_peephole.h), and -maxpause also
+//limits them; add tts_peephole.c.
+//
+//-norm spells out numbers, money, and abbreviations on the way in (see
+//tts_normalize.h); add tts_normalize.c.
+//
+//-wav renders the phonemes to audio (see tts_render.h), into a .wav file,
+//instead of writing them to stdout; add tts_render.c.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <signal.h>
+
+#include "text_to_speech.h"
+#include "make_compact_ruleset.h"
+#include "sp0256.h"
+#include "tts_stats.h"
+#include "tts_blob.h"
+#include "tts_reload.h"
+#include "exception_dict.h"
+#include "tts_peephole.h"
+#include "tts_normalize.h"
+#include "tts_render.h"
+
+#include <fstream>
+
+
+enum T2S_FORMAT
+{
+	T2S_RAW,	//the phoneme bytes as-is
+	T2S_HEX,	//two hex digits each
+	T2S_NAMES,	//symbolic names, e.g. HH1 AE
+	T2S_RAW6,	//packed 6 bits to a phoneme (see ttsPhon6Pack)
+};
+
+
+//where text comes from:  either stdin, or a mapped file
+struct T2SSource
+{
+	int	fd;
+	const char*	pchMap;	//NULL if reading from fd
+	size_t	nMapLen;
+	size_t	nMapPos;
+};
+
+
+//get up to nLen more characters into pchBuf; 0 means end of input
+size_t readSource(T2SSource& src, char* pchBuf, size_t nLen)
+{
+	if (NULL != src.pchMap)
+	{
+		size_t nTake = src.nMapLen - src.nMapPos;
+		if (nTake > nLen)
+			nTake = nLen;
+		memcpy(pchBuf, &src.pchMap[src.nMapPos], nTake);
+		//we won't be back; let the kernel drop what we've read
+		size_t nPage = (size_t)sysconf(_SC_PAGESIZE);
+		size_t nDoneFrom = src.nMapPos / nPage * nPage;
+		src.nMapPos += nTake;
+		size_t nDoneTo = src.nMapPos / nPage * nPage;
+		if (nDoneTo > nDoneFrom)
+			madvise((void*)&src.pchMap[nDoneFrom], nDoneTo - nDoneFrom, MADV_DONTNEED);
+		return nTake;
+	}
+	for (;;)
+	{
+		ssize_t nRead = read(src.fd, pchBuf, nLen);
+		if (nRead >= 0)
+			return (size_t)nRead;
+		if (EINTR != errno)
+		{
+			perror("t2s: read");
+			return 0;
+		}
+	}
+}
+
+
+//write phonemes in the requested format.  nCol keeps track of where we are on
+//the line for the text formats, so that the output doesn't depend on how the
+//input happened to be buffered.
+void writePhonemes(const uint8_t* pbyPhon, size_t nLen, T2S_FORMAT eFormat,
+		size_t& nCol)
+{
+	if (T2S_RAW == eFormat)
+	{
+		fwrite(pbyPhon, 1, nLen, stdout);
+		return;
+	}
+	for (size_t nIdx = 0; nIdx < nLen; ++nIdx)
+	{
+		if (0 != nCol)
+			fputc(' ', stdout);
+		if (T2S_HEX == eFormat || pbyPhon[nIdx] >= SP0256_ALLOPHONES)
+			fprintf(stdout, "%02x", pbyPhon[nIdx]);
+		else
+			fputs(g_apszSP0256Name[pbyPhon[nIdx]], stdout);
+		if (++nCol == 16)
+		{
+			fputc('\n', stdout);
+			nCol = 0;
+		}
+	}
+}
+
+
+//write phonemes packed 6 bits to a phoneme, for archiving (e.g. a library of
+//prompts to ship to devices).  Only whole groups of four are written as we go;
+//the rest wait in abyHeld for more, or for the end (bEnd).  (There is no count;
+//if the last group is three, the reader will see a fourth, PA1, i.e. 10ms
+//more silence.)
+void writePacked(const uint8_t* pbyPhon, size_t nLen, VEC_BYTE& abyHeld, bool bEnd)
+{
+	abyHeld.insert(abyHeld.end(), pbyPhon, pbyPhon + nLen);
+	size_t nPack = bEnd ? abyHeld.size() : abyHeld.size() / 4 * 4;
+	VEC_BYTE abyPacked(TTS_PHON6_LEN(nPack));
+	ttsPhon6Pack(abyHeld.data(), nPack, abyPacked.data());
+	fwrite(abyPacked.data(), 1, abyPacked.size(), stdout);
+	abyHeld.erase(abyHeld.begin(), abyHeld.begin() + nPack);
+}
+
+
+//the header of a .wav file of nSamples 16-bit mono samples, at the renderer's
+//rate.  (It is written first with 0, and again at the end with the count.)
+void writeWavHeader(FILE* pFile, uint32_t nSamples)
+{
+	uint8_t abyHdr[44];
+	auto put32 = [&](size_t nAt, uint32_t n)
+			{
+				for (int nByte = 0; nByte < 4; ++nByte)
+					abyHdr[nAt + nByte] = (uint8_t)(n >> (8 * nByte));
+			};
+	memcpy(&abyHdr[0], "RIFF", 4);
+	put32(4, 36 + 2 * nSamples);
+	memcpy(&abyHdr[8], "WAVEfmt ", 8);
+	put32(16, 16);	//size of fmt
+	put32(20, 1 | (1 << 16));	//PCM, mono
+	put32(24, TTS_RENDER_RATE);
+	put32(28, 2 * TTS_RENDER_RATE);	//bytes/sec
+	put32(32, 2 | (16 << 16));	//bytes/sample, bits/sample
+	memcpy(&abyHdr[36], "data", 4);
+	put32(40, 2 * nSamples);
+	fwrite(abyHdr, 1, sizeof(abyHdr), pFile);
+}
+
+
+//render phonemes to audio, and write the samples out.  (They are written in
+//the host's byte order; a .wav is little-endian, as the hosts for this are.)
+void writeAudio(TTSRender& render, const uint8_t* pbyPhon, size_t nLen,
+		FILE* pFile, size_t& nSamples)
+{
+	int16_t anPCM[4096];
+	size_t nDone = 0;
+	while (nDone < nLen)
+	{
+		size_t nConsumed = 0;
+		size_t nOut = ttsRender(&render, &pbyPhon[nDone], nLen - nDone,
+				anPCM, sizeof(anPCM) / sizeof(anPCM[0]), &nConsumed);
+		fwrite(anPCM, sizeof(anPCM[0]), nOut, pFile);
+		nSamples += nOut;
+		nDone += nConsumed;
+	}
+}
+
+
+//set by SIGHUP; the blob file is to be reloaded
+static volatile sig_atomic_t g_bReload = 0;
+
+void onSIGHUP(int)
+{
+	g_bReload = 1;
+}
+
+
+//reload the blob file into the slot; if that fails, the old rules stay
+void reloadBlob(TTSRulesetSlot& slot, const char* pszBlob)
+{
+	int nErr;
+	TTSRuleset* pRuleset = ttsRulesetOpen(pszBlob, &nErr);
+	if (NULL == pRuleset)
+	{
+		std::cerr << pszBlob << ": " << ttsBlobErrorText(nErr) << "; not reloaded" << std::endl;
+		return;
+	}
+	ttsRulesetSwap(slot, pRuleset);
+#ifdef TTS_STATS
+	//(the rules are numbered differently now; count from here)
+	ttsStatsReset(ttsRulesetBlob(pRuleset));
+#endif
+	std::cerr << "t2s: reloaded " << pszBlob << std::endl;
+}
+
+
+void usage()
+{
+	std::cerr << "usage: t2s [-trie] [-ctxcode] [-prefilter] [-v2|-wide|-pack] [-phon6] [-dict words.txt] [-blob rules.bin] [-raw|-hex|-names|-raw6] [-buf n] [-peep [-maxpause ms]] [-norm] [-wav out.wav] [-stats out.csv|out.json] [file]" << std::endl <<
+		"  reads text from file (or stdin) and writes phonemes to stdout (or audio to out.wav)" << std::endl;
+}
+
+
+int main(int argc, char* argv[])
+{
+	unsigned int nOpts = MCR_OPT_NONE;
+	T2S_FORMAT eFormat = T2S_NAMES;
+	size_t nBufLen = 64 * 1024;
+	const char* pszFile = NULL;
+#ifdef TTS_STATS
+	const char* pszStats = NULL;
+#endif
+	const char* pszBlob = NULL;
+	const char* pszDict = NULL;
+	bool bPeep = false;
+	uint32_t nMaxPauseMs = 0;
+	bool bNorm = false;
+	const char* pszWav = NULL;
+	for (int nIdxArg = 1; nIdxArg < argc; ++nIdxArg)
+	{
+		std::string strArg(argv[nIdxArg]);
+		if ("-trie" == strArg)
+			nOpts |= MCR_OPT_TRIE;
+		else if ("-ctxcode" == strArg)
+			nOpts |= MCR_OPT_CTXCODE;
+		else if ("-prefilter" == strArg)
+			nOpts |= MCR_OPT_PREFILTER;
+		else if ("-v2" == strArg)
+			nOpts |= MCR_OPT_V2;
+		else if ("-wide" == strArg)
+			nOpts |= MCR_OPT_WIDE;
+		else if ("-pack" == strArg)
+			nOpts |= MCR_OPT_PACK;
+		else if ("-phon6" == strArg)
+			nOpts |= MCR_OPT_PHON6;
+		else if ("-raw" == strArg)
+			eFormat = T2S_RAW;
+		else if ("-hex" == strArg)
+			eFormat = T2S_HEX;
+		else if ("-names" == strArg)
+			eFormat = T2S_NAMES;
+		else if ("-raw6" == strArg)
+			eFormat = T2S_RAW6;
+		else if ("-dict" == strArg && nIdxArg + 1 < argc)
+			pszDict = argv[++nIdxArg];
+		else if ("-blob" == strArg && nIdxArg + 1 < argc)
+			pszBlob = argv[++nIdxArg];
+		else if ("-buf" == strArg && nIdxArg + 1 < argc)
+			nBufLen = strtoul(argv[++nIdxArg], NULL, 0);
+		else if ("-peep" == strArg)
+			bPeep = true;
+		else if ("-maxpause" == strArg && nIdxArg + 1 < argc)
+			nMaxPauseMs = strtoul(argv[++nIdxArg], NULL, 0);
+		else if ("-norm" == strArg)
+			bNorm = true;
+		else if ("-wav" == strArg && nIdxArg + 1 < argc)
+			pszWav = argv[++nIdxArg];
+#ifdef TTS_STATS
+		else if ("-stats" == strArg && nIdxArg + 1 < argc)
+			pszStats = argv[++nIdxArg];
+#endif
+		else if ('-' != strArg[0] && NULL == pszFile)
+			pszFile = argv[nIdxArg];
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (nBufLen < 16)
+		nBufLen = 16;
+
+	//the rules; either from a file, or compiled now
+	TTSRuleset* pRuleset;
+	int nErr;
+	if (NULL != pszBlob)
+	{
+		pRuleset = ttsRulesetOpen(pszBlob, &nErr);
+		if (NULL == pRuleset)
+		{
+			std::cerr << pszBlob << ": " << ttsBlobErrorText(nErr) << std::endl;
+			return 1;
+		}
+		signal(SIGHUP, onSIGHUP);
+	}
+	else
+	{
+		VEC_BYTE abyBlob;
+		MAP_EXCEPTIONS dict;
+		if (NULL != pszDict && !loadExceptionDict(pszDict, dict, std::cerr))
+			return 1;
+		if (!make_compact_ruleset(abyBlob, nOpts, NULL, &dict) ||
+				NULL == (pRuleset = ttsRulesetFromBlob(abyBlob, &nErr)))
+		{
+			std::cerr << "t2s: can't make the rules blob" << std::endl;
+			return 1;
+		}
+	}
+	TTSRulesetSlot slot;
+	ttsRulesetSlotInit(slot, pRuleset);
+#ifdef TTS_STATS
+	ttsStatsReset(ttsRulesetBlob(pRuleset));
+#endif
+
+	//open the input
+	T2SSource src = { 0, NULL, 0, 0 };
+	if (NULL != pszFile)
+	{
+		src.fd = open(pszFile, O_RDONLY);
+		if (src.fd < 0)
+		{
+			perror(pszFile);
+			return 1;
+		}
+		struct stat st;
+		if (0 == fstat(src.fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0)
+		{
+			void* pvMap = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, src.fd, 0);
+			if (MAP_FAILED != pvMap)
+			{
+				src.pchMap = (const char*)pvMap;
+				src.nMapLen = (size_t)st.st_size;
+				madvise(pvMap, src.nMapLen, MADV_SEQUENTIAL);
+			}
+		}
+		//(if it can't be mapped, e.g. a pipe, we just read it)
+	}
+
+	//and the output, if it is audio
+	FILE* pWav = NULL;
+	if (NULL != pszWav)
+	{
+		pWav = fopen(pszWav, "wb");
+		if (NULL == pWav)
+		{
+			perror(pszWav);
+			return 1;
+		}
+		writeWavHeader(pWav, 0);
+	}
+	TTSRender render;
+	ttsRenderInit(&render, 0);
+	size_t nSamples = 0;
+
+	//the text buffer holds [0,nHave) of pchText; the phoneme buffer is some
+	//multiple of it since a character can make several phonemes.  (With -norm
+	//there is always room for an expansion after a partial word, too.)  There
+	//is a space in front of it, because the rules look a character to the left
+	//of a word, and the first word may be at the very start.
+	std::vector<char> achText(1 + nBufLen + (bNorm ? TTS_NORM_MAXOUT : 0));
+	achText[0] = ' ';
+	char* pchText = &achText[1];
+	size_t nTextLen = achText.size() - 1;
+	VEC_BYTE abyPhon(nBufLen * 2);
+	VEC_BYTE abyPeep(abyPhon.size() + TTS_PEEPHOLE_MAXHELD);
+	TTSPeephole peep;
+	ttsPeepholeInit(&peep, nMaxPauseMs);
+	size_t nHave = 0;
+	size_t nCol = 0;
+	VEC_BYTE abyHeld;	//(for T2S_RAW6)
+	auto emit = [&](const uint8_t* pbyPhon, size_t nLen)
+			{
+				if (NULL != pWav)
+					writeAudio(render, pbyPhon, nLen, pWav, nSamples);
+				else if (T2S_RAW6 == eFormat)
+					writePacked(pbyPhon, nLen, abyHeld, false);
+				else
+					writePhonemes(pbyPhon, nLen, eFormat, nCol);
+			};
+	//with -norm, the text is read into achRaw and normalized from there
+	std::vector<char> achRaw(bNorm ? std::max(nBufLen, (size_t)TTS_NORM_MAXTOKEN) : 0);
+	size_t nRawHave = 0;
+	bool bRawEOF = false;
+	TTSNormalizer norm;
+	ttsNormalizeInit(&norm);
+	auto readText = [&](char* pchBuf, size_t nLen) -> size_t
+			{
+				if (!bNorm)
+					return readSource(src, pchBuf, nLen);
+				for (;;)
+				{
+					if (!bRawEOF && nRawHave < achRaw.size())
+					{
+						size_t nRead = readSource(src, &achRaw[nRawHave], achRaw.size() - nRawHave);
+						bRawEOF = (0 == nRead);
+						nRawHave += nRead;
+					}
+					int nConsumed = 0;
+					int nOut = ttsNormalize(&norm, achRaw.data(), (int)nRawHave, bRawEOF,
+							pchBuf, nLen, &nConsumed);
+					memmove(&achRaw[0], &achRaw[nConsumed], nRawHave - nConsumed);
+					nRawHave -= nConsumed;
+					if (0 != nOut || (bRawEOF && 0 == nRawHave))
+						return (size_t)nOut;
+				}
+			};
+	bool bEOF = false;
+	while (!bEOF || 0 != nHave)
+	{
+		if (!bEOF)
+		{
+			size_t nRead = readText(&pchText[nHave], nTextLen - nHave);
+			if (0 == nRead)
+			{
+				//a word has to be followed by something, so give the last one
+				//a bound.  (we always have at least a character of room here,
+				//since ttsText leaves at most a partial word.)
+				bEOF = true;
+				pchText[nHave++] = '\n';
+			}
+			nHave += nRead;
+		}
+
+		//convert what we can, with the rules as they are now
+		if (g_bReload)
+		{
+			g_bReload = 0;
+			reloadBlob(slot, pszBlob);
+		}
+		TTSRuleset* pRules = ttsRulesetAcquire(slot);
+		const uint8_t* pbyBlob = ttsRulesetBlob(pRules);
+		size_t nDone = 0;
+		for (;;)
+		{
+			int nConsumed = 0;
+			int nRet = ttsText(&pchText[nDone], (int)(nHave - nDone), pbyBlob,
+					abyPhon.data(), abyPhon.size(), &nConsumed);
+			if (nRet < 0)
+			{
+				//a single absurdly long word doesn't fit; skip over it
+				std::cerr << "t2s: word too long; skipped" << std::endl;
+				const char* pchStart;
+				const char* pchEnd;
+				pluckWord(&pchText[nDone], (int)(nHave - nDone), &pchStart, &pchEnd);
+				nConsumed = (int)(pchEnd - &pchText[nDone]);
+				nRet = 0;
+			}
+			if (bPeep)
+			{
+				nRet = ttsPeephole(&peep, abyPhon.data(), nRet, abyPeep.data());
+				emit(abyPeep.data(), nRet);
+			}
+			else
+				emit(abyPhon.data(), nRet);
+			nDone += nConsumed;
+			if (0 == nRet && 0 == nConsumed)
+				break;	//no more whole words
+		}
+		ttsRulesetRelease(pRules);
+
+		//keep the partial word for next time
+		memmove(&pchText[0], &pchText[nDone], nHave - nDone);
+		nHave -= nDone;
+		if (nHave >= nBufLen)
+		{
+			//a 'word' as big as the buffer; no choice but to drop it
+			std::cerr << "t2s: word too long; skipped" << std::endl;
+			nHave = 0;
+		}
+		if (bEOF)
+			nHave = 0;	//(only non-word characters can be left)
+	}
+	if (bPeep)
+		emit(abyPeep.data(), ttsPeepholeFlush(&peep, abyPeep.data()));
+	if (NULL != pWav)
+	{
+		//(the header can't count past 4GB, some 60 hours; a longer file says
+		//as much as it can)
+		if (0 == fseek(pWav, 0, SEEK_SET))
+			writeWavHeader(pWav, (uint32_t)std::min(nSamples, (size_t)0x7fffffe0));
+		fclose(pWav);
+	}
+	else if (T2S_RAW6 == eFormat)
+		writePacked(NULL, 0, abyHeld, true);
+	if (T2S_RAW != eFormat && T2S_RAW6 != eFormat && 0 != nCol)
+		fputc('\n', stdout);
+
+#ifdef TTS_STATS
+	if (NULL != pszStats)
+	{
+		TTSRuleset* pRules = ttsRulesetAcquire(slot);
+		const uint8_t* pbyBlob = ttsRulesetBlob(pRules);
+		std::ofstream ofs(pszStats);
+		std::string strStats(pszStats);
+		if (strStats.size() >= 5 && ".json" == strStats.substr(strStats.size() - 5))
+			ttsStatsWriteJSON(ofs, pbyBlob);
+		else
+			ttsStatsWriteCSV(ofs, pbyBlob);
+		ttsRulesetRelease(pRules);
+	}
+#endif
+
+	if (NULL != src.pchMap)
+		munmap((void*)src.pchMap, src.nMapLen);
+	if (NULL != pszFile)
+		close(src.fd);
+	ttsRulesetSlotFini(slot);
+	return 0;
+}
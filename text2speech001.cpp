@@ -3,12 +3,17 @@
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 
 #include "text_to_speech.h"
 #include "make_compact_ruleset.h"
+#include "reorder_ruleset.h"
+#include "tts_blob.h"
+#include "exception_dict.h"
 #include "tts_rules.h"
 
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <vector>
 #include <map>
@@ -127,15 +132,121 @@ strlongest: 8, binlongest: 13
 
 
 
-int main()
+int main(int argc, char* argv[])
 {
+	//options for what to put in the blob
+	unsigned int nOpts = MCR_OPT_NONE;
+	const char* pszProfile = NULL;
+	const char* pszBin = NULL;
+	const char* pszDict = NULL;
+	bool bTiming = false;
+	for (int nIdxArg = 1; nIdxArg < argc; ++nIdxArg)
+	{
+		std::string strArg(argv[nIdxArg]);
+		if ("-trie" == strArg)
+			nOpts |= MCR_OPT_TRIE;
+		else if ("-ctxcode" == strArg)
+			nOpts |= MCR_OPT_CTXCODE;
+		else if ("-prefilter" == strArg)
+			nOpts |= MCR_OPT_PREFILTER;
+		else if ("-v2" == strArg)
+			nOpts |= MCR_OPT_V2;
+		else if ("-wide" == strArg)
+			nOpts |= MCR_OPT_WIDE;
+		else if ("-pack" == strArg)
+			nOpts |= MCR_OPT_PACK;
+		else if ("-phon6" == strArg)
+			nOpts |= MCR_OPT_PHON6;
+		else if ("-dict" == strArg && nIdxArg + 1 < argc)
+			pszDict = argv[++nIdxArg];
+		else if ("-bin" == strArg && nIdxArg + 1 < argc)
+			pszBin = argv[++nIdxArg];
+		else if ("-profile" == strArg && nIdxArg + 1 < argc)
+			pszProfile = argv[++nIdxArg];
+		else if ("-timing" == strArg)
+			bTiming = true;
+		else
+		{
+			std::cerr << "usage: text2speech001 [-trie] [-ctxcode] [-prefilter] [-v2|-wide|-pack] [-phon6] [-profile wordfreq.txt] [-dict words.txt] [-bin rules.bin] [-timing]" << std::endl;
+			return 1;
+		}
+	}
+
+	//optionally, reorder the rules according to how they get used
+	VEC_RULEGROUPS groups;
+	const TTSRule* apRules[27];
+	const TTSRule* const* ppRules = NULL;
+	if (NULL != pszProfile)
+	{
+		VEC_WORDFREQ words;
+		if (!loadWordFreq(pszProfile, words))
+		{
+			std::cerr << "can't read " << pszProfile << std::endl;
+			return 1;
+		}
+		reorder_ruleset(words, groups, std::cerr);
+		ruleGroupsArray(groups, apRules);
+		ppRules = apRules;
+	}
+
+	//optionally, whole words to take out of the rules' hands
+	MAP_EXCEPTIONS dict;
+	if (NULL != pszDict && !loadExceptionDict(pszDict, dict, std::cerr))
+		return 1;
+
 	std::cout << "Hello World!\n";
 	analyze();
 
 	VEC_BYTE abyBlob;
-	make_compact_ruleset ( abyBlob );
+	MCRTimings timings = MCRTimings();
+	bool bMade = make_compact_ruleset ( abyBlob, nOpts, ppRules, &dict, &timings );
+	if (bTiming)
+	{
+		//how long each part took, in ms
+		std::cerr << std::fixed << std::setprecision(3) <<
+				"dedup " << timings._dDeDup * 1000 << std::endl <<
+				"data " << timings._dData * 1000 << std::endl <<
+				"rules " << timings._dRules * 1000 << std::endl <<
+				"trie " << timings._dTrie * 1000 << std::endl <<
+				"ctxcode " << timings._dCtxCode * 1000 << std::endl <<
+				"dict " << timings._dDict * 1000 << std::endl <<
+				"prefilter " << timings._dPrefilter * 1000 << std::endl <<
+				"total " << timings._dTotal * 1000 << std::endl;
+		std::cerr.unsetf(std::ios::floatfield);
+	}
+	if (!bMade)
+	{
+		//(it could be any of these that apply)
+		std::cerr << "can't make the blob:  ";
+		if (nOpts & MCR_OPT_PHON6)
+			std::cerr << "a phoneme doesn't fit in 6 bits (-phon6), or ";
+		if (!dict.empty())
+			std::cerr << "the dictionary can't be made (a word or its phonemes longer than 255), or ";
+		if (!(nOpts & MCR_OPT_PACK))
+			std::cerr << "a rule's string or phonemes are longer than 255 (use -pack), or ";
+		std::cerr << "the ruleset is too big for 16-bit offsets (use -wide, without -trie, -ctxcode, or -prefilter)" << std::endl;
+		return 1;
+	}
 	//std::cout << "bloblen: " << abyBlob.size() << std::endl;
 
+	//optionally, also write the blob as-is, for loading at run time
+	if (NULL != pszBin)
+	{
+		int nErr = ttsBlobValidate(abyBlob.data(), abyBlob.size());
+		if (TTS_BLOB_OK != nErr)
+		{
+			std::cerr << "blob doesn't validate: " << ttsBlobErrorText(nErr) << std::endl;
+			return 1;
+		}
+		std::ofstream ofs(pszBin, std::ios::binary);
+		ofs.write((const char*)abyBlob.data(), abyBlob.size());
+		if (!ofs)
+		{
+			std::cerr << "can't write " << pszBin << std::endl;
+			return 1;
+		}
+	}
+
 /**/
 	//now, whizz through the blob, and emit it as a C file
 
@@ -231,16 +342,18 @@ by the people, for the people, shall not perish from the earth.)";
 		{
 			_reconstitute_rule(abyBlob.data(), nSec, nRule, &rule);
 			std::cout << "  Rule " << nRule <<
-				" l: '" << std::string((const char* const) &rule._left[1], (size_t)rule._left[0]) <<
-				"', b: '" << std::string((const char* const)&rule._bracket[1], (size_t)rule._bracket[0]) <<
-				"', r: '" << std::string((const char* const)&rule._right[1], (size_t)rule._right[0]) <<
+				" l: '" << std::string((const char* const)rule._left, (size_t)rule._nLeft) <<
+				"', b: '" << std::string((const char* const)rule._bracket, (size_t)rule._nBracket) <<
+				"', r: '" << std::string((const char* const)rule._right, (size_t)rule._nRight) <<
 				"', p: '";
 			std::cout << std::hex << std::setfill('0');
-			for (int nIdxPhone = 1; nIdxPhone <= (size_t)rule._phone[0]; ++nIdxPhone)
+			uint8_t abyPhone[255];
+			_getRulePhone(&rule, abyPhone);
+			for (int nIdxPhone = 0; nIdxPhone < (size_t)rule._nPhone; ++nIdxPhone)
 			{
-				if (nIdxPhone > 1)
+				if (nIdxPhone > 0)
 					std::cout << " ";
-				std::cout << std::setw(2) << (unsigned)rule._phone[nIdxPhone];
+				std::cout << std::setw(2) << (unsigned)abyPhone[nIdxPhone];
 			}
 			std::cout << "'";
 			std::cout << std::dec;	//return to dec
@@ -23,6 +23,42 @@ typedef struct TTSRule {
 
 
 
+//optional instrumentation (see text_to_speech.h).  With TTS_STATS not defined
+//this all disappears.
+#ifdef TTS_STATS
+
+TTSStats g_ttsStats;
+
+//record a lookup in a section that tried nProbes rules and then took
+//nIdxRuleHit (or -1 if none matched), consuming nConsumed characters
+void _statLookup(const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect,
+		int nProbes, int nIdxRuleHit, int nConsumed)
+{
+	g_ttsStats._anSectCalls[nIdxRuleSect] += 1;
+	g_ttsStats._anSectProbes[nIdxRuleSect] += nProbes;
+	//each character consumed is counted, at its share of the probes (rounded up)
+	int nChars = (nConsumed > 0) ? nConsumed : 1;
+	int nPerChar = (nProbes + nChars - 1) / nChars;
+	g_ttsStats._anProbeHist[nPerChar < TTS_STATS_MAXPROBES ? nPerChar : TTS_STATS_MAXPROBES - 1] += nChars;
+	if (nIdxRuleHit >= 0)
+	{
+		//hits are kept by the rule's index in the whole blob
+		int nIdxRuleAll = _getRuleIndexAll(pbyTTSRulesBlob, nIdxRuleSect, nIdxRuleHit);
+		if ((uint32_t)nIdxRuleAll < g_ttsStats._nRuleHits)
+			g_ttsStats._anRuleHits[nIdxRuleAll] += 1;
+		else
+			g_ttsStats._nRuleHitsLost += 1;
+	}
+}
+
+#define TTS_STAT_LOOKUP(blob,sect,probes,hit,consumed)	_statLookup(blob,sect,probes,hit,consumed)
+#else
+#define TTS_STAT_LOOKUP(blob,sect,probes,hit,consumed)
+#endif
+
+
+
+
 //i.e., not is punctuation
 int _isAlpha ( char ch ) {
 	return ( ch >= 'a' && ch <= 'z' );
@@ -81,19 +117,243 @@ int _classifyChar ( char ch ) {
 
 
 
-int _matchLeft(const char* pszNormWord, size_t nWordLen, size_t nIdxWord, const uint8_t* abyCtx)
+//find the first character in [nIdx,nLen) whose class is a word character
+//(bWord nonzero) or is a non-word character (bWord zero), or nLen if none.
+//This is the plain version, which is what everything but x86 uses, and is the
+//reference for the vectorized ones below.
+size_t _scanClassScalar(const char* pszText, size_t nIdx, size_t nLen, int bWord)
 {
-	if (NULL == abyCtx || 0 == abyCtx[0])	//'anything'? (empty string)
+	while (nIdx < nLen && (0 != _classifyChar(pszText[nIdx])) != (0 != bWord))
+	{
+		nIdx += 1;
+	}
+	return nIdx;
+}
+
+
+
+//On x86 we can classify 16 (SSE2) or 32 (AVX2) characters at a time, and
+//find the boundary with a movemask and a count-trailing-zeroes.  AVX2 is
+//selected at runtime if the CPU has it.  (TTS_X86_SIMD is in the header.)
+#ifdef TTS_X86_SIMD
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TTS_TARGET_AVX2
+static __inline int _ctz32(uint32_t n) { unsigned long nIdx; _BitScanForward(&nIdx, n); return (int)nIdx; }
+#else
+#define TTS_TARGET_AVX2 __attribute__((target("avx2")))
+#define _ctz32(n) __builtin_ctz(n)
+#endif
+
+
+//a lane is all ones if the character is class 1 or 2
+static __inline __m128i _isWordChar16(__m128i vch)
+{
+	//letters:  fold to lower case, then a range check done as a signed compare
+	__m128i vlow = _mm_or_si128(vch, _mm_set1_epi8(0x20));
+	__m128i vbias = _mm_add_epi8(vlow, _mm_set1_epi8((char)(0x80 - 'a')));
+	__m128i vword = _mm_cmplt_epi8(vbias, _mm_set1_epi8((char)(0x80 + 26)));
+	//and the apostrophe and punctuation
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8('\'')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8('/')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8(',')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8(':')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8(';')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8('!')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8('-')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8('.')));
+	vword = _mm_or_si128(vword, _mm_cmpeq_epi8(vch, _mm_set1_epi8('?')));
+	return vword;
+}
+
+
+size_t _scanClassSSE2(const char* pszText, size_t nIdx, size_t nLen, int bWord)
+{
+	//we look for bits set in the mask, so flip it if we want non-word chars
+	uint32_t nFlip = bWord ? 0 : 0xffff;
+	while (nIdx + 16 <= nLen)
+	{
+		__m128i vch = _mm_loadu_si128((const __m128i*)&pszText[nIdx]);
+		uint32_t nBits = (uint32_t)_mm_movemask_epi8(_isWordChar16(vch)) ^ nFlip;
+		if (0 != nBits)
+			return nIdx + _ctz32(nBits);
+		nIdx += 16;
+	}
+	return _scanClassScalar(pszText, nIdx, nLen, bWord);
+}
+
+
+static __inline TTS_TARGET_AVX2 __m256i _isWordChar32(__m256i vch)
+{
+	//(exactly as _isWordChar16)
+	__m256i vlow = _mm256_or_si256(vch, _mm256_set1_epi8(0x20));
+	__m256i vbias = _mm256_add_epi8(vlow, _mm256_set1_epi8((char)(0x80 - 'a')));
+	__m256i vword = _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(0x80 + 26)), vbias);
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8('\'')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8('/')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8(',')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8(':')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8(';')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8('!')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8('-')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8('.')));
+	vword = _mm256_or_si256(vword, _mm256_cmpeq_epi8(vch, _mm256_set1_epi8('?')));
+	return vword;
+}
+
+
+TTS_TARGET_AVX2 size_t _scanClassAVX2(const char* pszText, size_t nIdx, size_t nLen, int bWord)
+{
+	uint32_t nFlip = bWord ? 0 : 0xffffffff;
+	while (nIdx + 32 <= nLen)
+	{
+		__m256i vch = _mm256_loadu_si256((const __m256i*)&pszText[nIdx]);
+		uint32_t nBits = (uint32_t)_mm256_movemask_epi8(_isWordChar32(vch)) ^ nFlip;
+		if (0 != nBits)
+			return nIdx + _ctz32(nBits);
+		nIdx += 32;
+	}
+	//(the compiler doesn't always clear the upper halves before a tail call;
+	//left dirty, every SSE instruction after, anywhere, pays for it)
+	_mm256_zeroupper();
+	return _scanClassSSE2(pszText, nIdx, nLen, bWord);
+}
+
+
+int _haveAVX2(void)
+{
+#ifdef _MSC_VER
+	int anInfo[4];
+	__cpuid(anInfo, 0);
+	if (anInfo[0] < 7)
+		return 0;
+	__cpuid(anInfo, 1);
+	if ((anInfo[2] & (1 << 27)) == 0 || (anInfo[2] & (1 << 28)) == 0)	//OSXSAVE, AVX
+		return 0;
+	if ((_xgetbv(0) & 6) != 6)	//OS saves the ymm registers
+		return 0;
+	__cpuidex(anInfo, 7, 0);
+	return 0 != (anInfo[1] & (1 << 5));
+#else
+	__builtin_cpu_init();
+	return 0 != __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
+
+
+#ifdef TTS_X86_SIMD
+
+typedef size_t (*PFN_SCANCLASS)(const char* pszText, size_t nIdx, size_t nLen, int bWord);
+
+//the scanner to use; picked on first use.  Several threads may be in here at
+//once (ttsDocument), so the pointer is read and written atomically; if two
+//race to pick it, they both pick the same thing, so either store is fine.
+static PFN_SCANCLASS _pfnScanClass = NULL;
+#ifdef _MSC_VER
+//(aligned pointer loads and stores are atomic on x86, and volatile keeps the
+//compiler from tearing or caching them)
+#define _loadScanClass()	(*(PFN_SCANCLASS volatile*)&_pfnScanClass)
+#define _storeScanClass(pfn)	(*(PFN_SCANCLASS volatile*)&_pfnScanClass = (pfn))
+#else
+#define _loadScanClass()	__atomic_load_n(&_pfnScanClass, __ATOMIC_RELAXED)
+#define _storeScanClass(pfn)	__atomic_store_n(&_pfnScanClass, (pfn), __ATOMIC_RELAXED)
+#endif
+
+size_t _scanClass(const char* pszText, size_t nIdx, size_t nLen, int bWord)
+{
+	PFN_SCANCLASS pfnScanClass = _loadScanClass();
+	if (NULL == pfnScanClass)
+	{
+		pfnScanClass = _haveAVX2() ? _scanClassAVX2 : _scanClassSSE2;
+		_storeScanClass(pfnScanClass);
+	}
+	return pfnScanClass(pszText, nIdx, nLen, bWord);
+}
+
+#else
+
+size_t _scanClass(const char* pszText, size_t nIdx, size_t nLen, int bWord)
+{
+	return _scanClassScalar(pszText, nIdx, nLen, bWord);
+}
+
+#endif
+
+
+
+//Filter TTS_PF_LANES rules at once with the prefilter's arrays (see
+//TTS_BLOB_EXT_PREFILTER), starting at the rule pbyLen is at.  abyText is the
+//first TTS_PF_CHARS of what is left of the word (0 past the end), and nRem is
+//how much is left (at most TTS_PF_MAXLEN).  returns a bit for each rule that
+//is still a candidate.
+uint32_t _prefilterScalar(const uint8_t* pbyLen, size_t nStride,
+		const uint8_t* abyText, int nRem)
+{
+	uint32_t nBits = 0;
+	for (int nIdxLane = 0; nIdxLane < TTS_PF_LANES; ++nIdxLane)
+	{
+		int nLen = pbyLen[nIdxLane];
+		int bCand = nLen <= nRem;
+		for (int nIdxChar = 0; bCand && nIdxChar < TTS_PF_CHARS && nIdxChar < nLen; ++nIdxChar)
+			bCand = pbyLen[(1 + nIdxChar) * nStride + nIdxLane] == abyText[nIdxChar];
+		nBits |= (uint32_t)bCand << nIdxLane;
+	}
+	return nBits;
+}
+
+#ifdef TTS_X86_SIMD
+uint32_t _prefilterSSE2(const uint8_t* pbyLen, size_t nStride,
+		const uint8_t* abyText, int nRem)
+{
+	//(lengths are at most TTS_PF_MAXLEN, so signed compares are fine)
+	__m128i vlen = _mm_loadu_si128((const __m128i*)pbyLen);
+	__m128i vcand = _mm_cmplt_epi8(vlen, _mm_set1_epi8((char)(nRem + 1)));
+	for (int nIdxChar = 0; nIdxChar < TTS_PF_CHARS; ++nIdxChar)
+	{
+		//the character matches, or the bracket is already done
+		__m128i vch = _mm_loadu_si128((const __m128i*)&pbyLen[(1 + nIdxChar) * nStride]);
+		__m128i vok = _mm_or_si128(_mm_cmpeq_epi8(vch, _mm_set1_epi8((char)abyText[nIdxChar])),
+				_mm_cmplt_epi8(vlen, _mm_set1_epi8((char)(nIdxChar + 1))));
+		vcand = _mm_and_si128(vcand, vok);
+	}
+	return (uint32_t)_mm_movemask_epi8(vcand);
+}
+#define _prefilter	_prefilterSSE2
+#define _lowestBit(n)	_ctz32(n)
+#else
+#define _prefilter	_prefilterScalar
+static int _lowestBit(uint32_t n)
+{
+	int nIdx = 0;
+	while (0 == (n & 1))
+	{
+		n >>= 1;
+		nIdx += 1;
+	}
+	return nIdx;
+}
+#endif
+
+
+
+int _matchLeft(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		const uint8_t* abyCtx, int nCtxLen)
+{
+	if (0 == nCtxLen)	//'anything'? (empty string)
 		return 1;
 
 	//OK we match this backwards from the end
 	int nIdxText = nIdxWord - 1;		//last char in text
-	int nIdxMatch = abyCtx[0] - 1;	//last char in pattern
+	int nIdxMatch = nCtxLen - 1;	//last char in pattern
 	//whiz over the context characters, consuming input from the end
 	while (nIdxMatch >= 0)
 	{
 		//try literals
-		char chThisCtx = (char)abyCtx[nIdxMatch + 1];	//+1 because length prefix
+		char chThisCtx = (char)abyCtx[nIdxMatch];
 		if (_isAlpha(chThisCtx) || '\'' == chThisCtx || ' ' == chThisCtx )
 		{
 			if (chThisCtx != pszNormWord[nIdxText])
@@ -154,18 +414,19 @@ int _matchLeft(const char* pszNormWord, size_t nWordLen, size_t nIdxWord, const
 
 
 
-int _matchRight(const char* pszNormWord, size_t nWordLen, size_t nIdxWord, const uint8_t* abyCtx)
+int _matchRight(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		const uint8_t* abyCtx, int nCtxLen)
 {
-	if (NULL == abyCtx || 0 == abyCtx[0])	//'anything'? (empty string)
+	if (0 == nCtxLen)	//'anything'? (empty string)
 		return 1;
 	//OK we match this forwards from the beginning
 	int nIdxText = nIdxWord;	//first char in text
 	int nIdxMatch = 0;		//first char in pattern
 	//whiz over the context characters, consuming input from the beginning
-	while (nIdxMatch < abyCtx[0])
+	while (nIdxMatch < nCtxLen)
 	{
 		//try literals
-		char chThisCtx = (char)abyCtx[nIdxMatch + 1];	//+1 because length prefix
+		char chThisCtx = (char)abyCtx[nIdxMatch];
 		if (_isAlpha(chThisCtx) || '\'' == chThisCtx || ' ' == chThisCtx )
 		{
 			if (chThisCtx != pszNormWord[nIdxText])
@@ -256,30 +517,227 @@ return 1;
 
 
 
+//match a precompiled context (see TTS_CTX_xxx).  This is the equivalent of
+//_matchLeft (nStep = -1, nIdxBound = 0) and _matchRight (nStep = 1,
+//nIdxBound = nWordLen), but driven by the bytecode and the class table that
+//precedes it in the extension, rather than by re-interpreting the context
+//string on every probe.
+int _matchCode(const char* pszNormWord, int nIdxStart, int nIdxBound, int nStep,
+		const uint8_t* pbyCode, const uint8_t* abyClass)
+{
+	//left contexts consume the text before the start; right ones from it
+	int nIdxText = (nStep < 0) ? nIdxStart - 1 : nIdxStart;
+	for (;;)
+	{
+		//(only ops that have an operand look at it, since code may end at the
+		//very end of the blob)
+		switch (pbyCode[0])
+		{
+		case TTS_CTX_END:
+			return 1;
+
+		case TTS_CTX_LIT:
+			if (pbyCode[1] != (uint8_t)pszNormWord[nIdxText])
+				return 0;
+			nIdxText += nStep;
+			pbyCode += 2;
+		break;
+
+		case TTS_CTX_ONE:
+			if (!(abyClass[(uint8_t)pszNormWord[nIdxText]] & pbyCode[1]))
+				return 0;
+			nIdxText += nStep;
+			pbyCode += 2;
+		break;
+
+		case TTS_CTX_ONEPLUS:
+			if (!(abyClass[(uint8_t)pszNormWord[nIdxText]] & pbyCode[1]))
+				return 0;
+			nIdxText += nStep;
+			//fallthrough to take the rest
+		case TTS_CTX_ZEROPLUS:
+			while (abyClass[(uint8_t)pszNormWord[nIdxText]] & pbyCode[1])
+				nIdxText += nStep;
+			pbyCode += 2;
+		break;
+
+		case TTS_CTX_BOUND:
+			if (nIdxStart != nIdxBound)	//nothing to that side
+				return 0;
+			pbyCode += 1;
+		break;
+
+		case TTS_CTX_ESUFFIX:	//(only compiled for right contexts)
+			if ('e' == pszNormWord[nIdxText])
+			{
+				nIdxText += 1;	//we will definitely take the e; now see if we can also consume an ly, r, s, or d
+				if ('l' == pszNormWord[nIdxText] && 'y' == pszNormWord[nIdxText + 1])
+					nIdxText += 2;
+				else if ('r' == pszNormWord[nIdxText] || 's' == pszNormWord[nIdxText] || 'd' == pszNormWord[nIdxText])
+					nIdxText += 1;
+			}
+			else if ('i' == pszNormWord[nIdxText])
+			{
+				nIdxText += 1;
+				if ('n' == pszNormWord[nIdxText])
+				{
+					if ('g' != pszNormWord[nIdxText + 1])
+						return 0;
+					nIdxText += 2;
+				}
+			}
+			else
+				return 0;
+			pbyCode += 1;
+		break;
+
+		default:	//TTS_CTX_FAIL, or horror unknown
+			return 0;
+		}
+	}
+}
+
+
+
+//match both precompiled contexts of a rule whose bracket spans
+//[nIdxWord,nIdxText).  'Anything' is very common, so check for that here.
+int _matchCodes(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		size_t nIdxText, const TTSRule_compact* rule)
+{
+	if (TTS_CTX_END != rule->_leftcode[0] &&
+			! _matchCode(pszNormWord, nIdxWord, 0, -1, rule->_leftcode, rule->_class))
+		return 0;
+	if (TTS_CTX_END != rule->_rightcode[0] &&
+			! _matchCode(pszNormWord, nIdxText, nWordLen, 1, rule->_rightcode, rule->_class))
+		return 0;
+	return 1;
+}
+
+
+
+//These are the accessors for the blob's structure, so that the rest need not
+//care whether it is the original form (16-bit offsets, no header) or v2 (see
+//text_to_speech.h).
+
+//is this a v2 blob?
+#ifdef TTS_BLOB_V1_ONLY
+#define _isBlobV2(pby)	0
+#else
+#define _isBlobV2(pby)	(0 == memcmp((pby), TTS_BLOB_MAGIC, 4))
+#endif
+
+//does this blob refer to its data with packed references?
+#ifdef TTS_BLOB_V1_ONLY
+#define _isBlobPacked(pby)	0
+#else
+#define _isBlobPacked(pby)	(_isBlobV2(pby) && 0 != ((pby)[5] & TTS_BLOB_V2_PACKED))
+#endif
+
+//are this blob's phonemes packed in 6 bits?
+#ifdef TTS_BLOB_V1_ONLY
+#define _isBlobPhone6(pby)	0
+#else
+#define _isBlobPhone6(pby)	(_isBlobV2(pby) && 0 != ((pby)[5] & TTS_BLOB_V2_PHON6))
+#endif
+
+
+//get the nIdx'th of an array of offsets nWidth bytes wide
+#ifdef TTS_BLOB_V1_ONLY
+#define _getOff(pby, nWidth, nIdx)	(((const uint16_t*)(pby))[nIdx])
+#else
+#define _getOff(pby, nWidth, nIdx)	((2 == (nWidth)) ? \
+		(uint32_t)((const uint16_t*)(pby))[nIdx] : ((const uint32_t*)(pby))[nIdx])
+#endif
+
+
+//get the group index (27+1 offsets), and the width of offsets in it and in
+//the rules.
+const uint8_t* _getGroupIndex(const uint8_t* pbyTTSRulesBlob, int* pnWidth)
+{
+	if (_isBlobV2(pbyTTSRulesBlob))
+	{
+		//it's right after the directory
+		*pnWidth = pbyTTSRulesBlob[5] & ~(TTS_BLOB_V2_PACKED | TTS_BLOB_V2_PHON6);
+		return &pbyTTSRulesBlob[TTS_BLOB_V2_HDRLEN +
+				((const uint16_t*)pbyTTSRulesBlob)[3] * TTS_BLOB_V2_DIRLEN];
+	}
+	*pnWidth = sizeof(uint16_t);
+	return pbyTTSRulesBlob;
+}
+
+
+//get a rule's reference to a string or phoneme sequence (the nIdxRef'th of its
+//four), as the start and length of the bytes.  pbyPacked is the start of the
+//data if the blob's references are packed, else NULL.
+void _getRef(const uint8_t* pbyTTSRulesBlob, const uint8_t* pbyPacked,
+		const uint8_t* pbyRule, int nWidth, int nIdxRef,
+		const uint8_t** ppby, uint8_t* pnLen)
+{
+	uint32_t nRef = _getOff(pbyRule, nWidth, nIdxRef);
+	if (NULL != pbyPacked)
+	{
+		//offset from the start of the data, and length
+		int nLenBits = TTS_BLOB_PACKED_LENBITS(nWidth);
+		*ppby = &pbyPacked[nRef >> nLenBits];
+		*pnLen = (uint8_t)(nRef & ((1 << nLenBits) - 1));
+	}
+	else
+	{
+		//length-prefixed
+		*pnLen = pbyTTSRulesBlob[nRef];
+		*ppby = &pbyTTSRulesBlob[nRef + 1];
+	}
+}
+
+
 //get the count of rules in a section.
 int _getRuleSectionLength(const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect)
 {
 	//the first section is the list of groups' offsets
-	uint16_t* pnGrpOff = (uint16_t*)pbyTTSRulesBlob;
+	int nWidth;
+	const uint8_t* pbyGrpIdx = _getGroupIndex(pbyTTSRulesBlob, &nWidth);
 	//nIdxRuleSect cannot be > 27, but we aren't going to check that here
 	//it's simply the difference between this section start and the next
-	uint16_t nThisOff = pnGrpOff[nIdxRuleSect];
-	uint16_t nNextOff = pnGrpOff[nIdxRuleSect + 1];
-	return (nNextOff - nThisOff) / (4*sizeof(uint16_t));
+	uint32_t nThisOff = _getOff(pbyGrpIdx, nWidth, nIdxRuleSect);
+	uint32_t nNextOff = _getOff(pbyGrpIdx, nWidth, nIdxRuleSect + 1);
+	return (nNextOff - nThisOff) / (4*nWidth);
+}
+
+
+//get the index of a rule among all the rules in the blob
+int _getRuleIndexAll(const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect, int nIdxRule)
+{
+	int nWidth;
+	const uint8_t* pbyGrpIdx = _getGroupIndex(pbyTTSRulesBlob, &nWidth);
+	return (_getOff(pbyGrpIdx, nWidth, nIdxRuleSect) - _getOff(pbyGrpIdx, nWidth, 0)) /
+			(4*nWidth) + nIdxRule;
 }
 
 
-/*
-//our definition of a 'compact' rule, which consist of length-prefixed data.
-//the first three are the 'context's and are ASCII text, the last is binary.
-typedef struct TTSRule_compact
+//get the offset of an optional extension in the blob, or 0 if it is absent.
+uint32_t _getBlobExtension(const uint8_t* pbyTTSRulesBlob, int nIdxExt)
 {
-	const uint8_t*	_left;
-	const uint8_t*	_bracket;
-	const uint8_t*	_right;
-	const uint8_t*	_phone;
-} TTSRule_compact;
-*/
+	if (_isBlobV2(pbyTTSRulesBlob))
+	{
+		//look it up in the directory
+		int nSects = ((const uint16_t*)pbyTTSRulesBlob)[3];
+		for (int nIdxSect = 0; nIdxSect < nSects; ++nIdxSect)
+		{
+			const uint8_t* pbyEntry = &pbyTTSRulesBlob[TTS_BLOB_V2_HDRLEN + nIdxSect * TTS_BLOB_V2_DIRLEN];
+			if (nIdxExt == ((const uint16_t*)pbyEntry)[0])
+				return ((const uint32_t*)pbyEntry)[1];
+		}
+		return 0;
+	}
+	uint16_t* pnGrpOff = (uint16_t*)pbyTTSRulesBlob;
+	//the first group follows the index, so its offset tells how long it is
+	int nIdxEntries = pnGrpOff[0] / sizeof(uint16_t);
+	if (nIdxExt >= nIdxEntries)
+		return 0;
+	return pnGrpOff[nIdxExt];
+}
+
+
 
 
 //given the rule blob, section, and index, 'reconstitute' the rule into a
@@ -288,16 +746,227 @@ void _reconstitute_rule ( const uint8_t* pbyTTSRulesBlob,
 		int nIdxRuleSect, int nIdxRule, TTSRule_compact* rule )
 {
 	//the first section is the list of groups' offsets
-	uint16_t* pnGrpOff = (uint16_t*)pbyTTSRulesBlob;
-	uint16_t nGroupOff = pnGrpOff[nIdxRuleSect];	//start of rule list
-	//the second section is the rules list, each rule is four offsets to
-	//length-prefixed data
-	uint16_t nRuleOff = nGroupOff + nIdxRule * 4 * sizeof(uint16_t);
-	uint16_t* pnRule = (uint16_t*)(&pbyTTSRulesBlob[nRuleOff]);
-	rule->_left = &pbyTTSRulesBlob[pnRule[0]];
-	rule->_bracket = &pbyTTSRulesBlob[pnRule[1]];
-	rule->_right = &pbyTTSRulesBlob[pnRule[2]];
-	rule->_phone = &pbyTTSRulesBlob[pnRule[3]];
+	int nWidth;
+	const uint8_t* pbyGrpIdx = _getGroupIndex(pbyTTSRulesBlob, &nWidth);
+	uint32_t nGroupOff = _getOff(pbyGrpIdx, nWidth, nIdxRuleSect);	//start of rule list
+	//the second section is the rules list, each rule is four references to
+	//the data
+	uint32_t nRuleOff = nGroupOff + nIdxRule * 4 * nWidth;
+	const uint8_t* pbyRule = &pbyTTSRulesBlob[nRuleOff];
+	const uint8_t* pbyPacked = _isBlobPacked(pbyTTSRulesBlob) ?
+			&pbyTTSRulesBlob[_getOff(pbyGrpIdx, nWidth, 27)] : NULL;
+	_getRef(pbyTTSRulesBlob, pbyPacked, pbyRule, nWidth, 0, &rule->_left, &rule->_nLeft);
+	_getRef(pbyTTSRulesBlob, pbyPacked, pbyRule, nWidth, 1, &rule->_bracket, &rule->_nBracket);
+	_getRef(pbyTTSRulesBlob, pbyPacked, pbyRule, nWidth, 2, &rule->_right, &rule->_nRight);
+	_getRef(pbyTTSRulesBlob, pbyPacked, pbyRule, nWidth, 3, &rule->_phone, &rule->_nPhone);
+	rule->_bPhone6 = _isBlobPhone6(pbyTTSRulesBlob);
+	//(see _reconstitute_ctxcode)
+	rule->_leftcode = NULL;
+	rule->_rightcode = NULL;
+	rule->_class = NULL;
+}
+
+
+//if the blob has precompiled contexts (at nOffCode), add a rule's to the
+//reconstituted rule.  This is separate so that the engine only bothers with it
+//for rules whose bracket has already matched.
+void _reconstitute_ctxcode ( const uint8_t* pbyTTSRulesBlob, uint32_t nOffCode,
+		int nIdxRuleSect, int nIdxRule, TTSRule_compact* rule )
+{
+	const uint8_t* pbyCode = &pbyTTSRulesBlob[nOffCode];
+	//after the class table are two code offsets per rule, in blob order
+	int nIdxRuleAll = _getRuleIndexAll(pbyTTSRulesBlob, nIdxRuleSect, nIdxRule);
+	uint16_t* pnCodeOff = (uint16_t*)&pbyCode[256 + nIdxRuleAll * 2*sizeof(uint16_t)];
+	rule->_leftcode = &pbyCode[pnCodeOff[0]];
+	rule->_rightcode = &pbyCode[pnCodeOff[1]];
+	rule->_class = pbyCode;
+}
+
+
+
+//copy nPhon of some phonemes in the blob, from the nFrom'th, unpacking them if
+//need be
+static __inline void _copyPhon(const uint8_t* pbyFrom, int bPhone6, size_t nFrom,
+		size_t nPhon, uint8_t* pbyPhon)
+{
+	if (bPhone6)
+		ttsPhon6Unpack(pbyFrom, nFrom, nPhon, pbyPhon);
+	else
+		memcpy(pbyPhon, &pbyFrom[nFrom], nPhon);
+}
+
+
+//get a rule's phonemes (all _nPhone of them), unpacked if need be
+void _getRulePhone(const TTSRule_compact* rule, uint8_t* pbyPhon)
+{
+	_copyPhon(rule->_phone, rule->_bPhone6, 0, rule->_nPhone, pbyPhon);
+}
+
+
+//Given a rule whose bracket context is already known to match the text in
+//[nIdxWord,nIdxText), see if the left and right contexts also match.  If so,
+//place the phonemes in the buffer (if they fit), update nPhonLen as per
+//_transforminput, and return nonzero.  If ppbyRulePhon isn't NULL, it is set
+//to the rule's phonemes (in the blob) whether or not they fit.
+int _applyRule(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		size_t nIdxText, const TTSRule_compact* rule,
+		uint8_t* pbyPhon, int* pnPhonLen, const uint8_t** ppbyRulePhon )
+{
+	if (NULL != rule->_leftcode)
+	{
+		//precompiled contexts
+		if ( ! _matchCodes(pszNormWord, nWordLen, nIdxWord, nIdxText, rule))
+			return 0;
+	}
+	else
+	{
+		//see if the left context matches
+		if ( ! _matchLeft(pszNormWord, nWordLen, nIdxWord, rule->_left, rule->_nLeft))
+			return 0;
+		//see if the right context matches
+		if ( ! _matchRight(pszNormWord, nWordLen, nIdxText, rule->_right, rule->_nRight))
+			return 0;
+	}
+	//match! push the associated phoneme sequence
+
+	if (*pnPhonLen >= rule->_nPhone )	//enough space?
+	{
+		_getRulePhone(rule, pbyPhon);
+	}
+	*pnPhonLen -= rule->_nPhone;	//reduce by what we took (or would have taken)
+	if (NULL != ppbyRulePhon)
+		*ppbyRulePhon = rule->_phone;
+
+	return 1;
+}
+
+
+
+//The trie extension starts with 27 16-bit offsets to the root node of each
+//rule group's trie.  All offsets in the trie are relative to the start of the
+//extension.  Each node is:
+//	uint16_t	offset of the node's candidate list
+//	uint16_t	count of candidates
+//	uint8_t		count of children
+//	uint8_t[]	children's characters (padded to make the total even)
+//	uint16_t[]	children's node offsets
+//A node's candidates are the (in-group) indices, in ascending order, of all the
+//rules whose bracket is a prefix of the text spelled by the path to that node.
+//So once we walk as deep as the text lets us, that node's list is precisely
+//the rules whose bracket matches, in their original order of precedence.
+int _transforminputTrie(const char* pszNormWord, size_t nWordLen, size_t nIdxWord, 
+		const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect,
+		uint32_t nOffTrie, uint32_t nOffCode,
+		uint8_t* pbyPhon, int* pnPhonLen, const uint8_t** ppbyRulePhon )
+{
+	int nConsumed = 1;	//we'll figure it out, but must always consume something
+	const uint8_t* pbyTrie = &pbyTTSRulesBlob[nOffTrie];
+	const uint8_t* pbyNode = &pbyTrie[((uint16_t*)pbyTrie)[nIdxRuleSect]];
+
+	//walk down as far as the text will take us
+	size_t nIdxText = nIdxWord;
+	while (nIdxText < nWordLen)
+	{
+		int nChildren = pbyNode[4];
+		const uint8_t* pbyChildChars = &pbyNode[5];
+		int nIdxChild = 0;
+		while (nIdxChild < nChildren && 
+				pbyChildChars[nIdxChild] != (uint8_t)pszNormWord[nIdxText])
+		{
+			nIdxChild += 1;
+		}
+		if (nIdxChild == nChildren)
+			break;	//can go no deeper
+		uint16_t* pnChildOff = (uint16_t*)&pbyNode[(5 + nChildren + 1) & ~1];
+		pbyNode = &pbyTrie[pnChildOff[nIdxChild]];
+		nIdxText += 1;
+	}
+
+	//try the candidates in order
+	uint16_t* pnCand = (uint16_t*)&pbyTrie[((uint16_t*)pbyNode)[0]];
+	int nCands = ((uint16_t*)pbyNode)[1];
+	TTSRule_compact rule;
+	int nIdxCand;
+	for (nIdxCand = 0; nIdxCand < nCands; ++nIdxCand)
+	{
+		_reconstitute_rule(pbyTTSRulesBlob, nIdxRuleSect, pnCand[nIdxCand], &rule);
+		if (0 != nOffCode)
+			_reconstitute_ctxcode(pbyTTSRulesBlob, nOffCode, nIdxRuleSect, pnCand[nIdxCand], &rule);
+		nIdxText = nIdxWord + rule._nBracket;
+		if (_applyRule(pszNormWord, nWordLen, nIdxWord, nIdxText, &rule,
+				pbyPhon, pnPhonLen, ppbyRulePhon))
+		{
+			nConsumed = nIdxText - nIdxWord;
+			break;
+		}
+	}
+	TTS_STAT_LOOKUP(pbyTTSRulesBlob, nIdxRuleSect,
+			nIdxCand < nCands ? nIdxCand + 1 : nCands,
+			nIdxCand < nCands ? pnCand[nIdxCand] : -1, (int)nConsumed);
+
+	return nConsumed;
+}
+
+
+
+//as _transforminput, but only trying the rules the prefilter (at nOffPF)
+//lets through
+int _transforminputPrefilter(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect, uint32_t nOffPF, uint32_t nOffCode,
+		uint8_t* pbyPhon, int* pnPhonLen, const uint8_t** ppbyRulePhon )
+{
+	int nConsumed = 1;	//we'll figure it out, but must always consume something
+	const uint8_t* pbyPF = &pbyTTSRulesBlob[nOffPF];
+	size_t nStride = ((const uint16_t*)pbyPF)[1];
+	const uint8_t* pbyLen = &pbyPF[2 * sizeof(uint16_t) +
+			_getRuleIndexAll(pbyTTSRulesBlob, nIdxRuleSect, 0)];
+	const uint8_t* pbyFlags = pbyLen + (1 + TTS_PF_CHARS) * nStride;
+
+	//what the filter compares with
+	uint8_t abyText[TTS_PF_CHARS];
+	for (int nIdxChar = 0; nIdxChar < TTS_PF_CHARS; ++nIdxChar)
+	{
+		abyText[nIdxChar] = (nIdxWord + nIdxChar < nWordLen) ?
+				(uint8_t)pszNormWord[nIdxWord + nIdxChar] : 0;
+	}
+	int nRem = (nWordLen - nIdxWord < TTS_PF_MAXLEN) ? (int)(nWordLen - nIdxWord) : TTS_PF_MAXLEN;
+
+	TTSRule_compact rule;
+	int nRuleSecLen = _getRuleSectionLength(pbyTTSRulesBlob, nIdxRuleSect);
+	int nProbes = 0;
+	int nIdxRuleHit = -1;
+	for (int nIdxBase = 0; nIdxBase < nRuleSecLen && nIdxRuleHit < 0; nIdxBase += TTS_PF_LANES)
+	{
+		uint32_t nBits = _prefilter(&pbyLen[nIdxBase], nStride, abyText, nRem);
+		if (nRuleSecLen - nIdxBase < TTS_PF_LANES)
+			nBits &= ((uint32_t)1 << (nRuleSecLen - nIdxBase)) - 1;	//(the next section's)
+		//try the candidates in order
+		for (; 0 != nBits; nBits &= nBits - 1)
+		{
+			int nIdxRule = nIdxBase + _lowestBit(nBits);
+			nProbes += 1;
+			_reconstitute_rule(pbyTTSRulesBlob, nIdxRuleSect, nIdxRule, &rule);
+			//(the filter only checked the start of the bracket)
+			size_t nIdxText = nIdxWord + rule._nBracket;
+			if (nIdxText > nWordLen ||
+					0 != memcmp(&pszNormWord[nIdxWord], rule._bracket, rule._nBracket))
+				continue;
+			//contexts that are 'anything' needn't be compiled
+			if (0 != nOffCode && (TTS_PF_LEFTANY|TTS_PF_RIGHTANY) !=
+					(pbyFlags[nIdxRule] & (TTS_PF_LEFTANY|TTS_PF_RIGHTANY)))
+				_reconstitute_ctxcode(pbyTTSRulesBlob, nOffCode, nIdxRuleSect, nIdxRule, &rule);
+			if ( ! _applyRule(pszNormWord, nWordLen, nIdxWord, nIdxText, &rule,
+					pbyPhon, pnPhonLen, ppbyRulePhon))
+				continue;
+			//match! update what we have consumed
+			nConsumed = nIdxText - nIdxWord;
+			nIdxRuleHit = nIdxRule;
+			break;
+		}
+	}
+	TTS_STAT_LOOKUP(pbyTTSRulesBlob, nIdxRuleSect, nProbes, nIdxRuleHit, (int)nConsumed);
+
+	return nConsumed;
 }
 
 
@@ -313,45 +982,75 @@ int _transforminput(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
 		const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect, 
 		uint8_t* pbyPhon, int* pnPhonLen )
 {
+	return _transforminputEx(pszNormWord, nWordLen, nIdxWord, pbyTTSRulesBlob,
+			nIdxRuleSect, pbyPhon, pnPhonLen, NULL);
+}
+
+
+//as _transforminput, but also setting *ppbyRulePhon (if not NULL) to the
+//matching rule's phonemes in the blob, so that a caller that ran out of room
+//can have them without looking again.  (Untouched if no rule matched.)
+int _transforminputEx(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect,
+		uint8_t* pbyPhon, int* pnPhonLen, const uint8_t** ppbyRulePhon )
+{
+	//precompiled contexts, if we have them
+	uint32_t nOffCode = _getBlobExtension(pbyTTSRulesBlob, TTS_BLOB_EXT_CTXCODE);
+
+	//if the blob has a trie, use that to go straight to the candidates
+	uint32_t nOffTrie = _getBlobExtension(pbyTTSRulesBlob, TTS_BLOB_EXT_TRIE);
+	if (0 != nOffTrie)
+	{
+		return _transforminputTrie(pszNormWord, nWordLen, nIdxWord,
+				pbyTTSRulesBlob, nIdxRuleSect, nOffTrie, nOffCode,
+				pbyPhon, pnPhonLen, ppbyRulePhon);
+	}
+
+	//or if it has a prefilter, use that to skip the rules that can't match
+	uint32_t nOffPF = _getBlobExtension(pbyTTSRulesBlob, TTS_BLOB_EXT_PREFILTER);
+	if (0 != nOffPF)
+	{
+		return _transforminputPrefilter(pszNormWord, nWordLen, nIdxWord,
+				pbyTTSRulesBlob, nIdxRuleSect, nOffPF, nOffCode,
+				pbyPhon, pnPhonLen, ppbyRulePhon);
+	}
+
+	//otherwise, the hard way
 	int nConsumed = 1;	//we'll figure it out, but must always consume something
 	TTSRule_compact rule;
 	int nRuleSecLen = _getRuleSectionLength(pbyTTSRulesBlob, nIdxRuleSect);
-	for (int nIdxRule = 0; nIdxRule < nRuleSecLen; ++nIdxRule)
+	int nIdxRule;
+	for (nIdxRule = 0; nIdxRule < nRuleSecLen; ++nIdxRule)
 	{
 		_reconstitute_rule(pbyTTSRulesBlob, nIdxRuleSect, nIdxRule, &rule);
 
 		//first, see if the 'bracket' context matches, by scanning forward
 		size_t nIdxText = nIdxWord;
 		size_t nIdxMatch = 0;
-		while (nIdxText < nWordLen && nIdxMatch < (size_t)rule._bracket[0])
+		while (nIdxText < nWordLen && nIdxMatch < (size_t)rule._nBracket)
 		{
 			//YYY must we consider metachars in bracket context? appears not
-			if (pszNormWord[nIdxText] != rule._bracket[nIdxMatch+1])	//+1 because length-prefix
+			if (pszNormWord[nIdxText] != rule._bracket[nIdxMatch])
 				break;
 			nIdxText += 1;
 			nIdxMatch += 1;
 		}
 		//if we didn't match all of the pattern, then it is not a match
-		if (nIdxMatch != (size_t)rule._bracket[0])
+		if (nIdxMatch != (size_t)rule._nBracket)
 			continue;
-		//see if the left context matches
-		if ( ! _matchLeft(pszNormWord, nWordLen, nIdxWord, rule._left))
-			continue;
-		//see if the right context matches
-		if ( ! _matchRight(pszNormWord, nWordLen, nIdxText, rule._right))
+		//see if the contexts match, and if so take the phonemes
+		if (0 != nOffCode)
+			_reconstitute_ctxcode(pbyTTSRulesBlob, nOffCode, nIdxRuleSect, nIdxRule, &rule);
+		if ( ! _applyRule(pszNormWord, nWordLen, nIdxWord, nIdxText, &rule,
+				pbyPhon, pnPhonLen, ppbyRulePhon))
 			continue;
-		//match! push the associated phoneme sequence, and update what we have consumed
-
-		if (*pnPhonLen >= rule._phone[0] )	//enough space?
-		{
-			memcpy(pbyPhon, &rule._phone[1], rule._phone[0]);
-			pbyPhon += rule._phone[0];	//advance
-		}
-		*pnPhonLen -= rule._phone[0];	//reduce by what we took (or would have taken)
-
+		//match! update what we have consumed
 		nConsumed = nIdxText - nIdxWord;
 		break;
 	}
+	TTS_STAT_LOOKUP(pbyTTSRulesBlob, nIdxRuleSect,
+			nIdxRule < nRuleSecLen ? nIdxRule + 1 : nRuleSecLen,
+			nIdxRule < nRuleSecLen ? nIdxRule : -1, (int)nConsumed);
 
 	return nConsumed;
 }
@@ -380,20 +1079,11 @@ int pluckWord(const char* pszText, int nTextLen,
 	size_t nIdxEnd = 0;
 
 	//skip leading non-chars
-	while ( nIdxStart < (size_t)nTextLen &&
-			0 == _classifyChar(pszText[nIdxStart]) )
-	{
-		nIdxStart += 1;
-	}
+	nIdxStart = _scanClass(pszText, 0, nTextLen, 1);
 
 	//print ( "gathering..." )
 	//gather until word break (or end)
-	nIdxEnd = nIdxStart;
-	while (nIdxEnd < (size_t)nTextLen &&
-			0 != _classifyChar(pszText[nIdxEnd]))
-	{
-		nIdxEnd += 1;
-	}
+	nIdxEnd = _scanClass(pszText, nIdxStart, nTextLen, 0);
 
 	*pchWordStart = &pszText[nIdxStart];
 	*pchWordEnd = &pszText[nIdxEnd];
@@ -417,6 +1107,64 @@ int pluckWord(const char* pszText, int nTextLen,
 
 
 
+//hash a word for the exception dictionary.  This is FNV-1a, but the seed is
+//mixed in at the start and the result is mixed at the end, since we use the
+//low bits (and FNV's are weak).  The compiler uses this too.
+uint32_t _hashDictWord(const char* pszNormWord, int nWordLen, uint32_t nSeed)
+{
+	uint32_t nHash = 2166136261u ^ (nSeed * 0x9e3779b9u);
+	for (int nIdx = 0; nIdx < nWordLen; ++nIdx)
+	{
+		nHash ^= (uint8_t)pszNormWord[nIdx];
+		nHash *= 16777619u;
+	}
+	nHash ^= nHash >> 16;
+	nHash *= 0x85ebca6bu;
+	nHash ^= nHash >> 13;
+	return nHash;
+}
+
+
+//find a whole word in the exception dictionary (see TTS_DICT_DIRECT).  returns
+//its entry's phonemes (length first), or NULL if it isn't there.
+const uint8_t* _findDict(const uint8_t* pbyDict, const char* pszNormWord, int nWordLen)
+{
+	const uint32_t* pnDict = (const uint32_t*)pbyDict;
+	uint32_t nSlots = pnDict[0];
+	uint32_t nBuckets = pnDict[1];
+	if (0 == nSlots || nWordLen > 255)
+		return NULL;
+	uint32_t nSeed = pnDict[2 + _hashDictWord(pszNormWord, nWordLen, 0) % nBuckets];
+	uint32_t nSlot = (nSeed & TTS_DICT_DIRECT) ? (nSeed & ~TTS_DICT_DIRECT) :
+			_hashDictWord(pszNormWord, nWordLen, nSeed) % nSlots;
+	const uint8_t* pbyEntry = &pbyDict[pnDict[2 + nBuckets + nSlot]];
+	if (pbyEntry[0] != nWordLen || 0 != memcmp(&pbyEntry[1], pszNormWord, nWordLen))
+		return NULL;	//not this word
+	return &pbyEntry[1 + nWordLen];
+}
+
+
+//look up a whole word in the exception dictionary.  If it is there, place its
+//phonemes in the buffer (if they fit), set *pnProduced as per ttsWord, and
+//return nonzero.  (bPhone6 is as per the blob; see TTS_BLOB_V2_PHON6.)
+int _lookupDict(const uint8_t* pbyDict, int bPhone6, const char* pszNormWord, int nWordLen,
+		uint8_t* pbyPhon, size_t nPhonLen, int* pnProduced)
+{
+	const uint8_t* pbyEntryPhon = _findDict(pbyDict, pszNormWord, nWordLen);
+	if (NULL == pbyEntryPhon)
+		return 0;
+	if (pbyEntryPhon[0] > nPhonLen)
+	{
+		*pnProduced = (int)nPhonLen - pbyEntryPhon[0];	//how much /more/ is needed
+		return 1;
+	}
+	_copyPhon(&pbyEntryPhon[1], bPhone6, 0, pbyEntryPhon[0], pbyPhon);
+	*pnProduced = pbyEntryPhon[0];
+	return 1;
+}
+
+
+
 //convert a word to speech.  the word must have already been normalized to
 //lower case!  returns the number of phonemes produced.
 int ttsWord(const char* pszNormWord, int nWordLen,
@@ -427,6 +1175,15 @@ int ttsWord(const char* pszNormWord, int nWordLen,
 	{
 		nWordLen = strlen(pszNormWord);
 	}
+	//a word in the exception dictionary doesn't need the rules at all
+	uint32_t nOffDict = _getBlobExtension(pbyTTSRulesBlob, TTS_BLOB_EXT_DICT);
+	if (0 != nOffDict)
+	{
+		int nProduced;
+		if (_lookupDict(&pbyTTSRulesBlob[nOffDict], _isBlobPhone6(pbyTTSRulesBlob),
+				pszNormWord, nWordLen, pbyPhon, nPhonLen, &nProduced))
+			return nProduced;
+	}
 	//scan the juicy bits
 	int nProduced = 0;
 	int nIdxWord = 0;
@@ -469,3 +1226,214 @@ int ttsWord(const char* pszNormWord, int nWordLen,
 	return nProduced;
 }
 
+
+
+void ttsWordStateInit(TTSWordState* pState)
+{
+	pState->_nIdxWord = 0;
+	pState->_pbyPending = NULL;
+	pState->_nPending = 0;
+	pState->_nSent = 0;
+	pState->_bStarted = 0;
+	pState->_bDone = 0;
+}
+
+
+//This is ttsWord's loop, except that a rule whose phonemes don't fit puts what
+//it can in the buffer and leaves the rest pending in the state (as a pointer
+//into the blob), rather than carrying on only to count.  The next call sends
+//those first and then carries on with the next rule.
+int ttsWordResume(TTSWordState* pState,
+		const char* pszNormWord, int nWordLen,
+		const uint8_t* pbyTTSRulesBlob,
+		uint8_t* pbyPhon, size_t nPhonLen)
+{
+	if (nWordLen < 0)
+	{
+		nWordLen = strlen(pszNormWord);
+	}
+	if ( ! pState->_bStarted )
+	{
+		pState->_bStarted = 1;
+		//a word in the exception dictionary is all pending, and has no rules
+		uint32_t nOffDict = _getBlobExtension(pbyTTSRulesBlob, TTS_BLOB_EXT_DICT);
+		const uint8_t* pbyEntryPhon = (0 == nOffDict) ? NULL :
+				_findDict(&pbyTTSRulesBlob[nOffDict], pszNormWord, nWordLen);
+		if (NULL != pbyEntryPhon)
+		{
+			pState->_pbyPending = &pbyEntryPhon[1];
+			pState->_nPending = pbyEntryPhon[0];
+			pState->_nIdxWord = nWordLen;
+		}
+	}
+	int bPhone6 = _isBlobPhone6(pbyTTSRulesBlob);
+	int nProduced = 0;
+	for (;;)
+	{
+		//first, what's left of the last rule
+		if (pState->_nSent != pState->_nPending)
+		{
+			int nTake = (int)nPhonLen - nProduced;
+			if (nTake > pState->_nPending - pState->_nSent)
+				nTake = pState->_nPending - pState->_nSent;
+			_copyPhon(pState->_pbyPending, bPhone6, pState->_nSent, nTake, &pbyPhon[nProduced]);
+			nProduced += nTake;
+			pState->_nSent += nTake;
+			if (pState->_nSent != pState->_nPending)
+				break;	//the buffer is full
+		}
+		if (pState->_nIdxWord >= nWordLen)
+		{
+			pState->_bDone = 1;
+			break;
+		}
+
+		//use the first character to skip to a section of rules
+		char chNow = (char)tolower(pszNormWord[pState->_nIdxWord]);
+		int nIdxRuleSect = _isAlpha(chNow) ? chNow - 'a' + 1 : 0;
+
+		int nRemBefore = (int)nPhonLen - nProduced;
+		int nRemAfter = nRemBefore;
+		const uint8_t* pbyRulePhon = NULL;
+		pState->_nIdxWord += _transforminputEx(pszNormWord, nWordLen, pState->_nIdxWord,
+				pbyTTSRulesBlob, nIdxRuleSect, &pbyPhon[nProduced], &nRemAfter, &pbyRulePhon);
+		if (nRemAfter < 0)	//didn't fit; all of it is pending (sent above)
+		{
+			pState->_pbyPending = pbyRulePhon;
+			pState->_nPending = nRemBefore - nRemAfter;
+			pState->_nSent = 0;
+		}
+		else
+		{
+			nProduced += nRemBefore - nRemAfter;
+		}
+	}
+
+	return nProduced;
+}
+
+
+
+//convert a whole buffer of text to speech.  This is the same as plucking each
+//word, lower-casing it, and calling ttsWord, but all in one pass and with the
+//lower-casing done in place.  Only complete words are converted (as per
+//pluckWord).  returns the number of phonemes produced, and sets *pnConsumed.
+int ttsText(char* pszText, int nTextLen,
+		const uint8_t* pbyTTSRulesBlob,
+		uint8_t* pbyPhon, size_t nPhonLen,
+		int* pnConsumed)
+{
+	if (nTextLen < 0)
+	{
+		nTextLen = strlen(pszText);
+	}
+	int nProduced = 0;
+	int nConsumed = 0;
+	int nIdxText = 0;
+	for (;;)
+	{
+		//skip leading non-chars
+		nIdxText = (int)_scanClass(pszText, nIdxText, nTextLen, 1);
+		if (nIdxText == nTextLen)
+		{
+			nConsumed = nTextLen;	//no word; discard the whole buffer
+			break;
+		}
+
+		//gather until word break (or end), then normalize it
+		int nIdxStart = nIdxText;
+		nIdxText = (int)_scanClass(pszText, nIdxText, nTextLen, 0);
+		for (int nIdxFold = nIdxStart; nIdxFold < nIdxText; ++nIdxFold)
+		{
+			if (pszText[nIdxFold] >= 'A' && pszText[nIdxFold] <= 'Z')
+				pszText[nIdxFold] += 'a' - 'A';
+		}
+		if (nIdxText == nTextLen)
+		{
+			nConsumed = nIdxStart;	//partial word; leave it for next time
+			break;
+		}
+
+		//do the word directly from the buffer
+		int nRet = ttsWord(&pszText[nIdxStart], nIdxText - nIdxStart,
+				pbyTTSRulesBlob, &pbyPhon[nProduced], nPhonLen - nProduced);
+		if (nRet < 0)
+		{
+			//doesn't fit; stop before this word.  if it's the first, tell how
+			//much more space is needed, just like ttsWord.
+			nConsumed = nIdxStart;
+			if (0 == nProduced)
+				nProduced = nRet;
+			break;
+		}
+		nProduced += nRet;
+		nConsumed = nIdxText;
+	}
+
+	if (NULL != pnConsumed)
+		*pnConsumed = nConsumed;
+	return nProduced;
+}
+
+
+
+//(see TTS_PHON6_LEN)  Whole groups of four are done as such, with no
+//branches, so that they can be vectorized.
+size_t ttsPhon6Pack(const uint8_t* pbyPhon, size_t nPhon, uint8_t* pbyPacked)
+{
+	size_t nGroups = nPhon / 4;
+	for (size_t nIdxGroup = 0; nIdxGroup < nGroups; ++nIdxGroup)
+	{
+		const uint8_t* pbyIn = &pbyPhon[nIdxGroup * 4];
+		uint32_t nBits = (uint32_t)(pbyIn[0] & 0x3f) | (uint32_t)(pbyIn[1] & 0x3f) << 6 |
+				(uint32_t)(pbyIn[2] & 0x3f) << 12 | (uint32_t)(pbyIn[3] & 0x3f) << 18;
+		uint8_t* pbyOut = &pbyPacked[nIdxGroup * 3];
+		pbyOut[0] = (uint8_t)nBits;
+		pbyOut[1] = (uint8_t)(nBits >> 8);
+		pbyOut[2] = (uint8_t)(nBits >> 16);
+	}
+	//the last, partial, group
+	size_t nTail = nPhon - nGroups * 4;
+	if (0 != nTail)
+	{
+		uint32_t nBits = 0;
+		for (size_t nIdx = 0; nIdx < nTail; ++nIdx)
+			nBits |= (uint32_t)(pbyPhon[nGroups * 4 + nIdx] & 0x3f) << (6 * nIdx);
+		for (size_t nIdx = 0; nIdx < TTS_PHON6_LEN(nTail); ++nIdx)
+			pbyPacked[nGroups * 3 + nIdx] = (uint8_t)(nBits >> (8 * nIdx));
+	}
+	return TTS_PHON6_LEN(nPhon);
+}
+
+
+//get the nIdx'th packed phoneme
+static __inline uint8_t _phon6At(const uint8_t* pbyPacked, size_t nIdx)
+{
+	size_t nBit = nIdx * 6;
+	unsigned int nBits = pbyPacked[nBit / 8];
+	if ((nBit % 8) > 2)	//(straddles two bytes)
+		nBits |= (unsigned int)pbyPacked[nBit / 8 + 1] << 8;
+	return (uint8_t)((nBits >> (nBit % 8)) & 0x3f);
+}
+
+
+void ttsPhon6Unpack(const uint8_t* pbyPacked, size_t nFrom, size_t nPhon, uint8_t* pbyPhon)
+{
+	//one at a time up to a group boundary, then by groups, then the rest
+	size_t nIdx = nFrom;
+	size_t nEnd = nFrom + nPhon;
+	for (; nIdx < nEnd && 0 != nIdx % 4; ++nIdx)
+		*pbyPhon++ = _phon6At(pbyPacked, nIdx);
+	for (; nIdx + 4 <= nEnd; nIdx += 4)
+	{
+		const uint8_t* pbyIn = &pbyPacked[nIdx / 4 * 3];
+		uint32_t nBits = (uint32_t)pbyIn[0] | (uint32_t)pbyIn[1] << 8 | (uint32_t)pbyIn[2] << 16;
+		pbyPhon[0] = (uint8_t)(nBits & 0x3f);
+		pbyPhon[1] = (uint8_t)((nBits >> 6) & 0x3f);
+		pbyPhon[2] = (uint8_t)((nBits >> 12) & 0x3f);
+		pbyPhon[3] = (uint8_t)(nBits >> 18);
+		pbyPhon += 4;
+	}
+	for (; nIdx < nEnd; ++nIdx)
+		*pbyPhon++ = _phon6At(pbyPacked, nIdx);
+}
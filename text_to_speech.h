@@ -38,26 +38,248 @@ int pluckWord(const char* pszText, int nTextLen,
 
 
 //convert a word to speech.  the word must have already been normalized to
-//lower case!  returns the number of phonemes produced.
+//lower case!  The rules look at the text around the word, so the characters
+//just before and after it must be readable (as they are in the text it was
+//plucked from).  returns the number of phonemes produced.
 int ttsWord(const char* pszNormWord, int nWordLen,	//the text
 		const uint8_t* pbyTTSRulesBlob,				//the rules blob
 		uint8_t* pbyPhon, size_t nPhonLen );		//the speech
 
 
+//convert a word to speech a buffer at a time.  Where ttsWord, when the
+//phonemes don't all fit, can only say how much more room is needed (so that
+//the word has to be done again from the start), this fills the buffer and
+//stops, and the next call carries on exactly where it left off, in the middle
+//of a rule's phonemes if need be.  The state is the caller's; initialize it
+//with ttsWordStateInit before the first call for each word, and keep calling
+//(with the same word and blob) until _bDone:
+//	TTSWordState state;
+//	ttsWordStateInit(&state);
+//	while ( ! state._bDone )
+//		send(abyPhon, ttsWordResume(&state, pszWord, nLen, pbyBlob, abyPhon, sizeof(abyPhon)));
+//returns the number of phonemes placed in the buffer this time.
+typedef struct TTSWordState
+{
+	int	_nIdxWord;	//where in the word the next rule is to be found
+	const uint8_t*	_pbyPending;	//phonemes of the last rule (in the blob)
+	int	_nPending;	//how many it has
+	int	_nSent;	//and how many of them have been sent
+	int	_bStarted;	//the exception dictionary has been checked
+	int	_bDone;	//the whole word has been sent
+} TTSWordState;
+void ttsWordStateInit(TTSWordState* pState);
+int ttsWordResume(TTSWordState* pState,				//where we were
+		const char* pszNormWord, int nWordLen,		//the text
+		const uint8_t* pbyTTSRulesBlob,				//the rules blob
+		uint8_t* pbyPhon, size_t nPhonLen );		//the speech
+
+
+//convert a whole buffer of text to speech.  This does the pluckWord/ttsWord
+//loop for you:  the words are lower-cased in place (so the buffer must be
+//writable) and converted directly from it.  Only complete words are done (see
+//pluckWord), and conversion stops before a word whose phonemes will not fit.
+//returns the number of phonemes produced (or, if not even the first word
+//fits, the negative of how much more space it needs, as per ttsWord), and sets
+//*pnConsumed to how much of the text can be discarded.
+//The rules look a character to the left of a word, and the first word may be
+//at the very start, so at least one readable character must come before
+//pszText:  the text before it, or (at the start of a buffer) e.g. a space.
+int ttsText(char* pszText, int nTextLen,			//the text
+		const uint8_t* pbyTTSRulesBlob,				//the rules blob
+		uint8_t* pbyPhon, size_t nPhonLen,			//the speech
+		int* pnConsumed );							//how much text was done
+
+
+//The allophones are 0..63, so they fit in 6 bits; packed, four take three
+//bytes instead of four.  This is for phonemes at rest:  a blob's phoneme data
+//(MCR_OPT_PHON6), cached words, and archived utterances.  Phoneme i is bits
+//[6i,6i+6) of the bytes taken as one little-endian number; i.e. each group of
+//four, a b c d, is the three bytes a|b<<6, b>>2|c<<4, c>>4|d<<2.  The last
+//group is only as many bytes as it needs.
+#define TTS_PHON6_LEN(nPhon)	(((nPhon) * 3 + 3) / 4)	//bytes for nPhon phonemes
+
+//pack nPhon phonemes (each must be less than 64).  returns the bytes written,
+//TTS_PHON6_LEN(nPhon).
+size_t ttsPhon6Pack(const uint8_t* pbyPhon, size_t nPhon, uint8_t* pbyPacked);
+
+//unpack nPhon phonemes, starting with the nFrom'th of those packed.
+void ttsPhon6Unpack(const uint8_t* pbyPacked, size_t nFrom, size_t nPhon, uint8_t* pbyPhon);
+
+
+//The rules blob begins with an index of 16-bit offsets:  one for each of the
+//27 rule groups, plus one more marking the end of the last group.  The
+//compiler may append optional 'extension' offsets after those.  How many index
+//entries there are is implied by the first entry (the first group immediately
+//follows the index), so an older blob simply has none.  An extension offset of
+//0 means that extension is not present.
+#define TTS_BLOB_EXT_TRIE	28	//per-section trie over the bracket strings
+#define TTS_BLOB_EXT_CTXCODE	29	//precompiled left/right contexts
+#define TTS_BLOB_EXT_DICT	30	//exception dictionary of whole words
+#define TTS_BLOB_EXT_PREFILTER	31	//per-rule bracket summaries, as arrays
+
+//A 'v2' blob instead starts with a header:
+//	uint8_t[4]	magic TTS_BLOB_MAGIC
+//	uint8_t		version (2)
+//	uint8_t		width of the offsets in the group index and rules (2 or 4),
+//			plus TTS_BLOB_V2_PACKED if the rules' references are packed,
+//			and TTS_BLOB_V2_PHON6 if the phonemes are
+//	uint16_t	count of sections
+//followed by a directory with an entry for each section:
+//	uint16_t	section id (TTS_BLOB_SECT_xxx, or TTS_BLOB_EXT_xxx)
+//	uint16_t	(reserved)
+//	uint32_t	offset of the section from the start of the blob
+//	uint32_t	length of the section
+//The group index immediately follows the directory, and is the 27+1 entries as
+//above; then the rules, and the data, just as in the original form, except for
+//the width of the offsets.  Extensions are found via the directory instead of
+//the group index.  The magic can't be mistaken for the original form, whose
+//first 16-bit offset is always even.  Define TTS_BLOB_V1_ONLY to leave out
+//support for v2 (e.g. on the MCU).
+//With TTS_BLOB_V2_PACKED, the data isn't length-prefixed, and strings can share
+//bytes (e.g. 'ing' can be the end of 'ring').  Instead, each of a rule's four
+//references is the offset from the start of the data, shifted left by
+//TTS_BLOB_PACKED_LENBITS, or'd with the length.
+//With TTS_BLOB_V2_PHON6, all the phoneme sequences (the rules', and the
+//exception dictionary's) are packed 6 bits to a phoneme (see ttsPhon6Pack).
+//Their lengths are still counts of phonemes; what follows is only
+//TTS_PHON6_LEN of that many bytes.
+#define TTS_BLOB_MAGIC	"\xa5TSB"
+#define TTS_BLOB_V2_HDRLEN	8
+#define TTS_BLOB_V2_DIRLEN	12
+#define TTS_BLOB_V2_PACKED	0x80
+#define TTS_BLOB_V2_PHON6	0x40
+#define TTS_BLOB_PACKED_LENBITS(nWidth)	((2 == (nWidth)) ? 4 : 8)
+#define TTS_BLOB_SECT_GROUPS	0x100	//the group index
+#define TTS_BLOB_SECT_RULES	0x101	//the rules
+#define TTS_BLOB_SECT_DATA	0x102	//the strings and phoneme sequences
+
+//the precompiled contexts are a little bytecode.  Each op is one byte, some
+//followed by a one-byte operand.  Left contexts are compiled back-to-front,
+//since they are matched backwards from the bracket.
+#define TTS_CTX_END		0	//end of context; it matched
+#define TTS_CTX_LIT		1	//(ch) literal character
+#define TTS_CTX_ONE		2	//(mask) one char of the class(es)
+#define TTS_CTX_ONEPLUS	3	//(mask) one or more chars of the class(es)
+#define TTS_CTX_ZEROPLUS	4	//(mask) zero or more chars of the class(es)
+#define TTS_CTX_BOUND	5	//'$' beginning or end of the word
+#define TTS_CTX_ESUFFIX	6	//'%' -e, -ed, -er, -es, -ely, -ing
+#define TTS_CTX_FAIL	7	//something that can never match
+//character class bits, as used in the 256-entry class table and the masks
+#define TTS_CLS_VOWEL	0x01	//'#'
+#define TTS_CLS_CONSONANT	0x02	//':' and '^'
+#define TTS_CLS_VOICED	0x04	//'.'
+#define TTS_CLS_FRONT	0x08	//'+'
+
+//The exception dictionary is whole words, and their phonemes, to be used
+//instead of the rules.  A word is found with a minimal perfect hash ('hash and
+//displace'):  its hash with seed 0 picks a bucket, and that bucket's seed picks
+//the word's slot (as its hash with that seed, or if TTS_DICT_DIRECT is set, the
+//slot itself).  The slot's entry is then compared, since the word might not be
+//in the dictionary at all.  The extension is:
+//	uint32_t	count of slots (i.e. words)
+//	uint32_t	count of buckets
+//	uint32_t[]	seed for each bucket
+//	uint32_t[]	offset of the entry for each slot
+//	entries		length-prefixed word, then length-prefixed phonemes
+//Offsets are from the start of the extension.
+#define TTS_DICT_DIRECT	0x80000000
+
+//The prefilter is a summary of each rule's bracket, laid out as arrays rather
+//than per rule, so that the engine can rule out a whole run of rules at once
+//(e.g. 16 at a time with SSE2) without looking at the rules themselves.  The
+//extension is:
+//	uint16_t	count of rules (all of them, in blob order)
+//	uint16_t	stride of the arrays; at least the count plus TTS_PF_LANES
+//	uint8_t[]	each rule's bracket length (at most TTS_PF_MAXLEN)
+//	uint8_t[][]	TTS_PF_CHARS arrays of the bracket's first characters (0
+//			after the end of the bracket)
+//	uint8_t[]	each rule's flags (TTS_PF_xxx)
+//A rule is a candidate if its bracket is no longer than what is left of the
+//word, and its first characters are those of the word.  Brackets longer than
+//TTS_PF_MAXLEN are given as that (which can only let more through).
+#define TTS_PF_LANES	16
+#define TTS_PF_CHARS	4
+#define TTS_PF_MAXLEN	120
+#define TTS_PF_LEFTANY	0x01	//the left context is 'anything'
+#define TTS_PF_RIGHTANY	0x02	//the right context is 'anything'
+
+
 //XXX internal; temporarily exposed for unit testing
+int _classifyChar(char ch);
+size_t _scanClass(const char* pszText, size_t nIdx, size_t nLen, int bWord);
+size_t _scanClassScalar(const char* pszText, size_t nIdx, size_t nLen, int bWord);
+uint32_t _prefilterScalar(const uint8_t* pbyLen, size_t nStride,
+		const uint8_t* abyText, int nRem);
+//(x86 has vectorized versions of those, too)
+#if defined(__x86_64__) || defined(_M_X64) || \
+		(defined(__i386__) && defined(__SSE2__)) || \
+		(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TTS_X86_SIMD
+size_t _scanClassSSE2(const char* pszText, size_t nIdx, size_t nLen, int bWord);
+size_t _scanClassAVX2(const char* pszText, size_t nIdx, size_t nLen, int bWord);
+int _haveAVX2(void);
+uint32_t _prefilterSSE2(const uint8_t* pbyLen, size_t nStride,
+		const uint8_t* abyText, int nRem);
+#endif
 typedef struct TTSRule_compact
 {
-	const uint8_t*	_left;
-	const uint8_t*	_bracket;
+	const uint8_t*	_left;	//the contexts' text, and the phonemes (not
+	const uint8_t*	_bracket;	//terminated; see the lengths)
 	const uint8_t*	_right;
 	const uint8_t*	_phone;
+	uint8_t	_nLeft;
+	uint8_t	_nBracket;
+	uint8_t	_nRight;
+	uint8_t	_nPhone;
+	uint8_t	_bPhone6;	//_phone is packed 6 bits to a phoneme
+	const uint8_t*	_leftcode;	//precompiled contexts, or NULL if none
+	const uint8_t*	_rightcode;
+	const uint8_t*	_class;	//class table for the precompiled contexts
 } TTSRule_compact;
 int _getRuleSectionLength(const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect);
+uint32_t _getBlobExtension(const uint8_t* pbyTTSRulesBlob, int nIdxExt);
+const uint8_t* _getGroupIndex(const uint8_t* pbyTTSRulesBlob, int* pnWidth);
+int _getRuleIndexAll(const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect, int nIdxRule);
+int _matchLeft(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		const uint8_t* abyCtx, int nCtxLen);
+int _matchRight(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		const uint8_t* abyCtx, int nCtxLen);
 void _reconstitute_rule(const uint8_t* pbyTTSRulesBlob,
 		int nIdxRuleSect, int nIdxRule, TTSRule_compact* rule);
+void _reconstitute_ctxcode(const uint8_t* pbyTTSRulesBlob, uint32_t nOffCode,
+		int nIdxRuleSect, int nIdxRule, TTSRule_compact* rule);
+void _getRulePhone(const TTSRule_compact* rule, uint8_t* pbyPhon);
 int _transforminput(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
 		const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect,
 		uint8_t* pbyPhon, int* pnPhonLen);
+int _transforminputEx(const char* pszNormWord, size_t nWordLen, size_t nIdxWord,
+		const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect,
+		uint8_t* pbyPhon, int* pnPhonLen, const uint8_t** ppbyRulePhon);
+uint32_t _hashDictWord(const char* pszNormWord, int nWordLen, uint32_t nSeed);
+const uint8_t* _findDict(const uint8_t* pbyDict, const char* pszNormWord, int nWordLen);
+int _lookupDict(const uint8_t* pbyDict, int bPhone6, const char* pszNormWord, int nWordLen,
+		uint8_t* pbyPhon, size_t nPhonLen, int* pnProduced);
+
+
+//optional instrumentation of the matching engine.  Define TTS_STATS when
+//compiling text_to_speech.c (and anything that looks at g_ttsStats) to have
+//the engine count what it does; without it there is no cost at all.  The
+//counters are plain globals, so only measure single-threaded.  The per-rule
+//counts are sized for a blob by ttsStatsReset (tts_stats.cpp); hits on rules
+//past that (e.g. without a reset) are only totalled, in _nRuleHitsLost.
+#ifdef TTS_STATS
+#define TTS_STATS_MAXPROBES	64	//last histogram bucket is 'this many or more'
+typedef struct TTSStats
+{
+	uint32_t*	_anRuleHits;	//by rule's index in the whole blob
+	uint32_t	_nRuleHits;	//how many rules there are counts for
+	uint32_t	_nRuleHitsLost;	//hits on rules past that
+	uint32_t	_anSectCalls[27];	//lookups (i.e. bits of text matched), by section
+	uint32_t	_anSectProbes[27];	//rules tried in those lookups, by section
+	uint32_t	_anProbeHist[TTS_STATS_MAXPROBES];	//characters, by how many rules were tried per character
+} TTSStats;
+extern TTSStats g_ttsStats;
+#endif
 
 
 #ifdef __cplusplus
@@ -0,0 +1,606 @@
+// tts_bench.cpp : microbenchmarks for the tokenizer, the matcher, and the
+//ruleset compiler.  This is a separate program; build it with something like:
+//	g++ -O2 -o tts_bench tts_bench.cpp make_compact_ruleset.cpp tts_native.cpp tts_parallel.cpp text_to_speech.c tts_rules.c tts_normalize.c sp0256.c tts_render.c -lpthread
+//
+//Each benchmark is run over a fixed corpus a few times to warm up, then timed
+//for a number of repetitions.  Reported are the mean (and standard deviation,
+//and best) time per repetition, and from the mean, ns/word, ns/char, and
+//words/sec.  -json emits the same as machine-readable results.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "text_to_speech.h"
+#include "make_compact_ruleset.h"
+#include "tts_native.h"
+#include "tts_parallel.h"
+#include "tts_normalize.h"
+#include "tts_render.h"
+
+
+//the same old text from the tests in text2speech001.cpp main()
+static const char achGettysburg[] =
+R"(Four score and seven years ago our fathers brought forth on this continent
+a new nation, conceived in liberty, and dedicated to the proposition that all
+men are created equal.
+Now we are engaged in a great civil war, testing whether that nation, or any
+nation so conceived and so dedicated, can long endure. We are met on a great
+battlefield of that war. We have come to dedicate a portion of that field, as
+a final resting place for those who here gave their lives that that nation
+might live. It is altogether fitting and proper that we should do this.
+But, in a larger sense, we can not dedicate, we can not consecrate, we can not
+hallow this ground. The brave men, living and dead, who struggled here, have
+consecrated it, far above our poor power to add or detract. The world will
+little note, nor long remember what we say here, but it can never forget what
+they did here. It is for us the living, rather, to be dedicated here to the
+unfinished work which they who fought here have thus far so nobly advanced. It
+is rather for us to be here dedicated to the great task remaining before us --
+that from these honored dead we take increased devotion to that cause for
+which they gave the last full measure of devotion -- that we here highly
+resolve that these dead shall not have died in vain -- that this nation, under
+God, shall have a new birth of freedom -- and that government of the people,
+by the people, for the people, shall not perish from the earth.
+)";
+
+
+//common English words, with rough occurrences per million words, from which
+//a realistically skewed list is sampled
+struct WordFreq
+{
+	const char*	pszWord;
+	unsigned int	nPerMillion;
+};
+static const WordFreq g_aWordFreq[] = {
+	{ "the", 56271 }, { "of", 29391 }, { "and", 26817 }, { "to", 25576 },
+	{ "a", 21626 }, { "in", 18214 }, { "is", 9960 }, { "it", 9866 },
+	{ "you", 9494 }, { "that", 9328 }, { "he", 7862 }, { "was", 7649 },
+	{ "for", 7563 }, { "on", 6549 }, { "are", 4708 }, { "with", 6475 },
+	{ "as", 5301 }, { "i", 8848 }, { "his", 4452 }, { "they", 4332 },
+	{ "be", 6644 }, { "at", 4790 }, { "one", 3007 }, { "have", 4735 },
+	{ "this", 4623 }, { "from", 4134 }, { "or", 3707 }, { "had", 3921 },
+	{ "by", 5096 }, { "not", 4626 }, { "word", 139 }, { "but", 4577 },
+	{ "what", 2493 }, { "some", 1617 }, { "we", 3578 }, { "can", 2672 },
+	{ "out", 2095 }, { "other", 1702 }, { "were", 3301 }, { "all", 2758 },
+	{ "there", 2618 }, { "when", 1957 }, { "up", 1795 }, { "use", 516 },
+	{ "your", 1366 }, { "how", 1213 }, { "said", 1961 }, { "an", 3430 },
+	{ "each", 690 }, { "she", 2859 }, { "which", 3719 }, { "do", 2802 },
+	{ "their", 2608 }, { "time", 1833 }, { "if", 2369 }, { "will", 2448 },
+	{ "way", 881 }, { "about", 1815 }, { "many", 1030 }, { "then", 1595 },
+	{ "them", 1733 }, { "write", 220 }, { "would", 2904 }, { "like", 1269 },
+	{ "so", 1893 }, { "these", 1254 }, { "her", 3037 }, { "long", 712 },
+	{ "make", 1032 }, { "thing", 333 }, { "see", 1155 }, { "him", 1649 },
+	{ "two", 1561 }, { "has", 2007 }, { "look", 653 }, { "more", 2203 },
+	{ "day", 699 }, { "could", 1683 }, { "go", 1151 }, { "come", 815 },
+	{ "did", 1277 }, { "number", 581 }, { "sound", 222 }, { "no", 2172 },
+	{ "most", 957 }, { "people", 1256 }, { "my", 1589 }, { "over", 1205 },
+	{ "know", 1218 }, { "water", 442 }, { "than", 1520 }, { "call", 269 },
+	{ "first", 1193 }, { "who", 2055 }, { "may", 1394 }, { "down", 895 },
+	{ "side", 319 }, { "been", 2686 }, { "now", 1291 }, { "find", 543 },
+	{ "through", 925 }, { "government", 486 }, { "thought", 510 },
+	{ "information", 243 }, { "development", 305 }, { "international", 196 },
+	{ "everything", 232 }, { "enough", 282 }, { "question", 268 },
+};
+
+
+//long or otherwise nasty words, to see the worst case
+static const char* g_apszAdversarial[] = {
+	"antidisestablishmentarianism",
+	"supercalifragilisticexpialidocious",
+	"pneumonoultramicroscopicsilicovolcanoconiosis",
+	"eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee",
+	"aeiouyaeiouyaeiouyaeiouyaeiouyaeiouyaeiouy",
+	"bcdfghjklmnpqrstvwxzbcdfghjklmnpqrstvwxz",
+	"ouoiouoiouoiouoiouoiouoiouoiouoiouoiouoi",
+	"thththththththththththththththththththth",
+	"incomprehensibilities",
+	"counterrevolutionaries",
+	"honorificabilitudinitatibus",
+	"'''''''''''''''''''''",
+};
+
+
+
+//a corpus as both text (for the tokenizer) and normalized words (for the rest)
+struct Corpus
+{
+	std::string	strName;
+	std::string	strText;
+	std::vector<std::string>	astrWords;
+	size_t	nChars;	//total characters in the words
+};
+
+
+Corpus makeCorpus(const std::string& strName, const std::string& strText)
+{
+	Corpus corpus;
+	corpus.strName = strName;
+	corpus.strText = strText;
+	corpus.nChars = 0;
+	const char* pszText = corpus.strText.c_str();
+	int nTextLen = (int)corpus.strText.size();
+	const char* pchWordStart;
+	const char* pchWordEnd;
+	while (0 == pluckWord(pszText, nTextLen, &pchWordStart, &pchWordEnd))
+	{
+		std::string strWord(pchWordStart, pchWordEnd);
+		std::transform(strWord.begin(), strWord.end(), strWord.begin(), ::tolower);
+		corpus.astrWords.push_back(strWord);
+		corpus.nChars += strWord.size();
+		nTextLen -= (int)(pchWordEnd - pszText);
+		pszText = pchWordEnd;
+	}
+	return corpus;
+}
+
+
+//sample nWords from the frequency list, deterministically
+std::string makeFrequencyText(size_t nWords)
+{
+	unsigned long nTotal = 0;
+	for (const WordFreq& wf : g_aWordFreq)
+		nTotal += wf.nPerMillion;
+	std::string strText;
+	uint32_t nRand = 12345;
+	for (size_t nIdx = 0; nIdx < nWords; ++nIdx)
+	{
+		nRand = nRand * 1103515245u + 12345u;	//(the classic LCG)
+		unsigned long nPick = (nRand >> 8) % nTotal;
+		const WordFreq* pwf = g_aWordFreq;
+		while (nPick >= pwf->nPerMillion)
+		{
+			nPick -= pwf->nPerMillion;
+			++pwf;
+		}
+		strText += pwf->pszWord;
+		strText += (0 == nIdx % 12) ? ". " : " ";
+	}
+	return strText + "\n";
+}
+
+
+//the same, with numbers, money, and abbreviations among the words (for the
+//normalizer; the rest see only the words)
+std::string makeNumericText(size_t nWords)
+{
+	std::string strText = makeFrequencyText(nWords);
+	std::string strMixed;
+	uint32_t nRand = 54321;
+	char achToken[32];
+	for (char ch : strText)
+	{
+		strMixed += ch;
+		if (' ' != ch)
+			continue;
+		nRand = nRand * 1103515245u + 12345u;
+		unsigned int nValue = (nRand >> 8) % 100000;
+		switch ((nRand >> 28) % 16)
+		{
+		case 0: snprintf(achToken, sizeof(achToken), "%u ", nValue); break;
+		case 1: snprintf(achToken, sizeof(achToken), "$%u.%02u ", nValue % 1000, nValue % 100); break;
+		case 2: snprintf(achToken, sizeof(achToken), "%u%% ", nValue % 100); break;
+		case 3: snprintf(achToken, sizeof(achToken), "%uth ", nValue % 100 + 4); break;
+		case 4: snprintf(achToken, sizeof(achToken), "%u ", 1900 + nValue % 120); break;
+		case 5: snprintf(achToken, sizeof(achToken), "Dr. "); break;
+		default: continue;
+		}
+		strMixed += achToken;
+	}
+	return strMixed;
+}
+
+
+std::string makeAdversarialText()
+{
+	std::string strText;
+	for (const char* pszWord : g_apszAdversarial)
+	{
+		strText += pszWord;
+		strText += " ";
+	}
+	return strText + "\n";
+}
+
+
+
+struct BenchResult
+{
+	std::string	strBench;
+	std::string	strCorpus;
+	size_t	nWords;	//per repetition
+	size_t	nChars;
+	size_t	nCalls;
+	double	dMeanNs;	//per repetition
+	double	dStdDevNs;
+	double	dMinNs;
+};
+typedef std::vector<BenchResult>	VEC_RESULT;
+
+
+//sink so the compiler can't throw the work away
+static volatile int g_nSink;
+
+
+BenchResult runBench(const std::string& strBench, const Corpus& corpus,
+		int nWarmup, int nReps, const std::function<size_t()>& fnBody)
+{
+	size_t nCalls = 0;
+	for (int nIdx = 0; nIdx < nWarmup; ++nIdx)
+		nCalls = fnBody();
+	std::vector<double> adNs;
+	for (int nIdx = 0; nIdx < nReps; ++nIdx)
+	{
+		auto tStart = std::chrono::steady_clock::now();
+		nCalls = fnBody();
+		auto tEnd = std::chrono::steady_clock::now();
+		adNs.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(tEnd - tStart).count());
+	}
+
+	BenchResult res;
+	res.strBench = strBench;
+	res.strCorpus = corpus.strName;
+	res.nWords = corpus.astrWords.size();
+	res.nChars = corpus.nChars;
+	res.nCalls = nCalls;
+	double dSum = 0;
+	for (double dNs : adNs)
+		dSum += dNs;
+	res.dMeanNs = dSum / adNs.size();
+	double dVar = 0;
+	for (double dNs : adNs)
+		dVar += (dNs - res.dMeanNs) * (dNs - res.dMeanNs);
+	res.dStdDevNs = (adNs.size() > 1) ? sqrt(dVar / (adNs.size() - 1)) : 0;
+	res.dMinNs = *std::min_element(adNs.begin(), adNs.end());
+	return res;
+}
+
+
+
+//the benchmarks themselves; each runs over the whole corpus once, and returns
+//how many calls it made to the thing being measured.
+
+size_t benchPluckWord(const Corpus& corpus)
+{
+	const char* pszText = corpus.strText.c_str();
+	int nTextLen = (int)corpus.strText.size();
+	const char* pchWordStart;
+	const char* pchWordEnd;
+	size_t nCalls = 0;
+	while (0 == pluckWord(pszText, nTextLen, &pchWordStart, &pchWordEnd))
+	{
+		nTextLen -= (int)(pchWordEnd - pszText);
+		pszText = pchWordEnd;
+		++nCalls;
+	}
+	return nCalls;
+}
+
+
+size_t benchTtsWord(const Corpus& corpus, const VEC_BYTE& abyBlob)
+{
+	uint8_t abyPhon[256];
+	int nTotal = 0;
+	for (const std::string& strWord : corpus.astrWords)
+	{
+		nTotal += ttsWord(strWord.c_str(), (int)strWord.size(), abyBlob.data(),
+				abyPhon, sizeof(abyPhon));
+	}
+	g_nSink = nTotal;
+	return corpus.astrWords.size();
+}
+
+
+//the same, with the expanded rules
+size_t benchTtsNativeWord(const Corpus& corpus, const TTSNativeRules& native)
+{
+	uint8_t abyPhon[256];
+	int nTotal = 0;
+	for (const std::string& strWord : corpus.astrWords)
+	{
+		nTotal += ttsNativeWord(native, strWord.c_str(), (int)strWord.size(),
+				abyPhon, sizeof(abyPhon));
+	}
+	g_nSink = nTotal;
+	return corpus.astrWords.size();
+}
+
+
+//_transforminput, driven as ttsWord would, but without ttsWord's bookkeeping
+size_t benchTransformInput(const Corpus& corpus, const VEC_BYTE& abyBlob)
+{
+	uint8_t abyPhon[256];
+	size_t nCalls = 0;
+	for (const std::string& strWord : corpus.astrWords)
+	{
+		size_t nIdxWord = 0;
+		while (nIdxWord < strWord.size())
+		{
+			char ch = strWord[nIdxWord];
+			int nIdxRuleSect = (ch >= 'a' && ch <= 'z') ? ch - 'a' + 1 : 0;
+			int nRem = sizeof(abyPhon);
+			nIdxWord += _transforminput(strWord.c_str(), strWord.size(), nIdxWord,
+					abyBlob.data(), nIdxRuleSect, abyPhon, &nRem);
+			++nCalls;
+		}
+	}
+	return nCalls;
+}
+
+
+//the contexts of every rule in the section, at every position in every word
+//(as though every bracket matched; this is the worst case for the matchers)
+size_t benchMatchContexts(const Corpus& corpus, const VEC_BYTE& abyBlob)
+{
+	size_t nCalls = 0;
+	int nMatched = 0;
+	for (const std::string& strWord : corpus.astrWords)
+	{
+		for (size_t nIdxWord = 0; nIdxWord < strWord.size(); ++nIdxWord)
+		{
+			char ch = strWord[nIdxWord];
+			int nIdxRuleSect = (ch >= 'a' && ch <= 'z') ? ch - 'a' + 1 : 0;
+			int nRuleSecLen = _getRuleSectionLength(abyBlob.data(), nIdxRuleSect);
+			TTSRule_compact rule;
+			for (int nIdxRule = 0; nIdxRule < nRuleSecLen; ++nIdxRule)
+			{
+				_reconstitute_rule(abyBlob.data(), nIdxRuleSect, nIdxRule, &rule);
+				size_t nIdxText = std::min(nIdxWord + rule._nBracket, strWord.size());
+				nMatched += _matchLeft(strWord.c_str(), strWord.size(), nIdxWord, rule._left, rule._nLeft);
+				nMatched += _matchRight(strWord.c_str(), strWord.size(), nIdxText, rule._right, rule._nRight);
+				nCalls += 2;
+			}
+		}
+	}
+	g_nSink = nMatched;
+	return nCalls;
+}
+
+
+//the normalizer over the text, into a fixed buffer, as t2s -norm does
+size_t benchNormalize(const Corpus& corpus)
+{
+	char achOut[4096];
+	TTSNormalizer norm;
+	ttsNormalizeInit(&norm);
+	const char* pszText = corpus.strText.c_str();
+	int nTextLen = (int)corpus.strText.size();
+	size_t nCalls = 0;
+	int nTotal = 0;
+	while (nTextLen > 0)
+	{
+		int nConsumed = 0;
+		nTotal += ttsNormalize(&norm, pszText, nTextLen, 1, achOut, sizeof(achOut), &nConsumed);
+		pszText += nConsumed;
+		nTextLen -= nConsumed;
+		++nCalls;
+	}
+	g_nSink = nTotal;
+	return nCalls;
+}
+
+
+//the renderer over the phonemes of the corpus, into a fixed buffer, as t2s -wav
+//does.  Each sample counts as a call, so ns/call is per sample; real time is
+//1e9 / TTS_RENDER_RATE ns a sample.
+size_t benchRender(const VEC_BYTE& abyPhon)
+{
+	int16_t anPCM[4096];
+	TTSRender render;
+	ttsRenderInit(&render, 0);
+	size_t nDone = 0;
+	size_t nSamples = 0;
+	int nTotal = 0;
+	while (nDone < abyPhon.size())
+	{
+		size_t nConsumed = 0;
+		size_t nOut = ttsRender(&render, &abyPhon[nDone], abyPhon.size() - nDone,
+				anPCM, sizeof(anPCM) / sizeof(anPCM[0]), &nConsumed);
+		nTotal += anPCM[0];
+		nSamples += nOut;
+		nDone += nConsumed;
+	}
+	g_nSink = nTotal;
+	return nSamples;
+}
+
+
+//the whole text through the plain ttsText loop, as ttsDocument does on each
+//chunk.  ttsText lower-cases in place, so each repetition works on a copy
+//(which is timed too, as it is in ttsDocument).
+size_t benchTtsText(const Corpus& corpus, const VEC_BYTE& abyBlob)
+{
+	std::string strText(corpus.strText);
+	uint8_t abyPhon[4096];
+	size_t nDone = 0;
+	size_t nCalls = 0;
+	int nTotal = 0;
+	for (;;)
+	{
+		int nConsumed = 0;
+		int nRet = ttsText(&strText[0] + nDone, (int)(strText.size() - nDone), abyBlob.data(),
+				abyPhon, sizeof(abyPhon), &nConsumed);
+		++nCalls;
+		if (nRet < 0 || 0 == nConsumed)
+			break;
+		nTotal += nRet;
+		nDone += nConsumed;
+	}
+	g_nSink = nTotal;
+	return nCalls;
+}
+
+
+//the whole text through ttsDocument on nThreads threads, in chunks small
+//enough that every thread gets several
+size_t benchDocument(const Corpus& corpus, const VEC_BYTE& abyBlob, unsigned int nThreads)
+{
+	VEC_BYTE abyPhon;
+	ttsDocument(corpus.strText.c_str(), corpus.strText.size(), abyBlob.data(),
+			abyPhon, nThreads, 8 * 1024);
+	g_nSink = (int)abyPhon.size();
+	return 1;
+}
+
+
+size_t benchCompile(unsigned int nOpts)
+{
+	VEC_BYTE abyBlob;
+	make_compact_ruleset(abyBlob, nOpts);
+	g_nSink = (int)abyBlob.size();
+	return 1;
+}
+
+
+
+void printText(const VEC_RESULT& results)
+{
+	std::cout << std::left << std::setw(18) << "bench" << std::setw(14) << "corpus" <<
+			std::right << std::setw(12) << "ns/rep" << std::setw(10) << "+/-%" <<
+			std::setw(12) << "best ns" << std::setw(12) << "ns/word" <<
+			std::setw(12) << "ns/char" << std::setw(12) << "ns/call" <<
+			std::setw(14) << "words/sec" << std::endl;
+	std::cout << std::fixed;
+	for (const BenchResult& res : results)
+	{
+		std::cout << std::left << std::setw(18) << res.strBench << std::setw(14) << res.strCorpus <<
+				std::right << std::setprecision(0) << std::setw(12) << res.dMeanNs <<
+				std::setprecision(1) << std::setw(10) << 100.0 * res.dStdDevNs / res.dMeanNs <<
+				std::setprecision(0) << std::setw(12) << res.dMinNs <<
+				std::setprecision(1) << std::setw(12) << res.dMeanNs / res.nWords <<
+				std::setw(12) << res.dMeanNs / res.nChars <<
+				std::setw(12) << res.dMeanNs / res.nCalls <<
+				std::setprecision(0) << std::setw(14) << 1e9 * res.nWords / res.dMeanNs << std::endl;
+	}
+}
+
+
+void printJSON(const VEC_RESULT& results, unsigned int nOpts, int nReps)
+{
+	std::cout << "{ \"blobopts\": " << nOpts << ", \"reps\": " << nReps <<
+			", \"results\": [" << std::endl;
+	std::cout << std::setprecision(6);
+	for (size_t nIdx = 0; nIdx < results.size(); ++nIdx)
+	{
+		const BenchResult& res = results[nIdx];
+		std::cout << "  { \"bench\": \"" << res.strBench << "\", \"corpus\": \"" << res.strCorpus <<
+				"\", \"words\": " << res.nWords << ", \"chars\": " << res.nChars <<
+				", \"calls\": " << res.nCalls <<
+				", \"mean_ns\": " << res.dMeanNs << ", \"stddev_ns\": " << res.dStdDevNs <<
+				", \"min_ns\": " << res.dMinNs <<
+				", \"ns_per_word\": " << res.dMeanNs / res.nWords <<
+				", \"ns_per_char\": " << res.dMeanNs / res.nChars <<
+				", \"ns_per_call\": " << res.dMeanNs / res.nCalls <<
+				", \"words_per_sec\": " << 1e9 * res.nWords / res.dMeanNs << " }" <<
+				(nIdx + 1 < results.size() ? "," : "") << std::endl;
+	}
+	std::cout << "] }" << std::endl;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	unsigned int nOpts = MCR_OPT_NONE;
+	bool bJSON = false;
+	int nReps = 10;
+	int nWarmup = 2;
+	for (int nIdxArg = 1; nIdxArg < argc; ++nIdxArg)
+	{
+		std::string strArg(argv[nIdxArg]);
+		if ("-trie" == strArg)
+			nOpts |= MCR_OPT_TRIE;
+		else if ("-ctxcode" == strArg)
+			nOpts |= MCR_OPT_CTXCODE;
+		else if ("-prefilter" == strArg)
+			nOpts |= MCR_OPT_PREFILTER;
+		else if ("-v2" == strArg)
+			nOpts |= MCR_OPT_V2;
+		else if ("-wide" == strArg)
+			nOpts |= MCR_OPT_WIDE;
+		else if ("-pack" == strArg)
+			nOpts |= MCR_OPT_PACK;
+		else if ("-json" == strArg)
+			bJSON = true;
+		else if ("-reps" == strArg && nIdxArg + 1 < argc)
+			nReps = std::max(1, atoi(argv[++nIdxArg]));
+		else if ("-warmup" == strArg && nIdxArg + 1 < argc)
+			nWarmup = std::max(0, atoi(argv[++nIdxArg]));
+		else
+		{
+			std::cerr << "usage: tts_bench [-trie] [-ctxcode] [-prefilter] [-v2|-wide|-pack] [-json] [-reps n] [-warmup n]" << std::endl;
+			return 1;
+		}
+	}
+
+	VEC_BYTE abyBlob;
+	make_compact_ruleset(abyBlob, nOpts);
+	TTSNativeRules native;
+	ttsNativeInit(native);
+
+	std::vector<Corpus> corpora;
+	corpora.push_back(makeCorpus("gettysburg", achGettysburg));
+	corpora.push_back(makeCorpus("frequency", makeFrequencyText(20000)));
+	corpora.push_back(makeCorpus("adversarial", makeAdversarialText()));
+	corpora.push_back(makeCorpus("numeric", makeNumericText(20000)));
+
+	VEC_RESULT results;
+	for (const Corpus& corpus : corpora)
+	{
+		results.push_back(runBench("pluckWord", corpus, nWarmup, nReps,
+				[&]() { return benchPluckWord(corpus); }));
+		results.push_back(runBench("ttsNormalize", corpus, nWarmup, nReps,
+				[&]() { return benchNormalize(corpus); }));
+		results.push_back(runBench("ttsWord", corpus, nWarmup, nReps,
+				[&]() { return benchTtsWord(corpus, abyBlob); }));
+		results.push_back(runBench("ttsNativeWord", corpus, nWarmup, nReps,
+				[&]() { return benchTtsNativeWord(corpus, native); }));
+		results.push_back(runBench("_transforminput", corpus, nWarmup, nReps,
+				[&]() { return benchTransformInput(corpus, abyBlob); }));
+		results.push_back(runBench("_matchLeft/Right", corpus, nWarmup, nReps,
+				[&]() { return benchMatchContexts(corpus, abyBlob); }));
+	}
+	//a whole document, sequentially and then on more and more threads
+	results.push_back(runBench("ttsText", corpora[1], nWarmup, nReps,
+			[&]() { return benchTtsText(corpora[1], abyBlob); }));
+	for (unsigned int nThreads : { 1u, 2u, 4u, 8u })
+	{
+		results.push_back(runBench("ttsDocument x" + std::to_string(nThreads), corpora[1], nWarmup, nReps,
+				[&]() { return benchDocument(corpora[1], abyBlob, nThreads); }));
+	}
+	//the compiler doesn't depend on a corpus; report it against the rules
+	Corpus rules;
+	rules.strName = "ruleset";
+	rules.astrWords.resize(1);
+	rules.nChars = 1;
+	results.push_back(runBench("compile", rules, nWarmup, nReps,
+			[&]() { return benchCompile(nOpts); }));
+	//the renderer, over the phonemes of the first corpus (the others would be
+	//hours of speech)
+	VEC_BYTE abyPhon;
+	for (const std::string& strWord : corpora[0].astrWords)
+	{
+		uint8_t abyWord[256];
+		int nPhon = ttsWord(strWord.c_str(), (int)strWord.size(), abyBlob.data(),
+				abyWord, sizeof(abyWord));
+		if (nPhon > 0)
+			abyPhon.insert(abyPhon.end(), abyWord, abyWord + nPhon);
+	}
+	results.push_back(runBench("ttsRender", corpora[0], nWarmup, nReps,
+			[&]() { return benchRender(abyPhon); }));
+
+	if (bJSON)
+		printJSON(results, nOpts, nReps);
+	else
+		printText(results);
+	return 0;
+}
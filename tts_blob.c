@@ -0,0 +1,533 @@
+#include "tts_blob.h"
+#include "text_to_speech.h"
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TTS_BLOB_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+
+//deepest trie we will accept.  brackets are at most 255 long, so no sensible
+//trie is deeper than that.
+#define TTS_BLOB_MAXDEPTH	256
+
+
+
+//get the nIdx'th of an array of offsets nWidth bytes wide
+uint32_t _blobOff(const uint8_t* pby, int nWidth, size_t nIdx)
+{
+	return (2 == nWidth) ? ((const uint16_t*)pby)[nIdx] : ((const uint32_t*)pby)[nIdx];
+}
+
+
+//is [nOff,nOff+nLen) within [0,nEnd)?  (careful not to overflow)
+int _inBounds(size_t nOff, size_t nLen, size_t nEnd)
+{
+	return nOff <= nEnd && nLen <= nEnd - nOff;
+}
+
+
+//is there a length-prefixed string at nOff, wholly within [nStart,nEnd)?
+int _validString(const uint8_t* pbyTTSRulesBlob, size_t nOff, size_t nStart, size_t nEnd)
+{
+	return nOff >= nStart && nOff < nEnd &&
+			_inBounds(nOff + 1, pbyTTSRulesBlob[nOff], nEnd);
+}
+
+
+//get where the nIdxRef'th string of a rule is, and how long, if it is wholly
+//within the data [nDataOff,nDataEnd).  (see _getRef)  With bPhone6, the
+//phonemes' length is a count of phonemes, and they take fewer bytes.
+int _validRef(const uint8_t* pbyTTSRulesBlob, const uint8_t* pbyRule, int nWidth,
+		int bPacked, int bPhone6,
+		int nIdxRef, size_t nDataOff, size_t nDataEnd, size_t* pnOff, size_t* pnLen)
+{
+	uint32_t nRef = _blobOff(pbyRule, nWidth, nIdxRef);
+	if (bPacked)
+	{
+		int nLenBits = TTS_BLOB_PACKED_LENBITS(nWidth);
+		*pnOff = nDataOff + (nRef >> nLenBits);
+		*pnLen = nRef & ((1 << nLenBits) - 1);
+	}
+	else
+	{
+		if (nRef < nDataOff || nRef >= nDataEnd)
+			return 0;
+		*pnOff = nRef + 1;
+		*pnLen = pbyTTSRulesBlob[nRef];
+	}
+	return _inBounds(*pnOff, (bPhone6 && 3 == nIdxRef) ? TTS_PHON6_LEN(*pnLen) : *pnLen,
+			nDataEnd);
+}
+
+
+
+//what we need to know while checking a section's trie
+typedef struct TTSTrieCheck
+{
+	const uint8_t*	_pbyTTSRulesBlob;
+	const uint8_t*	_pbyRules;	//the section's rules
+	int	_nWidth;
+	int	_bPacked;
+	size_t	_nDataOff;	//(already known to be good)
+	int	_nRules;	//how many
+	const uint8_t*	_pbyTrie;
+	size_t	_nLen;	//of the trie
+	size_t	_nBudget;	//how many more nodes we will look at
+	uint8_t	_abyPath[TTS_BLOB_MAXDEPTH];	//the text spelled to this node
+} TTSTrieCheck;
+
+
+//check a trie node, and (recursively) its children.  The engine trusts the
+//trie to only give it rules whose bracket matches the text it walked, so that
+//must be true of every candidate.  A trie is a tree, so it can't have more
+//nodes than would fit, so the budget stops a malicious one (with shared
+//children) from making us do more work than that.
+int _validTrieNode(TTSTrieCheck* pCheck, size_t nOff, int nDepth)
+{
+	if (0 == pCheck->_nBudget)
+		return 0;
+	pCheck->_nBudget -= 1;
+	if (0 != nOff % 2 || !_inBounds(nOff, 5, pCheck->_nLen))
+		return 0;
+	const uint8_t* pbyNode = &pCheck->_pbyTrie[nOff];
+
+	//the candidates
+	size_t nListOff = ((const uint16_t*)pbyNode)[0];
+	int nCands = ((const uint16_t*)pbyNode)[1];
+	if (0 != nListOff % 2 || !_inBounds(nListOff, nCands * sizeof(uint16_t), pCheck->_nLen))
+		return 0;
+	const uint16_t* pnCand = (const uint16_t*)&pCheck->_pbyTrie[nListOff];
+	for (int nIdxCand = 0; nIdxCand < nCands; ++nIdxCand)
+	{
+		if (pnCand[nIdxCand] >= pCheck->_nRules)
+			return 0;
+		size_t nBracketOff, nBracketLen;
+		_validRef(pCheck->_pbyTTSRulesBlob, &pCheck->_pbyRules[pnCand[nIdxCand] * 4 * pCheck->_nWidth],
+				pCheck->_nWidth, pCheck->_bPacked, 0, 1, pCheck->_nDataOff, (size_t)-1,
+				&nBracketOff, &nBracketLen);
+		if (nBracketLen > (size_t)nDepth ||
+				0 != memcmp(&pCheck->_pbyTTSRulesBlob[nBracketOff], pCheck->_abyPath, nBracketLen))
+			return 0;
+	}
+
+	//the children; these always follow their parent
+	int nChildren = pbyNode[4];
+	if (0 != nChildren && nDepth == TTS_BLOB_MAXDEPTH)
+		return 0;
+	size_t nChildOffOff = nOff + ((5 + nChildren + 1) & ~1);
+	if (!_inBounds(nChildOffOff, nChildren * sizeof(uint16_t), pCheck->_nLen))
+		return 0;
+	const uint16_t* pnChildOff = (const uint16_t*)&pCheck->_pbyTrie[nChildOffOff];
+	for (int nIdxChild = 0; nIdxChild < nChildren; ++nIdxChild)
+	{
+		pCheck->_abyPath[nDepth] = pbyNode[5 + nIdxChild];
+		if (pnChildOff[nIdxChild] <= nOff ||
+				!_validTrieNode(pCheck, pnChildOff[nIdxChild], nDepth + 1))
+			return 0;
+	}
+	return 1;
+}
+
+
+//check the trie extension (see _transforminputTrie)
+int _validTrie(const uint8_t* pbyTTSRulesBlob, const uint8_t* pbyGrpIdx, int nWidth,
+		int bPacked, const uint8_t* pbyTrie, size_t nLen)
+{
+	if (nLen < 27 * sizeof(uint16_t))
+		return 0;
+	TTSTrieCheck check;
+	check._pbyTTSRulesBlob = pbyTTSRulesBlob;
+	check._nWidth = nWidth;
+	check._bPacked = bPacked;
+	check._nDataOff = _blobOff(pbyGrpIdx, nWidth, 27);
+	check._pbyTrie = pbyTrie;
+	check._nLen = nLen;
+	check._nBudget = nLen / 6;	//the smallest node
+	for (int nIdxRuleSect = 0; nIdxRuleSect < 27; ++nIdxRuleSect)
+	{
+		uint32_t nGroupOff = _blobOff(pbyGrpIdx, nWidth, nIdxRuleSect);
+		check._pbyRules = &pbyTTSRulesBlob[nGroupOff];
+		check._nRules = (_blobOff(pbyGrpIdx, nWidth, nIdxRuleSect + 1) - nGroupOff) / (4*nWidth);
+		if (!_validTrieNode(&check, ((const uint16_t*)pbyTrie)[nIdxRuleSect], 0))
+			return 0;
+	}
+	return 1;
+}
+
+
+//check the precompiled contexts extension (see _matchCode).  So that the code
+//can't look any further through the text than the contexts it was compiled
+//from could, only letters may have a class, and literals must be those the
+//contexts can have.
+int _validCtxCode(const uint8_t* pbyCode, size_t nLen, int nRulesAll)
+{
+	//the class table, and two code offsets per rule
+	if (!_inBounds(256, nRulesAll * 2*sizeof(uint16_t), nLen))
+		return 0;
+	for (int nCh = 0; nCh < 256; ++nCh)
+	{
+		if (0 != pbyCode[nCh] && !((nCh >= 'a' && nCh <= 'z') || (nCh >= 'A' && nCh <= 'Z')))
+			return 0;
+	}
+	const uint16_t* pnCodeOff = (const uint16_t*)&pbyCode[256];
+	for (int nIdx = 0; nIdx < nRulesAll * 2; ++nIdx)
+	{
+		//follow the code to its end
+		size_t nIdxCode = pnCodeOff[nIdx];
+		for (;;)
+		{
+			if (nIdxCode >= nLen)
+				return 0;
+			uint8_t byOp = pbyCode[nIdxCode];
+			if (TTS_CTX_END == byOp || TTS_CTX_FAIL == byOp)
+				break;
+			else if (TTS_CTX_BOUND == byOp || TTS_CTX_ESUFFIX == byOp)
+				nIdxCode += 1;
+			else if (TTS_CTX_ONE == byOp || TTS_CTX_ONEPLUS == byOp || TTS_CTX_ZEROPLUS == byOp)
+				nIdxCode += 2;	//(the operand is checked with the next op)
+			else if (TTS_CTX_LIT == byOp && nIdxCode + 1 < nLen)
+			{
+				uint8_t byLit = pbyCode[nIdxCode + 1];
+				if (!((byLit >= 'a' && byLit <= 'z') || (byLit >= 'A' && byLit <= 'Z') ||
+						'\'' == byLit || ' ' == byLit))
+					return 0;
+				nIdxCode += 2;
+			}
+			else
+				return 0;
+		}
+	}
+	return 1;
+}
+
+
+
+//check the exception dictionary extension (see _lookupDict)
+int _validDict(const uint8_t* pbyDict, size_t nLen, int bPhone6)
+{
+	if (nLen < 2 * sizeof(uint32_t) || 0 != ((uintptr_t)pbyDict & (sizeof(uint32_t) - 1)))
+		return 0;
+	const uint32_t* pnDict = (const uint32_t*)pbyDict;
+	size_t nSlots = pnDict[0];
+	size_t nBuckets = pnDict[1];
+	if (0 == nSlots)
+		return 1;	//(never looked in)
+	if (0 == nBuckets || nSlots > nLen / sizeof(uint32_t) || nBuckets > nLen / sizeof(uint32_t) ||
+			!_inBounds(2 * sizeof(uint32_t), (nBuckets + nSlots) * sizeof(uint32_t), nLen))
+		return 0;
+	for (size_t nIdxBucket = 0; nIdxBucket < nBuckets; ++nIdxBucket)
+	{
+		uint32_t nSeed = pnDict[2 + nIdxBucket];
+		if ((nSeed & TTS_DICT_DIRECT) && (nSeed & ~TTS_DICT_DIRECT) >= nSlots)
+			return 0;
+	}
+	for (size_t nSlot = 0; nSlot < nSlots; ++nSlot)
+	{
+		size_t nOff = pnDict[2 + nBuckets + nSlot];
+		if (!_validString(pbyDict, nOff, 0, nLen))
+			return 0;
+		//the phonemes (see TTS_BLOB_V2_PHON6)
+		size_t nPhonOff = nOff + 1 + pbyDict[nOff];
+		if (nPhonOff >= nLen || !_inBounds(nPhonOff + 1,
+				bPhone6 ? TTS_PHON6_LEN(pbyDict[nPhonOff]) : pbyDict[nPhonOff], nLen))
+			return 0;
+	}
+	return 1;
+}
+
+
+
+//check the prefilter extension (see _transforminputPrefilter).  The engine
+//checks every bracket the filter lets through, so the arrays just have to be
+//there, and the lengths small enough to compare as signed bytes.
+int _validPrefilter(const uint8_t* pbyPF, size_t nLen, int nRulesAll)
+{
+	if (nLen < 2 * sizeof(uint16_t))
+		return 0;
+	size_t nRules = ((const uint16_t*)pbyPF)[0];
+	size_t nStride = ((const uint16_t*)pbyPF)[1];
+	if (nRules != (size_t)nRulesAll || nStride < nRules + TTS_PF_LANES ||
+			!_inBounds(2 * sizeof(uint16_t), (1 + TTS_PF_CHARS + 1) * nStride, nLen))
+		return 0;
+	for (size_t nIdxRule = 0; nIdxRule < nStride; ++nIdxRule)
+	{
+		if (pbyPF[2 * sizeof(uint16_t) + nIdxRule] > TTS_PF_MAXLEN)
+			return 0;
+	}
+	return 1;
+}
+
+
+
+int ttsBlobValidate(const uint8_t* pbyTTSRulesBlob, size_t nLen)
+{
+	if (NULL == pbyTTSRulesBlob || nLen < sizeof(uint16_t))
+		return TTS_BLOB_ESHORT;
+
+	//first, find the group index, the end of the data, and the extensions,
+	//according to the format
+	int nWidth = sizeof(uint16_t);
+	int bPacked = 0;
+	int bPhone6 = 0;
+	size_t nGrpIdxOff;	//where the group index is
+	size_t nGrpIdxLen;	//and how long (including any v1 extension slots)
+	size_t nDataEnd = nLen;
+	size_t anExtOff[4] = { 0, 0, 0, 0 };	//trie, ctxcode, dict, prefilter
+	size_t anExtLen[4] = { 0, 0, 0, 0 };
+	if (nLen >= TTS_BLOB_V2_HDRLEN && 0 == memcmp(pbyTTSRulesBlob, TTS_BLOB_MAGIC, 4))
+	{
+#ifdef TTS_BLOB_V1_ONLY
+		return TTS_BLOB_EHEADER;	//we wouldn't understand it
+#else
+		if (2 != pbyTTSRulesBlob[4])
+			return TTS_BLOB_EHEADER;
+		nWidth = pbyTTSRulesBlob[5] & ~(TTS_BLOB_V2_PACKED | TTS_BLOB_V2_PHON6);
+		bPacked = 0 != (pbyTTSRulesBlob[5] & TTS_BLOB_V2_PACKED);
+		bPhone6 = 0 != (pbyTTSRulesBlob[5] & TTS_BLOB_V2_PHON6);
+		if (sizeof(uint16_t) != nWidth && sizeof(uint32_t) != nWidth)
+			return TTS_BLOB_EHEADER;
+		if (0 != ((uintptr_t)pbyTTSRulesBlob & (sizeof(uint32_t) - 1)))
+			return TTS_BLOB_EALIGN;
+		int nSects = ((const uint16_t*)pbyTTSRulesBlob)[3];
+		nGrpIdxOff = TTS_BLOB_V2_HDRLEN + nSects * TTS_BLOB_V2_DIRLEN;
+		nGrpIdxLen = (27 + 1) * nWidth;
+		if (nGrpIdxOff > nLen)
+			return TTS_BLOB_ESHORT;
+
+		//the sections must be in order and not overlap, and the ones we
+		//need must be where the engine expects them
+		size_t nPrevEnd = nGrpIdxOff;
+		size_t nRulesOff = 0, nRulesLen = 0, nDataOff = 0;
+		int bHaveGroups = 0, bHaveRules = 0, bHaveData = 0;
+		for (int nIdxSect = 0; nIdxSect < nSects; ++nIdxSect)
+		{
+			const uint8_t* pbyEntry = &pbyTTSRulesBlob[TTS_BLOB_V2_HDRLEN + nIdxSect * TTS_BLOB_V2_DIRLEN];
+			int nId = ((const uint16_t*)pbyEntry)[0];
+			size_t nOff = ((const uint32_t*)pbyEntry)[1];
+			size_t nSectLen = ((const uint32_t*)pbyEntry)[2];
+			if (nOff < nPrevEnd)
+				return TTS_BLOB_EHEADER;
+			if (!_inBounds(nOff, nSectLen, nLen))
+				return TTS_BLOB_ESHORT;
+			nPrevEnd = nOff + nSectLen;
+			switch (nId)
+			{
+			case TTS_BLOB_SECT_GROUPS:
+				if (nOff != nGrpIdxOff || nSectLen != nGrpIdxLen)
+					return TTS_BLOB_EHEADER;
+				bHaveGroups = 1;
+			break;
+			case TTS_BLOB_SECT_RULES:
+				nRulesOff = nOff;
+				nRulesLen = nSectLen;
+				bHaveRules = 1;
+			break;
+			case TTS_BLOB_SECT_DATA:
+				nDataOff = nOff;
+				nDataEnd = nOff + nSectLen;
+				bHaveData = 1;
+			break;
+			case TTS_BLOB_EXT_TRIE:
+			case TTS_BLOB_EXT_CTXCODE:
+			case TTS_BLOB_EXT_DICT:
+			case TTS_BLOB_EXT_PREFILTER:
+				if (0 != nOff % sizeof(uint16_t) || 0 != anExtOff[nId - TTS_BLOB_EXT_TRIE])
+					return TTS_BLOB_EHEADER;
+				anExtOff[nId - TTS_BLOB_EXT_TRIE] = nOff;
+				anExtLen[nId - TTS_BLOB_EXT_TRIE] = nSectLen;
+			break;
+			default:	//something newer; the engine will ignore it too
+			break;
+			}
+		}
+		if (!bHaveGroups || !bHaveRules || !bHaveData)
+			return TTS_BLOB_EHEADER;
+		//the rules and data must be just what the group index says they are
+		const uint8_t* pbyGrpIdx = &pbyTTSRulesBlob[nGrpIdxOff];
+		if (nRulesOff != _blobOff(pbyGrpIdx, nWidth, 0) ||
+				nRulesOff + nRulesLen != _blobOff(pbyGrpIdx, nWidth, 27) ||
+				nDataOff != nRulesOff + nRulesLen)
+			return TTS_BLOB_EINDEX;
+#endif
+	}
+	else
+	{
+		if (0 != ((uintptr_t)pbyTTSRulesBlob & (sizeof(uint16_t) - 1)))
+			return TTS_BLOB_EALIGN;
+		//the first group follows the index, so its offset tells how long it is
+		nGrpIdxOff = 0;
+		nGrpIdxLen = ((const uint16_t*)pbyTTSRulesBlob)[0];
+		if (0 != nGrpIdxLen % sizeof(uint16_t) || nGrpIdxLen < (27 + 1) * sizeof(uint16_t))
+			return TTS_BLOB_EINDEX;
+		if (nGrpIdxLen > nLen)
+			return TTS_BLOB_ESHORT;
+		//the extensions follow the data; each goes up to the next one, or the
+		//end of the blob
+		int nIdxEntries = (int)(nGrpIdxLen / sizeof(uint16_t));
+		const uint16_t* pnGrpOff = (const uint16_t*)pbyTTSRulesBlob;
+		for (int nIdxExt = 27 + 1; nIdxExt < nIdxEntries; ++nIdxExt)
+		{
+			size_t nOff = pnGrpOff[nIdxExt];
+			if (0 == nOff)
+				continue;
+			if (0 != nOff % sizeof(uint16_t) || nOff < pnGrpOff[27] || nOff >= nLen)
+				return TTS_BLOB_EEXT;
+			if (nOff < nDataEnd)
+				nDataEnd = nOff;
+		}
+		for (int nIdxExt = TTS_BLOB_EXT_TRIE; nIdxExt <= TTS_BLOB_EXT_PREFILTER; ++nIdxExt)
+		{
+			if (nIdxExt >= nIdxEntries || 0 == pnGrpOff[nIdxExt])
+				continue;
+			size_t nOff = pnGrpOff[nIdxExt];
+			size_t nEnd = nLen;
+			for (int nIdxOther = 27 + 1; nIdxOther < nIdxEntries; ++nIdxOther)
+			{
+				if (pnGrpOff[nIdxOther] > nOff && pnGrpOff[nIdxOther] < nEnd)
+					nEnd = pnGrpOff[nIdxOther];
+			}
+			anExtOff[nIdxExt - TTS_BLOB_EXT_TRIE] = nOff;
+			anExtLen[nIdxExt - TTS_BLOB_EXT_TRIE] = nEnd - nOff;
+		}
+	}
+
+	//the group index:  in order, a whole number of rules in each group, the
+	//first group right after the index, and the data after the last
+	const uint8_t* pbyGrpIdx = &pbyTTSRulesBlob[nGrpIdxOff];
+	if (_blobOff(pbyGrpIdx, nWidth, 0) != nGrpIdxOff + nGrpIdxLen)
+		return TTS_BLOB_EINDEX;
+	for (int nIdxRuleSect = 0; nIdxRuleSect < 27; ++nIdxRuleSect)
+	{
+		uint32_t nThisOff = _blobOff(pbyGrpIdx, nWidth, nIdxRuleSect);
+		uint32_t nNextOff = _blobOff(pbyGrpIdx, nWidth, nIdxRuleSect + 1);
+		if (nNextOff < nThisOff || 0 != (nNextOff - nThisOff) % (4*nWidth))
+			return TTS_BLOB_EINDEX;
+	}
+	size_t nDataOff = _blobOff(pbyGrpIdx, nWidth, 27);
+	if (nDataOff > nDataEnd)
+		return TTS_BLOB_ESHORT;
+
+	//the rules:  every string must be wholly in the data, and every bracket
+	//must consume something
+	int nRulesAll = (int)((nDataOff - (nGrpIdxOff + nGrpIdxLen)) / (4*nWidth));
+	const uint8_t* pbyRule = &pbyTTSRulesBlob[nGrpIdxOff + nGrpIdxLen];
+	for (int nIdxRule = 0; nIdxRule < nRulesAll; ++nIdxRule, pbyRule += 4*nWidth)
+	{
+		for (int nIdxStr = 0; nIdxStr < 4; ++nIdxStr)
+		{
+			size_t nStrOff, nStrLen;
+			if (!_validRef(pbyTTSRulesBlob, pbyRule, nWidth, bPacked, bPhone6, nIdxStr,
+					nDataOff, nDataEnd, &nStrOff, &nStrLen) ||
+					(1 == nIdxStr && 0 == nStrLen))
+				return TTS_BLOB_ERULE;
+		}
+	}
+
+	//the extensions we know about
+	if (0 != anExtOff[0] &&
+			!_validTrie(pbyTTSRulesBlob, pbyGrpIdx, nWidth, bPacked,
+				&pbyTTSRulesBlob[anExtOff[0]], anExtLen[0]))
+		return TTS_BLOB_EEXT;
+	if (0 != anExtOff[1] &&
+			!_validCtxCode(&pbyTTSRulesBlob[anExtOff[1]], anExtLen[1], nRulesAll))
+		return TTS_BLOB_EEXT;
+	if (0 != anExtOff[2] &&
+			!_validDict(&pbyTTSRulesBlob[anExtOff[2]], anExtLen[2], bPhone6))
+		return TTS_BLOB_EEXT;
+	if (0 != anExtOff[3] &&
+			!_validPrefilter(&pbyTTSRulesBlob[anExtOff[3]], anExtLen[3], nRulesAll))
+		return TTS_BLOB_EEXT;
+
+	return TTS_BLOB_OK;
+}
+
+
+
+#ifdef TTS_BLOB_MMAP
+
+int ttsBlobOpen(TTSBlobFile* pFile, const char* pszFile)
+{
+	pFile->_pbyTTSRulesBlob = NULL;
+	pFile->_nLen = 0;
+
+	int fd = open(pszFile, O_RDONLY);
+	if (fd < 0)
+		return TTS_BLOB_EOPEN;
+	struct stat st;
+	if (0 != fstat(fd, &st))
+	{
+		close(fd);
+		return TTS_BLOB_EOPEN;
+	}
+	if (st.st_size <= 0)
+	{
+		close(fd);
+		return TTS_BLOB_ESHORT;
+	}
+	size_t nLen = (size_t)st.st_size;
+	//shared, so all the processes mapping this file use the same pages
+	void* pvMap = mmap(NULL, nLen, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);	//the mapping keeps its own reference
+	if (MAP_FAILED == pvMap)
+		return TTS_BLOB_EOPEN;
+
+	int nErr = ttsBlobValidate((const uint8_t*)pvMap, nLen);
+	if (TTS_BLOB_OK != nErr)
+	{
+		munmap(pvMap, nLen);
+		return nErr;
+	}
+	pFile->_pbyTTSRulesBlob = (const uint8_t*)pvMap;
+	pFile->_nLen = nLen;
+	return TTS_BLOB_OK;
+}
+
+
+void ttsBlobClose(TTSBlobFile* pFile)
+{
+	if (NULL != pFile->_pbyTTSRulesBlob)
+		munmap((void*)pFile->_pbyTTSRulesBlob, pFile->_nLen);
+	pFile->_pbyTTSRulesBlob = NULL;
+	pFile->_nLen = 0;
+}
+
+#else
+
+int ttsBlobOpen(TTSBlobFile* pFile, const char* pszFile)
+{
+	pFile->_pbyTTSRulesBlob = NULL;
+	pFile->_nLen = 0;
+	return TTS_BLOB_EOPEN;
+}
+
+
+void ttsBlobClose(TTSBlobFile* pFile)
+{
+	pFile->_pbyTTSRulesBlob = NULL;
+	pFile->_nLen = 0;
+}
+
+#endif
+
+
+
+const char* ttsBlobErrorText(int nErr)
+{
+	switch (nErr)
+	{
+	case TTS_BLOB_OK:	return "ok";
+	case TTS_BLOB_EOPEN:	return "can't open or map the file";
+	case TTS_BLOB_ESHORT:	return "too short";
+	case TTS_BLOB_EALIGN:	return "misaligned";
+	case TTS_BLOB_EHEADER:	return "bad header or section directory";
+	case TTS_BLOB_EINDEX:	return "bad group index";
+	case TTS_BLOB_ERULE:	return "bad rule";
+	case TTS_BLOB_EEXT:	return "bad extension";
+	default:	return "unknown error";
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef __TTS_BLOB_H
+#define __TTS_BLOB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+//Loading a rules blob from a file at run time, rather than having it compiled
+//in as g_abyTTS.  The file is just the blob's bytes (see text2speech001 -bin).
+//It is memory mapped read-only, so nothing is copied or parsed:  the mapping
+//is the blob that ttsWord uses, and every process that maps the same file
+//shares the same physical pages.  Since a blob from a file can't be trusted the
+//way a compiled in one can, its structure is checked once when it is opened,
+//so that the engine can never be led outside of it.
+//
+//A mapped file must not be modified in place while it is in use; replace it
+//with a new file (e.g. by rename) instead.
+
+
+//what is wrong with a blob, if anything
+enum
+{
+	TTS_BLOB_OK = 0,
+	TTS_BLOB_EOPEN,		//couldn't open or map the file
+	TTS_BLOB_ESHORT,	//too short for what it claims to hold
+	TTS_BLOB_EALIGN,	//not aligned for its offsets
+	TTS_BLOB_EHEADER,	//bad v2 header or directory
+	TTS_BLOB_EINDEX,	//bad group index
+	TTS_BLOB_ERULE,		//a rule refers outside the data
+	TTS_BLOB_EEXT,		//a bad extension
+};
+
+
+//a blob mapped from a file
+typedef struct TTSBlobFile
+{
+	const uint8_t*	_pbyTTSRulesBlob;	//give this to ttsWord et al.
+	size_t	_nLen;
+} TTSBlobFile;
+
+
+//check that a blob of nLen bytes is well formed:  that the index, sections,
+//rules, strings, and any extensions it has are all in range and consistent.
+//This takes time in proportion to the size of the blob's structure, but it
+//only reads the blob.  returns TTS_BLOB_OK, or what is wrong.
+int ttsBlobValidate(const uint8_t* pbyTTSRulesBlob, size_t nLen);
+
+
+//map a blob file, and validate it.  returns TTS_BLOB_OK, or what is wrong (in
+//which case nothing is left mapped).  (Only on POSIX systems; elsewhere this
+//always fails with TTS_BLOB_EOPEN.)
+int ttsBlobOpen(TTSBlobFile* pFile, const char* pszFile);
+
+
+//unmap a blob file opened with ttsBlobOpen
+void ttsBlobClose(TTSBlobFile* pFile);
+
+
+//a description of a TTS_BLOB_Exxx code, for messages
+const char* ttsBlobErrorText(int nErr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
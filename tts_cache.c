@@ -0,0 +1,159 @@
+#include "tts_cache.h"
+#include "text_to_speech.h"
+#include <string.h>
+
+
+
+//FNV-1a; it's small and good enough for words
+uint32_t _hashWord(const char* pszNormWord, int nWordLen)
+{
+	uint32_t nHash = 2166136261u;
+	for (int nIdx = 0; nIdx < nWordLen; ++nIdx)
+	{
+		nHash ^= (uint8_t)pszNormWord[nIdx];
+		nHash *= 16777619u;
+	}
+	return nHash;
+}
+
+
+
+size_t ttsCacheInit(TTSWordCache* pCache, const uint8_t* pbyTTSRulesBlob,
+		void* pvMem, size_t nMemLen)
+{
+	//the slots must be aligned, and the caller's memory might not be
+	uintptr_t nAddr = (uintptr_t)pvMem;
+	uintptr_t nAligned = (nAddr + sizeof(uint32_t) - 1) & ~(uintptr_t)(sizeof(uint32_t) - 1);
+	size_t nSkip = (size_t)(nAligned - nAddr);
+
+	pCache->_pbyTTSRulesBlob = pbyTTSRulesBlob;
+	pCache->_slots = (TTSCacheSlot*)nAligned;
+	pCache->_nSlots = (NULL == pvMem || nMemLen < nSkip) ? 0 :
+			(nMemLen - nSkip) / sizeof(TTSCacheSlot);
+	//a window bigger than the table would see the same slot twice
+	if (pCache->_nSlots < TTS_CACHE_WINDOW)
+		pCache->_nSlots = 0;
+	ttsCacheReset(pCache);
+	return pCache->_nSlots;
+}
+
+
+
+void ttsCacheReset(TTSWordCache* pCache)
+{
+	for (size_t nIdx = 0; nIdx < pCache->_nSlots; ++nIdx)
+	{
+		pCache->_slots[nIdx]._wordlen = 0;
+		pCache->_slots[nIdx]._ref = 0;
+	}
+	memset(&pCache->_stats, 0, sizeof(pCache->_stats));
+}
+
+
+
+//put the phonemes in the caller's buffer with the ttsWord return conventions
+int _emitPhon(const uint8_t* pbyCached, int nCachedLen,
+		uint8_t* pbyPhon, size_t nPhonLen)
+{
+	if ((size_t)nCachedLen > nPhonLen)
+		return (int)nPhonLen - nCachedLen;	//how much /more/ is needed
+	memcpy(pbyPhon, pbyCached, nCachedLen);
+	return nCachedLen;
+}
+
+
+
+int ttsWordCached(TTSWordCache* pCache,
+		const char* pszNormWord, int nWordLen,
+		uint8_t* pbyPhon, size_t nPhonLen )
+{
+	if (nWordLen < 0)
+	{
+		nWordLen = strlen(pszNormWord);
+	}
+	if (0 == pCache->_nSlots || 0 == nWordLen || nWordLen > TTS_CACHE_MAXWORD)
+	{
+		pCache->_stats._uncacheable += 1;
+		return ttsWord(pszNormWord, nWordLen, pCache->_pbyTTSRulesBlob, pbyPhon, nPhonLen);
+	}
+
+	//look in the window.  slots are never emptied once used, so the first
+	//empty one means the word is not further along.
+	uint32_t nHash = _hashWord(pszNormWord, nWordLen);
+	size_t nHome = nHash % pCache->_nSlots;
+	TTSCacheSlot* pEmpty = NULL;
+	for (int nProbe = 0; nProbe < TTS_CACHE_WINDOW; ++nProbe)
+	{
+		TTSCacheSlot* pSlot = &pCache->_slots[(nHome + nProbe) % pCache->_nSlots];
+		if (0 == pSlot->_wordlen)
+		{
+			pEmpty = pSlot;
+			break;
+		}
+		if (nHash == pSlot->_hash && nWordLen == pSlot->_wordlen &&
+				0 == memcmp(pszNormWord, pSlot->_word, nWordLen))
+		{
+			pCache->_stats._hits += 1;
+			pSlot->_ref = 1;
+#ifdef TTS_CACHE_PHON6
+			uint8_t abyUnpacked[TTS_CACHE_MAXPHON];
+			ttsPhon6Unpack(pSlot->_phon, 0, pSlot->_phonlen, abyUnpacked);
+			return _emitPhon(abyUnpacked, pSlot->_phonlen, pbyPhon, nPhonLen);
+#else
+			return _emitPhon(pSlot->_phon, pSlot->_phonlen, pbyPhon, nPhonLen);
+#endif
+		}
+	}
+	pCache->_stats._misses += 1;
+
+	//do it the hard way, once:  into the caller's buffer if it is at least as
+	//big as a slot, and otherwise into our own scratch, so we can keep it
+	//whatever the caller's buffer size.
+	uint8_t abyScratch[TTS_CACHE_MAXPHON];
+	uint8_t* pbyWork = (nPhonLen >= sizeof(abyScratch)) ? pbyPhon : abyScratch;
+	size_t nWorkLen = (pbyWork == pbyPhon) ? nPhonLen : sizeof(abyScratch);
+	int nProduced = ttsWord(pszNormWord, nWordLen, pCache->_pbyTTSRulesBlob,
+			pbyWork, nWorkLen);
+	if (nProduced < 0 || nProduced > TTS_CACHE_MAXPHON)
+	{
+		//too long to keep.  If it didn't fit the scratch, it won't fit the
+		//caller's smaller buffer either, by that much more.
+		pCache->_stats._uncacheable += 1;
+		if (nProduced < 0 && pbyWork == abyScratch)
+			nProduced -= (int)(sizeof(abyScratch) - nPhonLen);
+		return nProduced;
+	}
+
+	//pick a slot:  an empty one if there was one, otherwise CLOCK over the
+	//window; the first one not recently used goes, clearing bits as we pass.
+	TTSCacheSlot* pVictim = pEmpty;
+	if (NULL == pVictim)
+	{
+		for (int nProbe = 0; nProbe < 2 * TTS_CACHE_WINDOW; ++nProbe)
+		{
+			TTSCacheSlot* pSlot = &pCache->_slots[(nHome + nProbe % TTS_CACHE_WINDOW) % pCache->_nSlots];
+			if (0 == pSlot->_ref)
+			{
+				pVictim = pSlot;
+				break;
+			}
+			pSlot->_ref = 0;
+		}
+		pCache->_stats._evictions += 1;
+	}
+	pVictim->_hash = nHash;
+	pVictim->_wordlen = (uint8_t)nWordLen;
+	pVictim->_phonlen = (uint8_t)nProduced;
+	pVictim->_ref = 0;
+	memcpy(pVictim->_word, pszNormWord, nWordLen);
+#ifdef TTS_CACHE_PHON6
+	ttsPhon6Pack(pbyWork, nProduced, pVictim->_phon);
+#else
+	memcpy(pVictim->_phon, pbyWork, nProduced);
+#endif
+	pCache->_stats._inserts += 1;
+
+	if (pbyWork == pbyPhon)
+		return nProduced;
+	return _emitPhon(abyScratch, nProduced, pbyPhon, nPhonLen);
+}
@@ -0,0 +1,104 @@
+
+
+#ifndef __TTS_CACHE_H
+#define __TTS_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+//an optional whole-word cache that can sit in front of ttsWord.  Real text is
+//dominated by a few common words, so remembering what they produced saves
+//running the rules again for every occurrence.
+//The cache uses only the memory given to it by the caller; it never
+//allocates.  It is an open-addressed table of fixed-size slots.  A word is
+//looked for in a short window of slots starting at its hash, and when that
+//window is full a victim is chosen from it by CLOCK (second chance).
+//Words longer than TTS_CACHE_MAXWORD, or whose phonemes are longer than
+//TTS_CACHE_MAXPHON, are simply not cached.
+//Define TTS_CACHE_PHON6 to keep the phonemes packed 6 bits to a phoneme (see
+//ttsPhon6Pack); then a slot of the same size holds a third more of them.
+
+
+#ifndef TTS_CACHE_MAXWORD
+#define TTS_CACHE_MAXWORD	20	//longest word we will cache
+#endif
+#ifndef TTS_CACHE_MAXPHON
+#ifdef TTS_CACHE_PHON6
+#define TTS_CACHE_MAXPHON	48	//longest phoneme sequence we will cache
+#else
+#define TTS_CACHE_MAXPHON	36
+#endif
+#endif
+#ifdef TTS_CACHE_PHON6
+#define TTS_CACHE_PHONBYTES	((TTS_CACHE_MAXPHON * 3 + 3) / 4)	//(TTS_PHON6_LEN)
+#else
+#define TTS_CACHE_PHONBYTES	TTS_CACHE_MAXPHON
+#endif
+#ifndef TTS_CACHE_WINDOW
+#define TTS_CACHE_WINDOW	8	//how many slots a word may be found in
+#endif
+
+
+//a cache slot.  with the default sizes this is 64 bytes.
+typedef struct TTSCacheSlot
+{
+	uint32_t	_hash;
+	uint8_t	_wordlen;	//0 means the slot is empty
+	uint8_t	_phonlen;
+	uint8_t	_ref;	//CLOCK 'recently used' bit
+	uint8_t	_pad;
+	char	_word[TTS_CACHE_MAXWORD];
+	uint8_t	_phon[TTS_CACHE_PHONBYTES];
+} TTSCacheSlot;
+
+
+//counters, so that the cache can be sized for the application
+typedef struct TTSCacheStats
+{
+	uint32_t	_hits;
+	uint32_t	_misses;
+	uint32_t	_inserts;
+	uint32_t	_evictions;
+	uint32_t	_uncacheable;	//too long, or would not fit in the scratch
+} TTSCacheStats;
+
+
+typedef struct TTSWordCache
+{
+	const uint8_t*	_pbyTTSRulesBlob;	//the rules blob this cache is for
+	TTSCacheSlot*	_slots;
+	size_t	_nSlots;
+	TTSCacheStats	_stats;
+} TTSWordCache;
+
+
+//set up a cache for a rules blob in the memory provided.  returns the number
+//of slots that fit (0 if the memory is too small to be of any use, in which
+//case ttsWordCached simply passes everything through to ttsWord).
+size_t ttsCacheInit(TTSWordCache* pCache, const uint8_t* pbyTTSRulesBlob,
+		void* pvMem, size_t nMemLen);
+
+
+//forget everything cached (e.g. if the blob's content has changed), and zero
+//the counters.
+void ttsCacheReset(TTSWordCache* pCache);
+
+
+//same contract as ttsWord, but looking in the cache first.  Note that if the
+//phonemes will not fit in the buffer the (negative) return is the same as
+//ttsWord's, but what is left in the buffer is unspecified.
+int ttsWordCached(TTSWordCache* pCache,
+		const char* pszNormWord, int nWordLen,	//the text
+		uint8_t* pbyPhon, size_t nPhonLen );	//the speech
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1246 @@
+// tts_diff.cpp : differential check of the engines against the rules.  This is
+//a separate program; build it with something like:
+//	g++ -O2 -o tts_diff tts_diff.cpp make_compact_ruleset.cpp reorder_ruleset.cpp text_to_speech.c tts_rules.c tts_cache.c tts_native.cpp tts_parallel.cpp tts_reload.cpp tts_blob.c tts_normalize.c sp0256.c -lpthread
+//
+//The only real specification of what the rules mean is the linear scan of
+//_rules[27] that _transforminput was first written as.  So here is that, as a
+//reference interpreter working directly on the TTSRule tables, and every word
+//of a corpus is run through it and through each engine:  ttsWord on the
+//compact blob in each of its forms (with and without the trie, the
+//precompiled contexts, the prefilter, v2, wide, packed, and 6-bit phonemes),
+//through the word cache, ttsNativeWord on the expanded rules, and
+//ttsWordResume.  The first word on which an engine differs is shown step by step,
+//with the rule the reference took at each step and what the engine did
+//instead.  (Define TTS_STATS for everything, and add tts_stats.cpp, to have
+//the engine's rule given exactly; otherwise it is inferred from what the engine consumed and
+//produced.)  Each is also timed, so that a speed-up can be judged along with
+//its correctness.  The vectorized scan for word boundaries and the vectorized
+//prefilter are checked against their plain versions, too, and ttsDocument on
+//several threads against the plain ttsText loop, as is that loop streamed
+//through a small buffer the way t2s does it.  Blobs with a made-up
+//exception dictionary (-dictwords) must give every entry exactly, and every
+//other word as the rules do.  Each form is mutated and cut short (-fuzz
+//times), and ttsWord run on whatever ttsBlobValidate accepts (build with
+//-fsanitize=address for this to mean much).  ttsNormalize is given some
+//cases it must get right.  And ttsWord is run on 8 threads while the ruleset
+//is swapped under them (-swaps; build with -fsanitize=thread or address for
+//this to mean much).
+//
+//Words come from -words files (one per line, as for text2speech001 -profile),
+//and -random n made-up strings of letters, apostrophes, and punctuation.
+//The exit status is 0 if every engine agreed on every word.
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <utility>
+#include <thread>
+#include <atomic>
+#include <set>
+
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+#include "text_to_speech.h"
+#include "make_compact_ruleset.h"
+#include "reorder_ruleset.h"
+#include "tts_rules.h"
+#include "tts_cache.h"
+#include "tts_native.h"
+#include "tts_parallel.h"
+#include "tts_reload.h"
+#include "tts_blob.h"
+#include "tts_normalize.h"
+#include "sp0256.h"
+#ifdef TTS_STATS
+#include "tts_stats.h"
+#endif
+
+
+//a word in its buffer.  The engine looks at the characters around a word (the
+//left context before it, and '#' and the like past its end), just as it would
+//in the text the word was plucked from, so it is padded with spaces.
+#define DIFF_PAD	8
+
+struct DiffWord
+{
+	std::vector<char>	achBuf;
+
+	explicit DiffWord(const std::string& str)
+		: achBuf(DIFF_PAD + str.size() + DIFF_PAD + 1, ' ')
+	{
+		std::copy(str.begin(), str.end(), achBuf.begin() + DIFF_PAD);
+		achBuf.back() = '\0';
+	}
+	const char* word() const { return &achBuf[DIFF_PAD]; }
+	int len() const { return (int)(achBuf.size() - 2 * DIFF_PAD - 1); }
+};
+
+
+//what one step (one bit of the word matched) did
+struct DiffStep
+{
+	int	nIdxWord;	//where in the word
+	int	nIdxRuleSect;
+	int	nIdxRule;	//which rule, or -1 if none
+	int	nConsumed;
+	VEC_BYTE	abyPhon;
+};
+typedef std::vector<DiffStep>	VEC_STEP;
+
+
+
+//the reference interpreter.  This is deliberately the plainest reading of the
+//rules, straight from the tables, with no cleverness at all.
+
+bool refIsVowel(char ch) { return NULL != strchr("aeiouy", ch) && '\0' != ch; }
+bool refIsConsonant(char ch) { return NULL != strchr("bcdfghjklmnpqrstvwxz", ch) && '\0' != ch; }
+bool refIsVoiced(char ch) { return NULL != strchr("bdgjlmnrvwz", ch) && '\0' != ch; }
+bool refIsFront(char ch) { return NULL != strchr("eiy", ch) && '\0' != ch; }
+bool refIsLiteral(char ch) { return (ch >= 'a' && ch <= 'z') || '\'' == ch || ' ' == ch; }
+
+
+//the left context, backwards from nIdxWord
+bool refMatchLeft(const char* pszWord, int nIdxWord, const char* pszCtx)
+{
+	int nIdxText = nIdxWord - 1;
+	for (int nIdxMatch = (int)strlen(pszCtx) - 1; nIdxMatch >= 0; --nIdxMatch)
+	{
+		char ch = pszCtx[nIdxMatch];
+		if (refIsLiteral(ch))
+		{
+			if (ch != pszWord[nIdxText--])
+				return false;
+		}
+		else if ('$' == ch)
+		{
+			if (0 != nIdxWord)
+				return false;
+		}
+		else if ('#' == ch)
+		{
+			if (!refIsVowel(pszWord[nIdxText--]))
+				return false;
+			while (refIsVowel(pszWord[nIdxText]))
+				--nIdxText;
+		}
+		else if (':' == ch)
+		{
+			while (refIsConsonant(pszWord[nIdxText]))
+				--nIdxText;
+		}
+		else if ('^' == ch)
+		{
+			if (!refIsConsonant(pszWord[nIdxText--]))
+				return false;
+		}
+		else if ('.' == ch)
+		{
+			if (!refIsVoiced(pszWord[nIdxText--]))
+				return false;
+		}
+		else if ('+' == ch)
+		{
+			if (!refIsFront(pszWord[nIdxText--]))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+//the right context, forwards from nIdxWord
+bool refMatchRight(const char* pszWord, int nWordLen, int nIdxWord, const char* pszCtx)
+{
+	int nIdxText = nIdxWord;
+	for (const char* pch = pszCtx; '\0' != *pch; ++pch)
+	{
+		char ch = *pch;
+		if (refIsLiteral(ch))
+		{
+			if (ch != pszWord[nIdxText++])
+				return false;
+		}
+		else if ('$' == ch)
+		{
+			if (nWordLen != nIdxWord)
+				return false;
+		}
+		else if ('#' == ch)
+		{
+			if (!refIsVowel(pszWord[nIdxText++]))
+				return false;
+			while (refIsVowel(pszWord[nIdxText]))
+				++nIdxText;
+		}
+		else if (':' == ch)
+		{
+			while (refIsConsonant(pszWord[nIdxText]))
+				++nIdxText;
+		}
+		else if ('^' == ch)
+		{
+			if (!refIsConsonant(pszWord[nIdxText++]))
+				return false;
+		}
+		else if ('.' == ch)
+		{
+			if (!refIsVoiced(pszWord[nIdxText++]))
+				return false;
+		}
+		else if ('+' == ch)
+		{
+			if (!refIsFront(pszWord[nIdxText++]))
+				return false;
+		}
+		else if ('%' == ch)
+		{
+			//-e, -ed, -er, -es, -ely; or -i, -ing
+			if ('e' == pszWord[nIdxText])
+			{
+				++nIdxText;
+				if ('l' == pszWord[nIdxText] && 'y' == pszWord[nIdxText + 1])
+					nIdxText += 2;
+				else if ('r' == pszWord[nIdxText] || 's' == pszWord[nIdxText] || 'd' == pszWord[nIdxText])
+					++nIdxText;
+			}
+			else if ('i' == pszWord[nIdxText])
+			{
+				++nIdxText;
+				if ('n' == pszWord[nIdxText])
+				{
+					if ('g' != pszWord[nIdxText + 1])
+						return false;
+					nIdxText += 2;
+				}
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+//the whole word, step by step
+void refWord(const DiffWord& word, const TTSRule* const* apRules, VEC_BYTE& abyPhon,
+		VEC_STEP* pSteps)
+{
+	const char* pszWord = word.word();
+	int nWordLen = word.len();
+	abyPhon.clear();
+	int nIdxWord = 0;
+	while (nIdxWord < nWordLen)
+	{
+		char ch = pszWord[nIdxWord];
+		DiffStep step;
+		step.nIdxWord = nIdxWord;
+		step.nIdxRuleSect = (ch >= 'a' && ch <= 'z') ? ch - 'a' + 1 : 0;
+		step.nIdxRule = -1;
+		step.nConsumed = 1;	//(if nothing matches, skip the character)
+		const TTSRule* pRules = apRules[step.nIdxRuleSect];
+		for (int nIdxRule = 0; NULL != pRules[nIdxRule]._bracket; ++nIdxRule)
+		{
+			const TTSRule& rule = pRules[nIdxRule];
+			int nLen = (int)strlen(rule._bracket);
+			if (nIdxWord + nLen > nWordLen || 0 != strncmp(&pszWord[nIdxWord], rule._bracket, nLen))
+				continue;
+			if (!refMatchLeft(pszWord, nIdxWord, rule._left) ||
+					!refMatchRight(pszWord, nWordLen, nIdxWord + nLen, rule._right))
+				continue;
+			step.nIdxRule = nIdxRule;
+			step.nConsumed = nLen;
+			for (size_t nIdx = 0; nIdx < rule._phone._len; ++nIdx)
+				step.abyPhon.push_back((uint8_t)(rule._phone._phone[nIdx] - 1));	//(see makeDeDups)
+			break;
+		}
+		abyPhon.insert(abyPhon.end(), step.abyPhon.begin(), step.abyPhon.end());
+		nIdxWord += step.nConsumed;
+		if (NULL != pSteps)
+			pSteps->push_back(step);
+	}
+}
+
+
+
+//an engine under test:  something that does what ttsWord does
+struct DiffEngine
+{
+	std::string	strName;
+	VEC_BYTE	abyBlob;	//the blob it uses (for stepping through it), if any
+	std::function<int(const DiffWord&, uint8_t*, size_t)>	fnWord;
+	size_t	nDiffs;
+	double	dSecs;
+};
+
+
+//step through a word with the engine's blob, as ttsWord does
+void engineSteps(const DiffWord& word, const uint8_t* pbyTTSRulesBlob, VEC_STEP& steps)
+{
+	const char* pszWord = word.word();
+	int nWordLen = word.len();
+	int nIdxWord = 0;
+#ifdef TTS_STATS
+	//(there must be room to count every rule of this blob)
+	if (g_ttsStats._nRuleHits < (uint32_t)_getRuleIndexAll(pbyTTSRulesBlob, 26,
+			_getRuleSectionLength(pbyTTSRulesBlob, 26)))
+		ttsStatsReset(pbyTTSRulesBlob);
+#endif
+	while (nIdxWord < nWordLen)
+	{
+		char ch = pszWord[nIdxWord];
+		DiffStep step;
+		step.nIdxWord = nIdxWord;
+		step.nIdxRuleSect = (ch >= 'a' && ch <= 'z') ? ch - 'a' + 1 : 0;
+		step.nIdxRule = -1;
+		uint8_t abyPhon[256];
+		int nRem = (int)sizeof(abyPhon);
+#ifdef TTS_STATS
+		int nIdxFirst = _getRuleIndexAll(pbyTTSRulesBlob, step.nIdxRuleSect, 0);
+		int nRules = _getRuleSectionLength(pbyTTSRulesBlob, step.nIdxRuleSect);
+		std::vector<uint32_t> anHitsBefore(&g_ttsStats._anRuleHits[nIdxFirst],
+				&g_ttsStats._anRuleHits[nIdxFirst + nRules]);
+#endif
+		step.nConsumed = _transforminput(pszWord, nWordLen, nIdxWord, pbyTTSRulesBlob,
+				step.nIdxRuleSect, abyPhon, &nRem);
+		step.abyPhon.assign(abyPhon, abyPhon + (sizeof(abyPhon) - nRem));
+#ifdef TTS_STATS
+		//the rule whose count went up
+		for (int nIdxRule = 0; nIdxRule < nRules; ++nIdxRule)
+		{
+			if (g_ttsStats._anRuleHits[nIdxFirst + nIdxRule] != anHitsBefore[nIdxRule])
+				step.nIdxRule = nIdxRule;
+		}
+#else
+		//the first rule that would have done that
+		int nRules = _getRuleSectionLength(pbyTTSRulesBlob, step.nIdxRuleSect);
+		for (int nIdxRule = 0; nIdxRule < nRules && step.nIdxRule < 0; ++nIdxRule)
+		{
+			TTSRule_compact rule;
+			_reconstitute_rule(pbyTTSRulesBlob, step.nIdxRuleSect, nIdxRule, &rule);
+			uint8_t abyRulePhon[255];
+			_getRulePhone(&rule, abyRulePhon);
+			if (rule._nBracket == step.nConsumed &&
+					0 == memcmp(rule._bracket, &pszWord[nIdxWord], rule._nBracket) &&
+					rule._nPhone == step.abyPhon.size() &&
+					0 == memcmp(abyRulePhon, step.abyPhon.data(), rule._nPhone))
+				step.nIdxRule = nIdxRule;
+		}
+#endif
+		nIdxWord += step.nConsumed;
+		steps.push_back(step);
+	}
+}
+
+
+
+std::string phonText(const VEC_BYTE& abyPhon)
+{
+	std::string str;
+	for (uint8_t by : abyPhon)
+	{
+		if (!str.empty())
+			str += ' ';
+		str += (by < SP0256_ALLOPHONES) ? g_apszSP0256Name[by] : "??";
+	}
+	return str;
+}
+
+
+std::string ruleText(const TTSRule* const* apRules, int nIdxRuleSect, int nIdxRule)
+{
+	if (nIdxRule < 0)
+		return "(no rule)";
+	const TTSRule& rule = apRules[nIdxRuleSect][nIdxRule];
+	std::ostringstream oss;
+	oss << (0 == nIdxRuleSect ? std::string("punc") : std::string(1, (char)('a' + nIdxRuleSect - 1))) <<
+			"#" << nIdxRule << " " << rule._left << "[" << rule._bracket << "]" << rule._right;
+	return oss.str();
+}
+
+
+//show where an engine went astray on a word
+void reportDiff(const DiffWord& word, const TTSRule* const* apRules, const DiffEngine& engine,
+		const VEC_BYTE& abyRef, const VEC_BYTE& abyGot)
+{
+	std::cout << "DIFF " << engine.strName << ":  '" << std::string(word.word(), word.len()) << "'" << std::endl <<
+			"  reference:  " << phonText(abyRef) << std::endl <<
+			"  engine:     " << phonText(abyGot) << std::endl;
+	VEC_STEP refSteps, engSteps;
+	VEC_BYTE abyPhon;
+	refWord(word, apRules, abyPhon, &refSteps);
+	if (!engine.abyBlob.empty())
+		engineSteps(word, engine.abyBlob.data(), engSteps);
+	for (size_t nIdx = 0; nIdx < refSteps.size() || nIdx < engSteps.size(); ++nIdx)
+	{
+		const DiffStep* pRef = nIdx < refSteps.size() ? &refSteps[nIdx] : NULL;
+		const DiffStep* pEng = nIdx < engSteps.size() ? &engSteps[nIdx] : NULL;
+		bool bSame = NULL != pRef && NULL != pEng && pRef->nIdxWord == pEng->nIdxWord &&
+				pRef->nConsumed == pEng->nConsumed && pRef->abyPhon == pEng->abyPhon;
+		if (NULL != pRef)
+		{
+			std::cout << ((bSame || engine.abyBlob.empty()) ? "   " : " * ") << "@" << pRef->nIdxWord << " ref " <<
+					ruleText(apRules, pRef->nIdxRuleSect, pRef->nIdxRule) << " = " <<
+					phonText(pRef->abyPhon) << std::endl;
+		}
+		if (engine.abyBlob.empty())
+			continue;	//(no steps to compare; just show the reference's)
+		if (NULL != pEng && !bSame)
+		{
+			std::cout << " * @" << pEng->nIdxWord << " eng " <<
+#ifndef TTS_STATS
+					"(by what it did) " <<
+#endif
+					ruleText(apRules, pEng->nIdxRuleSect, pEng->nIdxRule) << " = " <<
+					phonText(pEng->abyPhon) << std::endl;
+		}
+		if (!bSame)
+			break;	//after that, the steps mean nothing
+	}
+}
+
+
+
+//made-up words:  mostly common letters, some of anything a word can have
+void addRandomWords(std::vector<std::string>& words, size_t nWords, unsigned int nSeed)
+{
+	static const char achCommon[] = "etaoinshrdlucmfwypvbgk";
+	static const char achAny[] = "abcdefghijklmnopqrstuvwxyz'/,:;!-.?";
+	srand(nSeed);
+	for (size_t nIdx = 0; nIdx < nWords; ++nIdx)
+	{
+		std::string str;
+		for (int nLen = 1 + rand() % 14; nLen > 0; --nLen)
+		{
+			str += (0 != rand() % 5) ? achCommon[rand() % (sizeof(achCommon) - 1)] :
+					achAny[rand() % (sizeof(achAny) - 1)];
+		}
+		words.push_back(str);
+	}
+}
+
+
+//the vectorized character scans against the plain one.  Every start in
+//buffers of every length up to a few vectors, so that every tail (1 to 31
+//bytes) is left for the finish at some point; runs of one class with the odd
+//character of the other, and bytes of anything, high bits and all.  The
+//buffers are exactly their length, so reading past one shows under ASan.
+size_t checkScan(unsigned int nSeed)
+{
+	static const char achWord[] = "abcmxyzABCMXYZ'/,:;!-.?";
+	static const char achOther[] = " \t\n09\"()#@`[{\x7f\x80\xa0\xc1\xdb\xe1\xfa\xff";
+	typedef size_t (*PFN_SCAN)(const char* pszText, size_t nIdx, size_t nLen, int bWord);
+	std::vector<std::pair<const char*, PFN_SCAN> > scans;
+#ifdef TTS_X86_SIMD
+	scans.push_back(std::make_pair("sse2", &_scanClassSSE2));
+	if (_haveAVX2())
+		scans.push_back(std::make_pair("avx2", &_scanClassAVX2));
+#endif
+	size_t nDiffs = 0;
+	srand(nSeed);
+	for (int nRound = 0; nRound < 200; ++nRound)
+	{
+		for (size_t nLen = 1; nLen <= 100; ++nLen)
+		{
+			std::vector<char> ach(nLen);
+			int nKind = rand() % 3;
+			for (char& ch : ach)
+			{
+				if (0 == nKind)
+					ch = (char)(rand() % 256);
+				else if ((1 == nKind) == (0 != rand() % 12))
+					ch = achWord[rand() % (sizeof(achWord) - 1)];
+				else
+					ch = achOther[rand() % (sizeof(achOther) - 1)];
+			}
+			for (size_t nIdx = 0; nIdx <= nLen; ++nIdx)
+			{
+				for (int bWord = 0; bWord < 2; ++bWord)
+				{
+					size_t nRef = _scanClassScalar(ach.data(), nIdx, nLen, bWord);
+					for (const auto& scan : scans)
+					{
+						size_t nGot = scan.second(ach.data(), nIdx, nLen, bWord);
+						if (nGot == nRef)
+							continue;
+						if (0 == nDiffs)
+						{
+							std::cout << "DIFF scan " << scan.first << ":  for " <<
+									(bWord ? "word" : "non-word") << " from " << nIdx <<
+									" of " << nLen << " bytes, reference " << nRef <<
+									", got " << nGot << std::endl << "  bytes:";
+							for (char ch : ach)
+								std::cout << " " << std::hex << std::setw(2) << std::setfill('0') <<
+										(unsigned int)(uint8_t)ch << std::dec << std::setfill(' ');
+							std::cout << std::endl;
+						}
+						nDiffs += 1;
+					}
+				}
+			}
+		}
+	}
+	return nDiffs;
+}
+
+
+//the vectorized prefilter against the plain one:  the whole mask, for every
+//run of lanes in every rule group of a prefiltered blob, with the start of
+//each of the group's brackets (and some made-up text) as the word, and every
+//length left up to TTS_PF_MAXLEN.
+size_t checkPrefilter(const uint8_t* pbyTTSRulesBlob, unsigned int nSeed)
+{
+	size_t nDiffs = 0;
+#ifdef TTS_X86_SIMD
+	static const char achAny[] = "abcdefghijklmnopqrstuvwxyz'/,:;!-.? ";
+	const uint8_t* pbyPF = &pbyTTSRulesBlob[_getBlobExtension(pbyTTSRulesBlob, TTS_BLOB_EXT_PREFILTER)];
+	size_t nStride = ((const uint16_t*)pbyPF)[1];
+	srand(nSeed);
+	for (int nIdxRuleSect = 0; nIdxRuleSect < 27; ++nIdxRuleSect)
+	{
+		int nRules = _getRuleSectionLength(pbyTTSRulesBlob, nIdxRuleSect);
+		const uint8_t* pbyLen = &pbyPF[2 * sizeof(uint16_t) +
+				_getRuleIndexAll(pbyTTSRulesBlob, nIdxRuleSect, 0)];
+		//the words' starts, TTS_PF_CHARS to each, 0 past the end
+		VEC_BYTE abyTexts;
+		for (int nIdxRule = 0; nIdxRule < nRules; ++nIdxRule)
+		{
+			TTSRule_compact rule;
+			_reconstitute_rule(pbyTTSRulesBlob, nIdxRuleSect, nIdxRule, &rule);
+			for (int nIdxChar = 0; nIdxChar < TTS_PF_CHARS; ++nIdxChar)
+				abyTexts.push_back(nIdxChar < rule._nBracket ? rule._bracket[nIdxChar] : 0);
+		}
+		for (int nIdxText = 0; nIdxText < 32; ++nIdxText)
+		{
+			int nLen = rand() % (TTS_PF_CHARS + 1);
+			for (int nIdxChar = 0; nIdxChar < TTS_PF_CHARS; ++nIdxChar)
+				abyTexts.push_back(nIdxChar < nLen ? achAny[rand() % (sizeof(achAny) - 1)] : 0);
+		}
+		for (int nIdxBase = 0; nIdxBase < nRules; nIdxBase += TTS_PF_LANES)
+		{
+			for (size_t nIdxText = 0; nIdxText < abyTexts.size(); nIdxText += TTS_PF_CHARS)
+			{
+				for (int nRem = 0; nRem <= TTS_PF_MAXLEN; ++nRem)
+				{
+					uint32_t nRef = _prefilterScalar(&pbyLen[nIdxBase], nStride, &abyTexts[nIdxText], nRem);
+					uint32_t nGot = _prefilterSSE2(&pbyLen[nIdxBase], nStride, &abyTexts[nIdxText], nRem);
+					if (nGot == nRef)
+						continue;
+					if (0 == nDiffs)
+					{
+						std::cout << "DIFF prefilter sse2:  group " << nIdxRuleSect << " lanes from " <<
+								nIdxBase << ", '" << std::string((const char*)&abyTexts[nIdxText],
+										strnlen((const char*)&abyTexts[nIdxText], TTS_PF_CHARS)) <<
+								"' with " << nRem << " left, reference " << std::hex << nRef <<
+								", got " << nGot << std::dec << std::endl;
+					}
+					nDiffs += 1;
+				}
+			}
+		}
+	}
+#else
+	(void)pbyTTSRulesBlob;
+	(void)nSeed;
+#endif
+	return nDiffs;
+}
+
+
+//text, as ttsText is given:  random words with spaces, line ends, digits and
+//the like between them, some capitalized, and often a partial word at the end
+std::string makeDocument(size_t nWords)
+{
+	static const char* apszSep[] = { " ", " ", " ", "  ", "\n", "\r\n", "\t", " 1984 ", " $", "\" ", " (" };
+	std::vector<std::string> words;
+	addRandomWords(words, nWords, (unsigned int)rand());
+	std::string strText;
+	for (std::string& strWord : words)
+	{
+		if (0 == rand() % 4)
+			strWord[0] = (char)toupper(strWord[0]);
+		strText += strWord;
+		strText += apszSep[rand() % (sizeof(apszSep) / sizeof(apszSep[0]))];
+	}
+	if (!strText.empty() && 0 != rand() % 3)
+		strText.resize(strText.size() - 1);	//(usually, the last word is then partial)
+	return strText;
+}
+
+
+//the plain ttsText loop over a whole text, as ttsDocument is to match.
+//returns how much was consumed.
+size_t seqDocument(const std::string& str, const uint8_t* pbyTTSRulesBlob, VEC_BYTE& abyPhon)
+{
+	std::string strText(" " + str);	//(lower-cased in place; see DiffWord for the space)
+	abyPhon.clear();
+	size_t nDone = 0;
+	for (;;)
+	{
+		uint8_t abyPhonBuf[1024];
+		int nConsumed = 0;
+		int nRet = ttsText(&strText[1] + nDone, (int)(str.size() - nDone), pbyTTSRulesBlob,
+				abyPhonBuf, sizeof(abyPhonBuf), &nConsumed);
+		if (nRet < 0 || 0 == nConsumed)
+			break;
+		abyPhon.insert(abyPhon.end(), abyPhonBuf, abyPhonBuf + nRet);
+		nDone += nConsumed;
+	}
+	return nDone;
+}
+
+
+//the ttsText loop as t2s streams it:  the text is read into a buffer of nBufLen
+//(after a space; see DiffWord) as there is room, what can be converted is,
+//and the partial word left is moved back to the start for next time.  At the
+//end a line end bounds the last word.  (The buffer is exactly its length, so
+//under ASan reading outside it shows.)
+void streamDocument(const std::string& str, const uint8_t* pbyTTSRulesBlob, size_t nBufLen,
+		VEC_BYTE& abyPhon)
+{
+	std::vector<char> achBuf(1 + nBufLen);
+	achBuf[0] = ' ';
+	char* pchText = &achBuf[1];
+	abyPhon.clear();
+	size_t nIdxRead = 0;
+	size_t nHave = 0;
+	bool bEOF = false;
+	while (!bEOF || 0 != nHave)
+	{
+		if (!bEOF)
+		{
+			size_t nRead = std::min(nBufLen - nHave, str.size() - nIdxRead);
+			memcpy(&pchText[nHave], &str[nIdxRead], nRead);
+			nIdxRead += nRead;
+			if (0 == nRead)
+			{
+				bEOF = true;
+				pchText[nHave++] = '\n';
+			}
+			nHave += nRead;
+		}
+		size_t nDone = 0;
+		for (;;)
+		{
+			uint8_t abyPhonBuf[1024];
+			int nConsumed = 0;
+			int nRet = ttsText(&pchText[nDone], (int)(nHave - nDone), pbyTTSRulesBlob,
+					abyPhonBuf, sizeof(abyPhonBuf), &nConsumed);
+			if (nRet < 0 || (0 == nRet && 0 == nConsumed))
+				break;
+			abyPhon.insert(abyPhon.end(), abyPhonBuf, abyPhonBuf + nRet);
+			nDone += nConsumed;
+		}
+		memmove(&pchText[0], &pchText[nDone], nHave - nDone);
+		nHave -= nDone;
+		if (bEOF)
+			nHave = 0;
+	}
+}
+
+
+//ttsDocument against the plain loop, on several threads and with chunks of
+//all sizes:  tiny ones, and ones ending exactly at the start or end of a word
+//(where the chunk must be stretched to the next bounding character).
+size_t checkDocument(const uint8_t* pbyTTSRulesBlob, unsigned int nSeed)
+{
+	static const unsigned int anThreads[] = { 1, 2, 3, 8 };
+	size_t nDiffs = 0;
+	srand(nSeed);
+	for (int nRound = 0; nRound < 100; ++nRound)
+	{
+		std::string strText = makeDocument(rand() % 300);
+		VEC_BYTE abyRef;
+		size_t nRefConsumed = seqDocument(strText, pbyTTSRulesBlob, abyRef);
+		//the chunk lengths:  a few fixed, and the word edges in the first part
+		std::vector<size_t> anChunkLens = { 1, 2, 5, 64, 1000, 64 * 1024 };
+		for (size_t nIdx = 1; nIdx < strText.size() && nIdx < 120; ++nIdx)
+		{
+			if ((0 != _classifyChar(strText[nIdx - 1])) != (0 != _classifyChar(strText[nIdx])))
+				anChunkLens.push_back(nIdx);
+		}
+		for (size_t nChunkLen : anChunkLens)
+		{
+			unsigned int nThreads = anThreads[rand() % (sizeof(anThreads) / sizeof(anThreads[0]))];
+			VEC_BYTE abyGot;
+			size_t nConsumed = ttsDocument(strText.c_str(), strText.size(), pbyTTSRulesBlob,
+					abyGot, nThreads, nChunkLen);
+			if (abyGot == abyRef && nConsumed == nRefConsumed)
+				continue;
+			if (0 == nDiffs)
+			{
+				std::cout << "DIFF document:  " << nThreads << " threads, chunks of " << nChunkLen <<
+						", consumed " << nConsumed << " (reference " << nRefConsumed << ") of '" <<
+						strText << "'" << std::endl <<
+						"  reference:  " << phonText(abyRef) << std::endl <<
+						"  engine:     " << phonText(abyGot) << std::endl;
+			}
+			nDiffs += 1;
+		}
+		//and streamed through a small buffer, as t2s does, which must make what
+		//the plain loop does of all of it
+		VEC_BYTE abyRefAll;
+		seqDocument(strText + "\n", pbyTTSRulesBlob, abyRefAll);
+		for (size_t nBufLen : { 32, 57, 256 })
+		{
+			VEC_BYTE abyGot;
+			streamDocument(strText, pbyTTSRulesBlob, nBufLen, abyGot);
+			if (abyGot == abyRefAll)
+				continue;
+			if (0 == nDiffs)
+			{
+				std::cout << "DIFF document:  streamed through " << nBufLen << " bytes, '" <<
+						strText << "'" << std::endl <<
+						"  reference:  " << phonText(abyRefAll) << std::endl <<
+						"  engine:     " << phonText(abyGot) << std::endl;
+			}
+			nDiffs += 1;
+		}
+	}
+	return nDiffs;
+}
+
+
+//a made-up exception dictionary:  words of letters and apostrophes (none of
+//them in the corpus, which is checked against the rules), each with made-up
+//phonemes (6-bit ones, so that a -phon6 blob can hold them)
+void makeRandomDict(MAP_EXCEPTIONS& dict, size_t nEntries,
+		const std::vector<std::string>& words, unsigned int nSeed)
+{
+	static const char achWord[] = "etaoinshrdlucmfwypvbgkjqxz'";
+	std::set<std::string> corpus(words.begin(), words.end());
+	srand(nSeed);
+	while (dict.size() < nEntries)
+	{
+		std::string str;
+		for (int nLen = 1 + rand() % 20; nLen > 0; --nLen)
+			str += achWord[rand() % (sizeof(achWord) - 1)];
+		if (corpus.end() != corpus.find(str))
+			continue;
+		VEC_BYTE abyPhon(1 + rand() % 48);
+		for (uint8_t& by : abyPhon)
+			by = (uint8_t)(rand() % 64);
+		dict[str] = abyPhon;
+	}
+}
+
+
+//every entry of the dictionary, through each engine made with it:  ttsWord
+//must give its phonemes exactly, or say that it needs one more if given one
+//too few, and ttsWordResume must give them a phoneme at a time.  (The words
+//that aren't in it are checked against the reference with the other engines.)
+size_t checkDict(const std::vector<DiffEngine>& engines, const MAP_EXCEPTIONS& dict)
+{
+	size_t nDiffs = 0;
+	for (const DiffEngine& engine : engines)
+	{
+		const uint8_t* pbyBlob = engine.abyBlob.data();
+		for (const auto& entry : dict)
+		{
+			DiffWord word(entry.first);
+			const VEC_BYTE& abyRef = entry.second;
+			uint8_t abyPhon[256];
+			int nRet = ttsWord(word.word(), word.len(), pbyBlob, abyPhon, sizeof(abyPhon));
+			VEC_BYTE abyGot(abyPhon, abyPhon + (nRet > 0 ? nRet : 0));
+			int nShort = ttsWord(word.word(), word.len(), pbyBlob, abyPhon, abyRef.size() - 1);
+			TTSWordState state;
+			ttsWordStateInit(&state);
+			VEC_BYTE abyResumed;
+			while ( ! state._bDone && abyResumed.size() < sizeof(abyPhon))
+			{
+				if (0 == ttsWordResume(&state, word.word(), word.len(), pbyBlob, abyPhon, 1))
+					break;
+				abyResumed.push_back(abyPhon[0]);
+			}
+			if (abyGot == abyRef && -1 == nShort && abyResumed == abyRef)
+				continue;
+			if (0 == nDiffs)
+			{
+				std::cout << "DIFF " << engine.strName << ":  dictionary entry '" << entry.first <<
+						"'" << std::endl <<
+						"  entry:       " << phonText(abyRef) << std::endl <<
+						"  ttsWord:     " << phonText(abyGot) << " (" << nShort <<
+						" with one too few)" << std::endl <<
+						"  resumed:     " << phonText(abyResumed) << std::endl;
+			}
+			nDiffs += 1;
+		}
+	}
+	return nDiffs;
+}
+
+
+//blobs that can't be trusted:  each form of the blob, with bytes flipped,
+//words of it overwritten, or cut short, nRounds times.  Whatever
+//ttsBlobValidate accepts, ttsWord must be able to run on without going outside
+//it, which only means much built with -fsanitize=address (each blob is copied
+//to a buffer of exactly its length, so that reading past it shows).  The
+//forms as they were must all be accepted, and ttsWord must never produce more
+//than it was given room for.  returns how many of those went wrong.
+size_t checkBlobFuzz(const std::vector<DiffEngine>& engines, const std::vector<DiffWord>& diffwords,
+		unsigned int nSeed, size_t nRounds, size_t* pnAccepted)
+{
+	size_t nDiffs = 0;
+	size_t nAccepted = 0;
+	for (const DiffEngine& engine : engines)
+	{
+		int nErr = ttsBlobValidate(engine.abyBlob.data(), engine.abyBlob.size());
+		if (TTS_BLOB_OK == nErr)
+			continue;
+		std::cout << "DIFF blob:  the " << engine.strName << " blob doesn't validate (" <<
+				ttsBlobErrorText(nErr) << ")" << std::endl;
+		nDiffs += 1;
+	}
+	srand(nSeed);
+	for (size_t nRound = 0; nRound < nRounds; ++nRound)
+	{
+		const VEC_BYTE& abyFrom = engines[rand() % engines.size()].abyBlob;
+		size_t nLen = abyFrom.size();
+		if (0 == rand() % 4)
+			nLen = rand() % (nLen + 1);
+		uint8_t* pbyBlob = new uint8_t[nLen];
+		memcpy(pbyBlob, abyFrom.data(), nLen);
+		for (int nMutes = rand() % 4; nMutes > 0; --nMutes)
+		{
+			if (0 == nLen)
+				break;
+			//mostly in the header and indices, where a change matters most
+			size_t nIdx = (0 != rand() % 2) ? rand() % std::min(nLen, (size_t)256) : rand() % nLen;
+			switch (rand() % 4)
+			{
+			case 0: pbyBlob[nIdx] ^= (uint8_t)(1 << (rand() % 8)); break;
+			case 1: pbyBlob[nIdx] = (uint8_t)rand(); break;
+			case 2: pbyBlob[nIdx] = (0 != rand() % 2) ? 0x00 : 0xff; break;
+			case 3:
+				for (size_t nIdxByte = nIdx; nIdxByte < nLen && nIdxByte < nIdx + 4; ++nIdxByte)
+					pbyBlob[nIdxByte] = (uint8_t)rand();
+				break;
+			}
+		}
+		if (TTS_BLOB_OK == ttsBlobValidate(pbyBlob, nLen))
+		{
+			nAccepted += 1;
+			for (int nWord = 0; nWord < 16; ++nWord)
+			{
+				const DiffWord& word = diffwords[rand() % diffwords.size()];
+				uint8_t abyPhon[64];
+				size_t nPhonLen = 1 + rand() % sizeof(abyPhon);
+				int nRet = ttsWord(word.word(), word.len(), pbyBlob, abyPhon, nPhonLen);
+				if (nRet <= (int)nPhonLen)
+					continue;
+				if (0 == nDiffs)
+				{
+					std::cout << "DIFF blob:  ttsWord made " << nRet << " phonemes of '" <<
+							std::string(word.word(), word.len()) << "' in room for " << nPhonLen <<
+							", on a mutated " << abyFrom.size() << "-byte blob" << std::endl;
+				}
+				nDiffs += 1;
+			}
+		}
+		delete[] pbyBlob;
+	}
+	*pnAccepted = nAccepted;
+	return nDiffs;
+}
+
+
+//ttsWord on several threads, each acquiring whatever ruleset is current for
+//each word, while this one swaps it nSwaps times for another form of the blob
+//(they all say the same).  Every word must still come out as the reference
+//has it; and built with -fsanitize=thread or address, there must be no
+//reports (a ruleset freed under a reader, or never freed at all).
+size_t checkReload(const std::vector<DiffEngine>& engines, size_t nForms,
+		const std::vector<DiffWord>& diffwords, const std::vector<VEC_BYTE>& refs,
+		size_t nSwaps)
+{
+	if (0 == nSwaps || diffwords.empty())
+		return 0;
+	int nErr;
+	TTSRulesetSlot slot;
+	ttsRulesetSlotInit(slot, ttsRulesetFromBlob(engines[0].abyBlob, &nErr));
+	std::atomic<bool> bStop(false);
+	std::atomic<size_t> nDiffs(0);
+	std::atomic<size_t> nWords(0);
+	auto reader = [&](size_t nIdxFirst)
+	{
+		size_t nIdx = nIdxFirst;
+		while ( ! bStop.load(std::memory_order_relaxed))
+		{
+			const DiffWord& word = diffwords[nIdx % diffwords.size()];
+			const VEC_BYTE& abyRef = refs[nIdx % diffwords.size()];
+			nIdx += 1;
+			TTSRuleset* pRuleset = ttsRulesetAcquire(slot);
+			uint8_t abyPhon[256];
+			int nRet = ttsWord(word.word(), word.len(), ttsRulesetBlob(pRuleset),
+					abyPhon, sizeof(abyPhon));
+			ttsRulesetRelease(pRuleset);
+			nWords.fetch_add(1, std::memory_order_relaxed);
+			if (VEC_BYTE(abyPhon, abyPhon + (nRet > 0 ? nRet : 0)) == abyRef)
+				continue;
+			if (0 == nDiffs.fetch_add(1))
+			{
+				std::cout << "DIFF reload:  '" << std::string(word.word(), word.len()) <<
+						"' during a swap" << std::endl;
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	for (size_t nIdxThread = 0; nIdxThread < 8; ++nIdxThread)
+		threads.push_back(std::thread(reader, nIdxThread * diffwords.size() / 8));
+	for (size_t nIdxSwap = 0; nIdxSwap < nSwaps; ++nIdxSwap)
+	{
+		TTSRuleset* pRuleset = ttsRulesetFromBlob(engines[(nIdxSwap + 1) % nForms].abyBlob, &nErr);
+		if (NULL == pRuleset)
+		{
+			std::cout << "DIFF reload:  the " << engines[(nIdxSwap + 1) % nForms].strName <<
+					" blob doesn't validate (" << nErr << ")" << std::endl;
+			nDiffs.fetch_add(1);
+			break;
+		}
+		ttsRulesetSwap(slot, pRuleset);
+	}
+	bStop = true;
+	for (std::thread& thread : threads)
+		thread.join();
+	ttsRulesetSlotFini(slot);
+	std::cout << "reload:  " << nSwaps << " swaps under " << nWords.load() << " words" << std::endl;
+	return nDiffs.load();
+}
+
+
+//what the normalizer must make of some text (some of it once got wrong)
+static const struct { const char* pszText; const char* pszNorm; } g_aNormCases[] = {
+	{ "Dr. Smith paid $3.50 on May 21st, 1984 (10% off)",
+		"doctor Smith paid three dollars and fifty cents on May twenty first, nineteen eighty four (ten percent off)" },
+	{ "call 555 1234", "call five hundred fifty five one thousand two hundred thirty four" },
+	{ "1999 5555", "one thousand nine hundred ninety nine five thousand five hundred fifty five" },
+	{ "from 1939-1945", "from nineteen thirty nine-nineteen forty five" },
+	{ "in 2005 and 2024", "in two thousand five and twenty twenty four" },
+	{ "the 1980s", "the nineteen eighties" },
+	{ "$.50", "fifty cents" },
+	{ "-$5", "minus five dollars" },
+	{ "-$5.25 or -5", "minus five dollars and twenty five cents or minus five" },
+	{ "x-5", "x-five" },
+	{ "$.512345678901234567890",
+		"dollars.five one two three four five six seven eight nine zero one two three four five six seven eight nine zero" },
+};
+
+
+//normalize all of a text, given to the normalizer nPiece characters at a time
+std::string normStream(const std::string& str, size_t nPiece)
+{
+	TTSNormalizer norm;
+	ttsNormalizeInit(&norm);
+	std::string strPending;
+	std::string strNorm;
+	size_t nIdx = 0;
+	for (;;)
+	{
+		size_t nMore = std::min(nPiece, str.size() - nIdx);
+		strPending.append(str, nIdx, nMore);
+		nIdx += nMore;
+		int bEnd = nIdx == str.size();
+		char achOut[TTS_NORM_MAXOUT];
+		int nConsumed = 0;
+		int nOut = ttsNormalize(&norm, strPending.c_str(), (int)strPending.size(), bEnd,
+				achOut, sizeof(achOut), &nConsumed);
+		strNorm.append(achOut, nOut);
+		strPending.erase(0, nConsumed);
+		if (bEnd && (strPending.empty() || (0 == nOut && 0 == nConsumed)))
+			break;
+	}
+	return strNorm;
+}
+
+
+//the normalizer on those, all at once and a character at a time
+size_t checkNormalize()
+{
+	size_t nDiffs = 0;
+	for (const auto& normcase : g_aNormCases)
+	{
+		for (size_t nPiece : { strlen(normcase.pszText), (size_t)1 })
+		{
+			std::string strNorm = normStream(normcase.pszText, nPiece);
+			if (strNorm == normcase.pszNorm)
+				continue;
+			std::cout << "DIFF normalize:  '" << normcase.pszText << "'" <<
+					(1 == nPiece ? " (a character at a time)" : "") << std::endl <<
+					"  expected:  '" << normcase.pszNorm << "'" << std::endl <<
+					"  got:       '" << strNorm << "'" << std::endl;
+			nDiffs += 1;
+		}
+	}
+	return nDiffs;
+}
+
+
+void usage()
+{
+	std::cerr << "usage: tts_diff [-words file]... [-random n] [-seed n] [-swaps n] [-dictwords n] [-fuzz n] [-all]" << std::endl <<
+		"  checks every engine against the reference interpreter on the words" << std::endl <<
+		"  -swaps n  how many times to swap the ruleset under 8 threads (default 2000)" << std::endl <<
+		"  -dictwords n  how many made-up words in the exception dictionary (default 20000)" << std::endl <<
+		"  -fuzz n  how many mutated blobs to validate, and run if accepted (default 50000)" << std::endl;
+}
+
+
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> words;
+	size_t nRandom = 0;
+	unsigned int nSeed = 1;
+	bool bAll = false;	//report every differing word, not just the first
+	size_t nSwaps = 2000;
+	size_t nDictWords = 20000;
+	size_t nFuzz = 50000;
+	for (int nIdxArg = 1; nIdxArg < argc; ++nIdxArg)
+	{
+		std::string strArg(argv[nIdxArg]);
+		if ("-words" == strArg && nIdxArg + 1 < argc)
+		{
+			VEC_WORDFREQ wordfreq;
+			if (!loadWordFreq(argv[++nIdxArg], wordfreq))
+			{
+				std::cerr << "can't read " << argv[nIdxArg] << std::endl;
+				return 2;
+			}
+			for (const auto& wf : wordfreq)
+				words.push_back(wf.first);
+		}
+		else if ("-random" == strArg && nIdxArg + 1 < argc)
+			nRandom = strtoul(argv[++nIdxArg], NULL, 10);
+		else if ("-seed" == strArg && nIdxArg + 1 < argc)
+			nSeed = (unsigned int)strtoul(argv[++nIdxArg], NULL, 10);
+		else if ("-swaps" == strArg && nIdxArg + 1 < argc)
+			nSwaps = strtoul(argv[++nIdxArg], NULL, 10);
+		else if ("-dictwords" == strArg && nIdxArg + 1 < argc)
+			nDictWords = strtoul(argv[++nIdxArg], NULL, 10);
+		else if ("-fuzz" == strArg && nIdxArg + 1 < argc)
+			nFuzz = strtoul(argv[++nIdxArg], NULL, 10);
+		else if ("-all" == strArg)
+			bAll = true;
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+	if (words.empty() && 0 == nRandom)
+		nRandom = 100000;
+	addRandomWords(words, nRandom, nSeed);
+	std::vector<DiffWord> diffwords;
+	for (const std::string& str : words)
+		diffwords.push_back(DiffWord(str));
+
+	//the engines:  the blob in each of its forms, and the cache
+	static const struct { const char* pszName; unsigned int nOpts; } aForms[] = {
+		{ "plain", MCR_OPT_NONE },
+		{ "trie", MCR_OPT_TRIE },
+		{ "ctxcode", MCR_OPT_CTXCODE },
+		{ "prefilter", MCR_OPT_PREFILTER },
+		{ "trie+ctxcode", MCR_OPT_TRIE | MCR_OPT_CTXCODE },
+		{ "prefilter+ctxcode", MCR_OPT_PREFILTER | MCR_OPT_CTXCODE },
+		{ "v2", MCR_OPT_V2 },
+		{ "wide", MCR_OPT_WIDE | MCR_OPT_TRIE | MCR_OPT_CTXCODE },
+		{ "pack", MCR_OPT_PACK | MCR_OPT_PREFILTER },
+		{ "phon6", MCR_OPT_PHON6 },
+		{ "pack+phon6", MCR_OPT_PACK | MCR_OPT_PHON6 | MCR_OPT_TRIE },
+	};
+	std::vector<DiffEngine> engines;
+	for (const auto& form : aForms)
+	{
+		DiffEngine engine;
+		engine.strName = form.pszName;
+		if (!make_compact_ruleset(engine.abyBlob, form.nOpts))
+		{
+			std::cerr << "can't make the " << form.pszName << " blob" << std::endl;
+			return 2;
+		}
+		engines.push_back(engine);
+	}
+	//with an exception dictionary of words the corpus hasn't got, the rest of
+	//the words must still be as the rules have them
+	MAP_EXCEPTIONS dict;
+	makeRandomDict(dict, nDictWords, words, nSeed);
+	static const struct { const char* pszName; unsigned int nOpts; } aDictForms[] = {
+		{ "dict", MCR_OPT_NONE },
+		{ "dict+pack+phon6", MCR_OPT_PACK | MCR_OPT_PHON6 | MCR_OPT_PREFILTER },
+	};
+	std::vector<DiffEngine> dictengines;
+	for (const auto& form : aDictForms)
+	{
+		DiffEngine engine;
+		engine.strName = form.pszName;
+		if (!make_compact_ruleset(engine.abyBlob, form.nOpts, NULL, &dict))
+		{
+			std::cerr << "can't make the " << form.pszName << " blob" << std::endl;
+			return 2;
+		}
+		engines.push_back(engine);
+		dictengines.push_back(engine);
+	}
+	for (DiffEngine& engine : engines)
+	{
+		const uint8_t* pbyBlob = engine.abyBlob.data();
+		engine.fnWord = [pbyBlob](const DiffWord& word, uint8_t* pbyPhon, size_t nPhonLen)
+				{ return ttsWord(word.word(), word.len(), pbyBlob, pbyPhon, nPhonLen); };
+	}
+	//(the cache is checked on its second sight of each word, too)
+	static TTSCacheSlot aSlots[4096];
+	TTSWordCache cache;
+	ttsCacheInit(&cache, engines[0].abyBlob.data(), aSlots, sizeof(aSlots));
+	DiffEngine cached;
+	cached.strName = "cached";
+	cached.abyBlob = engines[0].abyBlob;
+	cached.fnWord = [&cache](const DiffWord& word, uint8_t* pbyPhon, size_t nPhonLen)
+			{
+				ttsWordCached(&cache, word.word(), word.len(), pbyPhon, nPhonLen);
+				return ttsWordCached(&cache, word.word(), word.len(), pbyPhon, nPhonLen);
+			};
+	engines.push_back(cached);
+	static TTSNativeRules native;
+	if (!ttsNativeInit(native))
+	{
+		std::cerr << "can't expand the rules" << std::endl;
+		return 2;
+	}
+	DiffEngine nativeengine;
+	nativeengine.strName = "native";
+	nativeengine.fnWord = [](const DiffWord& word, uint8_t* pbyPhon, size_t nPhonLen)
+			{ return ttsNativeWord(native, word.word(), word.len(), pbyPhon, nPhonLen); };
+	engines.push_back(nativeengine);
+	//ttsWordResume, a phoneme at a time (the worst case for it)
+	DiffEngine resumed;
+	resumed.strName = "resumed";
+	resumed.abyBlob = engines[0].abyBlob;
+	const uint8_t* pbyResumeBlob = engines[0].abyBlob.data();
+	resumed.fnWord = [pbyResumeBlob](const DiffWord& word, uint8_t* pbyPhon, size_t nPhonLen)
+			{
+				TTSWordState state;
+				ttsWordStateInit(&state);
+				size_t nProduced = 0;
+				while ( ! state._bDone && nProduced < nPhonLen)
+					nProduced += ttsWordResume(&state, word.word(), word.len(), pbyResumeBlob,
+							&pbyPhon[nProduced], 1);
+				return (int)nProduced;
+			};
+	engines.push_back(resumed);
+
+	//the reference, and its time
+	std::vector<VEC_BYTE> refs(diffwords.size());
+	auto tmStart = std::chrono::steady_clock::now();
+	for (size_t nIdx = 0; nIdx < diffwords.size(); ++nIdx)
+		refWord(diffwords[nIdx], _rules, refs[nIdx], NULL);
+	double dRefSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - tmStart).count();
+
+	//each engine against it
+	for (DiffEngine& engine : engines)
+	{
+		engine.nDiffs = 0;
+		//first timed, then checked (so that the checking isn't timed)
+		std::vector<VEC_BYTE> gots(diffwords.size());
+		tmStart = std::chrono::steady_clock::now();
+		for (size_t nIdx = 0; nIdx < diffwords.size(); ++nIdx)
+		{
+			uint8_t abyPhon[256];
+			int nRet = engine.fnWord(diffwords[nIdx], abyPhon, sizeof(abyPhon));
+			gots[nIdx].assign(abyPhon, abyPhon + (nRet > 0 ? nRet : 0));
+		}
+		engine.dSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - tmStart).count();
+		for (size_t nIdx = 0; nIdx < diffwords.size(); ++nIdx)
+		{
+			if (gots[nIdx] == refs[nIdx])
+				continue;
+			if (0 == engine.nDiffs || bAll)
+				reportDiff(diffwords[nIdx], _rules, engine, refs[nIdx], gots[nIdx]);
+			engine.nDiffs += 1;
+		}
+	}
+
+	//and the kernels under them
+	size_t nScanDiffs = checkScan(nSeed);
+	VEC_BYTE abyPrefilterBlob;
+	make_compact_ruleset(abyPrefilterBlob, MCR_OPT_PREFILTER);
+	size_t nPrefilterDiffs = checkPrefilter(abyPrefilterBlob.data(), nSeed);
+	//and ttsDocument, which is all of them on several threads
+	size_t nDocumentDiffs = checkDocument(engines[0].abyBlob.data(), nSeed);
+	//and what the dictionary says itself
+	size_t nDictDiffs = checkDict(dictengines, dict);
+	//and blobs that have been tampered with, from each form (with a dictionary
+	//small enough to copy quickly), on some of the words and the dictionary's
+	size_t nForms = sizeof(aForms) / sizeof(aForms[0]);
+	std::vector<DiffEngine> fuzzengines(engines.begin(), engines.begin() + nForms);
+	MAP_EXCEPTIONS smalldict;
+	std::vector<DiffWord> fuzzwords(diffwords.begin(),
+			diffwords.begin() + std::min(diffwords.size(), (size_t)1000));
+	for (const auto& entry : dict)
+	{
+		if (smalldict.size() == 64)
+			break;
+		smalldict.insert(entry);
+		fuzzwords.push_back(DiffWord(entry.first));
+	}
+	for (const auto& form : aDictForms)
+	{
+		DiffEngine engine;
+		engine.strName = form.pszName;
+		make_compact_ruleset(engine.abyBlob, form.nOpts, NULL, &smalldict);
+		fuzzengines.push_back(engine);
+	}
+	size_t nFuzzAccepted = 0;
+	size_t nFuzzDiffs = checkBlobFuzz(fuzzengines, fuzzwords, nSeed, nFuzz, &nFuzzAccepted);
+	//and the normalizer in front of them
+	size_t nNormDiffs = checkNormalize();
+	//and the rulesets being swapped under it all
+	size_t nReloadDiffs = checkReload(engines, nForms, diffwords, refs, nSwaps);
+
+	//the summary
+	size_t nDiffsAll = nScanDiffs + nPrefilterDiffs + nDocumentDiffs + nDictDiffs + nFuzzDiffs +
+			nNormDiffs + nReloadDiffs;
+	std::cout << std::left << std::setw(20) << "engine" << std::right <<
+			std::setw(10) << "diffs" << std::setw(14) << "ns/word" << std::setw(14) << "words/sec" <<
+			std::setw(10) << "vs ref" << std::endl;
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << std::left << std::setw(20) << "reference" << std::right <<
+			std::setw(10) << "-" << std::setw(14) << dRefSecs * 1e9 / diffwords.size() <<
+			std::setw(14) << std::setprecision(0) << diffwords.size() / dRefSecs <<
+			std::setw(10) << std::setprecision(2) << 1.0 << std::setprecision(1) << std::endl;
+	for (const DiffEngine& engine : engines)
+	{
+		nDiffsAll += engine.nDiffs;
+		std::cout << std::left << std::setw(20) << engine.strName << std::right <<
+				std::setw(10) << engine.nDiffs << std::setw(14) << engine.dSecs * 1e9 / diffwords.size() <<
+				std::setw(14) << std::setprecision(0) << diffwords.size() / engine.dSecs <<
+				std::setw(10) << std::setprecision(2) << dRefSecs / engine.dSecs << std::setprecision(1) << std::endl;
+	}
+	std::cout << "scan kernels:  " << nScanDiffs << " differences" << std::endl;
+	std::cout << "prefilter kernel:  " << nPrefilterDiffs << " differences" << std::endl;
+	std::cout << "ttsDocument:  " << nDocumentDiffs << " differences" << std::endl;
+	std::cout << "dictionary:  " << dict.size() << " entries; " << nDictDiffs << " differences" << std::endl;
+	std::cout << "mutated blobs:  " << nFuzz << ", " << nFuzzAccepted << " accepted; " <<
+			nFuzzDiffs << " differences" << std::endl;
+	std::cout << "normalizer:  " << nNormDiffs << " differences" << std::endl;
+	std::cout << "ruleset swaps:  " << nReloadDiffs << " differences" << std::endl;
+	std::cout << diffwords.size() << " words; " << nDiffsAll << " differences" << std::endl;
+
+	return 0 == nDiffsAll ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include "tts_native.h"
+#include "text_to_speech.h"
+
+#include <string.h>
+#include <ctype.h>
+
+
+
+bool ttsNativeInit(TTSNativeRules& native, const TTSRule* const* apRules)
+{
+	if (NULL == apRules)
+		apRules = _rules;
+	native._rules.clear();
+	for (int nIdxRuleSect = 0; nIdxRuleSect < 27; ++nIdxRuleSect)
+	{
+		native._anSect[nIdxRuleSect] = (uint32_t)native._rules.size();
+		for (const TTSRule* pRule = apRules[nIdxRuleSect]; NULL != pRule->_bracket; ++pRule)
+		{
+			size_t nBracket = strlen(pRule->_bracket);
+			size_t nLeft = strlen(pRule->_left);
+			size_t nRight = strlen(pRule->_right);
+			if (nBracket + nLeft + nRight + pRule->_phone._len > TTS_NATIVE_MAXTEXT)
+				return false;
+			TTSNativeRule rule;
+			memset(&rule, 0, sizeof(rule));
+			rule._nBracket = (uint8_t)nBracket;
+			rule._nLeft = (uint8_t)nLeft;
+			rule._nRight = (uint8_t)nRight;
+			rule._nPhone = (uint8_t)pRule->_phone._len;
+			memcpy(&rule._abyText[0], pRule->_bracket, nBracket);
+			memcpy(&rule._abyText[nBracket], pRule->_left, nLeft);
+			memcpy(&rule._abyText[nBracket + nLeft], pRule->_right, nRight);
+			//the rules' phonemes are all +1 (see makeDeDups)
+			uint8_t* pbyPhone = &rule._abyText[nBracket + nLeft + nRight];
+			for (size_t nIdx = 0; nIdx < pRule->_phone._len; ++nIdx)
+				pbyPhone[nIdx] = (uint8_t)(pRule->_phone._phone[nIdx] - 1);
+			native._rules.push_back(rule);
+		}
+	}
+	native._anSect[27] = (uint32_t)native._rules.size();
+	return true;
+}
+
+
+
+//as _transforminput
+static int _transforminputNative(const TTSNativeRules& native,
+		const char* pszNormWord, size_t nWordLen, size_t nIdxWord, int nIdxRuleSect,
+		uint8_t* pbyPhon, int* pnPhonLen)
+{
+	const TTSNativeRule* pRule = &native._rules[native._anSect[nIdxRuleSect]];
+	const TTSNativeRule* pRuleEnd = native._rules.data() + native._anSect[nIdxRuleSect + 1];
+	for (; pRule != pRuleEnd; ++pRule)
+	{
+		//the bracket must all be there.  (they are short; a loop beats memcmp)
+		size_t nIdxText = nIdxWord + pRule->_nBracket;
+		if (nIdxText > nWordLen)
+			continue;
+		const uint8_t* pbyBracket = pRule->bracket();
+		size_t nIdxMatch = 0;
+		while (nIdxMatch < pRule->_nBracket &&
+				(uint8_t)pszNormWord[nIdxWord + nIdxMatch] == pbyBracket[nIdxMatch])
+			nIdxMatch += 1;
+		if (nIdxMatch != pRule->_nBracket)
+			continue;
+		if ( ! _matchLeft(pszNormWord, nWordLen, nIdxWord, pRule->left(), pRule->_nLeft))
+			continue;
+		if ( ! _matchRight(pszNormWord, nWordLen, nIdxText, pRule->right(), pRule->_nRight))
+			continue;
+		//match! push the associated phoneme sequence
+		if (*pnPhonLen >= pRule->_nPhone)	//enough space?
+			memcpy(pbyPhon, pRule->phone(), pRule->_nPhone);
+		*pnPhonLen -= pRule->_nPhone;	//reduce by what we took (or would have taken)
+		return pRule->_nBracket;
+	}
+	return 1;	//must always consume something
+}
+
+
+
+int ttsNativeWord(const TTSNativeRules& native,
+		const char* pszNormWord, int nWordLen,
+		uint8_t* pbyPhon, size_t nPhonLen)
+{
+	if (nWordLen < 0)
+	{
+		nWordLen = strlen(pszNormWord);
+	}
+	int nProduced = 0;
+	int nIdxWord = 0;
+	while (nIdxWord < nWordLen)
+	{
+		//use the first character to skip to a section of rules
+		char chNow = (char)tolower(pszNormWord[nIdxWord]);
+		int nIdxRuleSect = (chNow >= 'a' && chNow <= 'z') ? chNow - 'a' + 1 : 0;
+
+		int nRemBefore = (nProduced < 0) ? 0 : (nPhonLen - nProduced);
+		int nRemAfter = nRemBefore;
+		nIdxWord += _transforminputNative(native, pszNormWord, nWordLen, nIdxWord,
+				nIdxRuleSect, pbyPhon, &nRemAfter);
+		if (nRemAfter < 0)	//out of room; track the additional space needed, as ttsWord
+		{
+			if (nProduced >= 0)
+			{
+				nProduced = 0;
+				pbyPhon = NULL;
+			}
+			nProduced += nRemAfter;
+		}
+		else
+		{
+			int nTaken = nRemBefore - nRemAfter;
+			pbyPhon += nTaken;
+			nProduced += nTaken;
+		}
+	}
+
+	return nProduced;
+}
@@ -0,0 +1,66 @@
+#ifndef __TTS_NATIVE_H
+#define __TTS_NATIVE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "tts_rules.h"
+
+//The rules used directly (host only; C++), for servers, where it's throughput
+//that matters and not the size of the rules.  The compact blob is made for
+//flash:  every probe of it decodes offsets and reads length prefixes.  Here
+//the rules are expanded once, at startup, into records that have everything
+//in them (the strings and phonemes inline, their lengths known, and the
+//phonemes' +1 undone), and no pointers, so a rule is one read of a single
+//cache line.  It is otherwise the same engine (the contexts are matched by
+//the same _matchLeft/_matchRight), and ttsNativeWord is ttsWord:
+//	TTSNativeRules native;
+//	ttsNativeInit(native);
+//	ttsNativeWord(native, pszWord, nLen, abyPhon, sizeof(abyPhon));
+//There is no exception dictionary; words are always done by the rules.
+
+
+//the most a rule can have, in all:  bracket, contexts, and phonemes
+#define TTS_NATIVE_MAXTEXT	28
+
+
+//a rule.  These are 32 bytes, and aligned so, so that none spans two cache
+//lines (and two share one).
+struct alignas(32) TTSNativeRule
+{
+	uint8_t	_nBracket;
+	uint8_t	_nLeft;
+	uint8_t	_nRight;
+	uint8_t	_nPhone;
+	//the bracket, then the left and right contexts, then the phonemes
+	uint8_t	_abyText[TTS_NATIVE_MAXTEXT];
+
+	const uint8_t* bracket() const { return &_abyText[0]; }
+	const uint8_t* left() const { return &_abyText[_nBracket]; }
+	const uint8_t* right() const { return &_abyText[_nBracket + _nLeft]; }
+	const uint8_t* phone() const { return &_abyText[_nBracket + _nLeft + _nRight]; }
+};
+
+
+//all the rules, by section, in their order of precedence.  Section
+//nIdxRuleSect is [_anSect[nIdxRuleSect],_anSect[nIdxRuleSect+1]) of _rules.
+struct TTSNativeRules
+{
+	std::vector<TTSNativeRule>	_rules;
+	uint32_t	_anSect[27 + 1];
+};
+
+
+//expand the rules (_rules, unless some other set of 27 groups is given).
+//returns false if a rule has too much in it for a record (see
+//TTS_NATIVE_MAXTEXT); the compact blob will still do for such rules.
+bool ttsNativeInit(TTSNativeRules& native, const TTSRule* const* apRules = NULL);
+
+
+//same contract as ttsWord, with the expanded rules instead of a blob
+int ttsNativeWord(const TTSNativeRules& native,
+		const char* pszNormWord, int nWordLen,	//the text
+		uint8_t* pbyPhon, size_t nPhonLen);	//the speech
+
+
+#endif
@@ -0,0 +1,785 @@
+#include "tts_normalize.h"
+
+#include <string.h>
+
+
+
+//the most digits read as a number (to 999 trillion); a longer run is read one
+//digit at a time.  A fraction is read one digit at a time anyway, up to this.
+#define TTS_NORM_MAXDIGITS	15
+
+//the most letters before an abbreviation's first '.'
+#define TTS_NORM_MAXABBREV	7
+
+
+//what a character might need.  Anything that is 0 is copied as it is, and
+//that is checked a character at a time, so it is a table.
+enum
+{
+	NORM_COPY = 0,
+	NORM_DIGIT,
+	NORM_DOT,	//the end of an abbreviation?
+	NORM_MINUS,	//a sign?
+	NORM_SYMBOL,	//see g_aNormSymbol
+	NORM_CURRENCY,	//the first byte of one of g_aNormCurrency
+};
+
+static const uint8_t g_abyNormClass[256] = {
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//00
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//10
+	0,0,0,4,5,4,4,0,0,0,0,4,0,3,2,0,	//20  # $ % & + - .
+	1,1,1,1,1,1,1,1,1,1,0,0,0,4,0,0,	//30  0-9 =
+	4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//40  @
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//50
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//60
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//70
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//80
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//90
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//a0
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//b0
+	0,0,5,0,0,0,0,0,0,0,0,0,0,0,0,0,	//c0  (UTF-8 pound, yen)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//d0
+	0,0,5,0,0,0,0,0,0,0,0,0,0,0,0,0,	//e0  (UTF-8 euro)
+	0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,	//f0
+};
+
+
+typedef struct TTSNormPair
+{
+	const char*	pszFrom;
+	const char*	pszTo;
+} TTSNormPair;
+
+typedef struct TTSNormCurrency
+{
+	const char*	pszSymbol;	//(UTF-8)
+	const char*	pszOne;
+	const char*	pszMany;
+	const char*	pszCent;	//NULL if there's no such thing
+	const char*	pszCents;
+} TTSNormCurrency;
+
+//the words numbers are made of.  Each is kept with the space before it, and
+//padded, so that it can be put as one block of 16 bytes.
+typedef struct TTSNormWord
+{
+	char	ach[15];
+	uint8_t	nLen;	//(with the space)
+} TTSNormWord;
+
+#define NORM_WORD(s)	{ " " s, sizeof(s) }
+
+static const TTSNormWord g_aNormOnes[20] = {
+	NORM_WORD("zero"), NORM_WORD("one"), NORM_WORD("two"), NORM_WORD("three"),
+	NORM_WORD("four"), NORM_WORD("five"), NORM_WORD("six"), NORM_WORD("seven"),
+	NORM_WORD("eight"), NORM_WORD("nine"), NORM_WORD("ten"), NORM_WORD("eleven"),
+	NORM_WORD("twelve"), NORM_WORD("thirteen"), NORM_WORD("fourteen"),
+	NORM_WORD("fifteen"), NORM_WORD("sixteen"), NORM_WORD("seventeen"),
+	NORM_WORD("eighteen"), NORM_WORD("nineteen"),
+};
+
+static const TTSNormWord g_aNormTens[10] = {
+	NORM_WORD(""), NORM_WORD(""), NORM_WORD("twenty"), NORM_WORD("thirty"),
+	NORM_WORD("forty"), NORM_WORD("fifty"), NORM_WORD("sixty"), NORM_WORD("seventy"),
+	NORM_WORD("eighty"), NORM_WORD("ninety"),
+};
+
+static const TTSNormWord g_aNormScale[5] = {
+	NORM_WORD(""), NORM_WORD("thousand"), NORM_WORD("million"), NORM_WORD("billion"),
+	NORM_WORD("trillion"),
+};
+
+static const TTSNormWord g_normHundred = NORM_WORD("hundred");
+static const TTSNormWord g_normOh = NORM_WORD("oh");
+static const TTSNormWord g_normPoint = NORM_WORD("point");
+static const TTSNormWord g_normMinus = NORM_WORD("minus");
+static const TTSNormWord g_normAnd = NORM_WORD("and");
+
+//the ordinals that aren't just +th (or y -> ieth)
+static const TTSNormPair g_aNormOrdinal[] = {
+	{ "one", "first" }, { "two", "second" }, { "three", "third" }, { "five", "fifth" },
+	{ "eight", "eighth" }, { "nine", "ninth" }, { "twelve", "twelfth" },
+};
+
+static const TTSNormPair g_aNormSymbol[] = {
+	{ "#", "number" }, { "%", "percent" }, { "&", "and" }, { "+", "plus" },
+	{ "=", "equals" }, { "@", "at" },
+};
+
+static const TTSNormCurrency g_aNormCurrency[] = {
+	{ "$", "dollar", "dollars", "cent", "cents" },
+	{ "\xc2\xa3", "pound", "pounds", "penny", "pence" },
+	{ "\xe2\x82\xac", "euro", "euros", "cent", "cents" },
+	{ "\xc2\xa5", "yen", "yen", NULL, NULL },
+};
+
+//abbreviations, lower case, with their '.'s.  (Not ones that are also common
+//words at the end of a sentence, like 'no.')  These are in order, for a binary
+//search, and since each ends with a '.', none is the start of another.
+static const TTSNormPair g_aNormAbbrev[] = {
+	{ "approx.", "approximately" }, { "apr.", "april" }, { "aug.", "august" },
+	{ "ave.", "avenue" }, { "blvd.", "boulevard" }, { "co.", "company" },
+	{ "corp.", "corporation" }, { "dec.", "december" }, { "dept.", "department" },
+	{ "dr.", "doctor" }, { "e.g.", "for example" }, { "etc.", "et cetera" },
+	{ "feb.", "february" }, { "govt.", "government" }, { "i.e.", "that is" },
+	{ "inc.", "incorporated" }, { "jan.", "january" }, { "jr.", "junior" },
+	{ "jul.", "july" }, { "jun.", "june" }, { "ltd.", "limited" }, { "mar.", "march" },
+	{ "mr.", "mister" }, { "mrs.", "missus" }, { "ms.", "miz" }, { "mt.", "mount" },
+	{ "nov.", "november" }, { "oct.", "october" }, { "prof.", "professor" },
+	{ "rd.", "road" }, { "sep.", "september" }, { "sept.", "september" },
+	{ "sr.", "senior" }, { "st.", "saint" }, { "vs.", "versus" },
+};
+
+#define NORM_COUNTOF(a)	(sizeof(a) / sizeof((a)[0]))
+
+
+
+static __inline int _isNormDigit(char ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+static __inline int _isNormLetter(char ch)
+{
+	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z');
+}
+
+static __inline int _isNormAlnum(char ch)
+{
+	return _isNormDigit(ch) || _isNormLetter(ch);
+}
+
+static __inline char _normLower(char ch)
+{
+	return (ch >= 'A' && ch <= 'Z') ? (char)(ch + 'a' - 'A') : ch;
+}
+
+
+//the character at nIdx, or 0 if the text ends first (which is noted in
+//*pbShort; if it isn't the end, what we'd do can't be known yet)
+static __inline char _normAt(const char* pszText, size_t nIdx, size_t nLen, int* pbShort)
+{
+	if (nIdx < nLen)
+		return pszText[nIdx];
+	*pbShort = 1;
+	return 0;
+}
+
+
+//how many digits there are from nIdx, but counting no further than is too
+//many to read as a number
+static size_t _normDigitRun(const char* pszText, size_t nIdx, size_t nLen)
+{
+	size_t nDigits = 0;
+	while (nIdx + nDigits < nLen && nDigits <= TTS_NORM_MAXDIGITS &&
+			_isNormDigit(pszText[nIdx + nDigits]))
+		++nDigits;
+	return nDigits;
+}
+
+
+
+//an expansion, as it is made.  Every word is put with a space before it, the
+//first one too; that is dropped if it isn't wanted.  (The 16 extra are so that
+//a TTSNormWord can always be put whole.)
+typedef struct TTSNormOut
+{
+	char	_ach[TTS_NORM_MAXOUT + 16];
+	size_t	_nLen;
+} TTSNormOut;
+
+
+//(the words are short; a loop beats strlen and memcpy)
+static __inline void _normAppend(TTSNormOut* pOut, const char* psz)
+{
+	size_t nLen = pOut->_nLen;
+	while (0 != *psz && nLen < TTS_NORM_MAXOUT)	//(it can't be full; see TTS_NORM_MAXOUT)
+		pOut->_ach[nLen++] = *psz++;
+	pOut->_nLen = nLen;
+}
+
+
+static __inline void _normPutWord(TTSNormOut* pOut, const TTSNormWord* pWord)
+{
+	if (pOut->_nLen + pWord->nLen > TTS_NORM_MAXOUT)
+		return;
+	memcpy(&pOut->_ach[pOut->_nLen], pWord->ach, sizeof(*pWord));
+	pOut->_nLen += pWord->nLen;
+}
+
+
+static void _normPut(TTSNormOut* pOut, const char* pszWord)
+{
+	_normAppend(pOut, " ");
+	_normAppend(pOut, pszWord);
+}
+
+
+//the start of the last word put
+static size_t _normLastWord(const TTSNormOut* pOut)
+{
+	size_t nIdx = pOut->_nLen;
+	while (nIdx > 0 && ' ' != pOut->_ach[nIdx - 1])
+		--nIdx;
+	return nIdx;
+}
+
+
+//make the last word an ordinal:  'twenty one' -> 'twenty first'
+static void _normOrdinal(TTSNormOut* pOut)
+{
+	size_t nIdxWord = _normLastWord(pOut);
+	size_t nWord = pOut->_nLen - nIdxWord;
+	for (size_t nIdx = 0; nIdx < NORM_COUNTOF(g_aNormOrdinal); ++nIdx)
+	{
+		const char* pszFrom = g_aNormOrdinal[nIdx].pszFrom;
+		if (strlen(pszFrom) == nWord && 0 == memcmp(&pOut->_ach[nIdxWord], pszFrom, nWord))
+		{
+			pOut->_nLen = nIdxWord;
+			_normAppend(pOut, g_aNormOrdinal[nIdx].pszTo);
+			return;
+		}
+	}
+	if ('y' == pOut->_ach[pOut->_nLen - 1])
+	{
+		--pOut->_nLen;
+		_normAppend(pOut, "ieth");
+	}
+	else
+		_normAppend(pOut, "th");
+}
+
+
+//make the last word plural:  'nineteen eighty' -> 'nineteen eighties'
+static void _normPlural(TTSNormOut* pOut)
+{
+	char chLast = pOut->_ach[pOut->_nLen - 1];
+	if ('y' == chLast)
+	{
+		--pOut->_nLen;
+		_normAppend(pOut, "ies");
+	}
+	else
+		_normAppend(pOut, ('x' == chLast) ? "es" : "s");
+}
+
+
+//[1,99]; nothing for 0
+static void _normTens(TTSNormOut* pOut, uint32_t nValue)
+{
+	if (nValue >= 20)
+	{
+		_normPutWord(pOut, &g_aNormTens[nValue / 10]);
+		nValue %= 10;
+		if (0 != nValue)
+			_normPutWord(pOut, &g_aNormOnes[nValue]);
+	}
+	else if (0 != nValue)
+		_normPutWord(pOut, &g_aNormOnes[nValue]);
+}
+
+
+static void _normCardinal(TTSNormOut* pOut, uint64_t nValue)
+{
+	if (0 == nValue)
+	{
+		_normPutWord(pOut, &g_aNormOnes[0]);
+		return;
+	}
+	uint32_t anGroup[NORM_COUNTOF(g_aNormScale)];
+	int nGroups = 0;
+	while (0 != nValue)
+	{
+		anGroup[nGroups++] = (uint32_t)(nValue % 1000);
+		nValue /= 1000;
+	}
+	while (nGroups-- > 0)
+	{
+		uint32_t nGroup = anGroup[nGroups];
+		if (0 == nGroup)
+			continue;
+		if (nGroup >= 100)
+		{
+			_normPutWord(pOut, &g_aNormOnes[nGroup / 100]);
+			_normPutWord(pOut, &g_normHundred);
+		}
+		_normTens(pOut, nGroup % 100);
+		if (0 != nGroups)
+			_normPutWord(pOut, &g_aNormScale[nGroups]);
+	}
+}
+
+
+//as a year, in pairs:  'nineteen eighty four', 'nineteen oh five', 'nineteen hundred'
+static void _normYear(TTSNormOut* pOut, uint32_t nValue)
+{
+	_normTens(pOut, nValue / 100);
+	nValue %= 100;
+	if (0 == nValue)
+		_normPutWord(pOut, &g_normHundred);
+	else if (nValue < 10)
+	{
+		_normPutWord(pOut, &g_normOh);
+		_normPutWord(pOut, &g_aNormOnes[nValue]);
+	}
+	else
+		_normTens(pOut, nValue);
+}
+
+
+//whether a number starts at nIdx:  digits (not too many to read as one), or
+//for an amount of money, maybe a '.' first.  Digits that run to the end of
+//the text are noted in *pbShort; there might yet be too many.
+static int _normIsNumber(const char* pszText, size_t nIdx, size_t nLen, int bMoney,
+		int* pbShort)
+{
+	char ch = _normAt(pszText, nIdx, nLen, pbShort);
+	if (bMoney && '.' == ch)
+		ch = _normAt(pszText, ++nIdx, nLen, pbShort);
+	if (!_isNormDigit(ch))
+		return 0;
+	size_t nDigits = _normDigitRun(pszText, nIdx, nLen);
+	if (nDigits > TTS_NORM_MAXDIGITS)
+		return 0;
+	if (nIdx + nDigits == nLen)
+		*pbShort = 1;
+	return 1;
+}
+
+
+//read a number with its digits (or an amount's '.') starting at nIdx (with a
+//sign or currency before it, if given).  bAfterGroup says it comes just after
+//another run of digits, as in '555 1234', which isn't a year.  returns where
+//it ends, or 0 if the text ends too soon to tell.  (The caller has seen that
+//the digits aren't too many.)
+static size_t _normNumber(const char* pszText, size_t nIdx, size_t nLen, int bEnd,
+		int bMinus, const TTSNormCurrency* pCur, int bAfterGroup, TTSNormOut* pOut)
+{
+	int bShort = 0;
+	size_t nPos = nIdx;
+
+	//the whole part, maybe with thousands separators
+	uint64_t nWhole = 0;
+	size_t nDigits = 0;
+	while (_isNormDigit(_normAt(pszText, nPos, nLen, &bShort)))
+	{
+		nWhole = nWhole * 10 + (uint64_t)(pszText[nPos++] - '0');
+		++nDigits;
+	}
+	int bGrouped = 0;
+	if (nDigits <= 3)
+	{
+		while (',' == _normAt(pszText, nPos, nLen, &bShort) &&
+				nDigits + 3 <= TTS_NORM_MAXDIGITS &&
+				_isNormDigit(_normAt(pszText, nPos + 1, nLen, &bShort)) &&
+				_isNormDigit(_normAt(pszText, nPos + 2, nLen, &bShort)) &&
+				_isNormDigit(_normAt(pszText, nPos + 3, nLen, &bShort)) &&
+				!_isNormDigit(_normAt(pszText, nPos + 4, nLen, &bShort)))
+		{
+			for (size_t nIdxDigit = nPos + 1; nIdxDigit < nPos + 4; ++nIdxDigit)
+				nWhole = nWhole * 10 + (uint64_t)(pszText[nIdxDigit] - '0');
+			nPos += 4;
+			nDigits += 3;
+			bGrouped = 1;
+		}
+	}
+
+	//the fraction
+	size_t nIdxFrac = 0;
+	size_t nFrac = 0;
+	if ('.' == _normAt(pszText, nPos, nLen, &bShort) &&
+			_isNormDigit(_normAt(pszText, nPos + 1, nLen, &bShort)))
+	{
+		nIdxFrac = ++nPos;
+		while (nFrac < TTS_NORM_MAXDIGITS && _isNormDigit(_normAt(pszText, nPos, nLen, &bShort)))
+		{
+			++nPos;
+			++nFrac;
+		}
+	}
+
+	//'1st', '2nd', ..., or '1980s'
+	int bOrdinal = 0;
+	int bPlural = 0;
+	if (0 == nFrac && NULL == pCur)
+	{
+		char ch1 = _normLower(_normAt(pszText, nPos, nLen, &bShort));
+		char ch2 = _isNormLetter(ch1) ? _normLower(_normAt(pszText, nPos + 1, nLen, &bShort)) : 0;
+		if ('s' == ch1 && !_isNormLetter(ch2))
+		{
+			bPlural = 1;
+			nPos += 1;
+		}
+		else if ((('s' == ch1 && 't' == ch2) || ('n' == ch1 && 'd' == ch2) ||
+				('r' == ch1 && 'd' == ch2) || ('t' == ch1 && 'h' == ch2)) &&
+				!_isNormLetter(_normAt(pszText, nPos + 2, nLen, &bShort)))
+		{
+			bOrdinal = 1;
+			nPos += 2;
+		}
+	}
+
+	//a year is four digits on their own, in the years people mostly mean
+	//(2000-2009 is said as a number anyway), and not one of several groups of
+	//digits, like a phone number
+	int bYear = 4 == nDigits && !bGrouped && 0 == nFrac && NULL == pCur && !bMinus &&
+			!bOrdinal && !bAfterGroup &&
+			((nWhole >= 1900 && nWhole <= 1999) || (nWhole >= 2010 && nWhole <= 2099));
+	if (bYear && ' ' == _normAt(pszText, nPos, nLen, &bShort) &&
+			_isNormDigit(_normAt(pszText, nPos + 1, nLen, &bShort)))
+		bYear = 0;
+
+	if (bShort && !bEnd)
+		return 0;
+
+	if (bMinus)
+		_normPutWord(pOut, &g_normMinus);
+	if (NULL != pCur && NULL != pCur->pszCent && nFrac <= 2)
+	{
+		//money:  'three dollars and fifty cents'
+		uint32_t nCents = 0;
+		if (nFrac > 0)
+			nCents = (uint32_t)(pszText[nIdxFrac] - '0') * 10;
+		if (nFrac > 1)
+			nCents += (uint32_t)(pszText[nIdxFrac + 1] - '0');
+		if (0 != nWhole || 0 == nCents)
+		{
+			_normCardinal(pOut, nWhole);
+			_normPut(pOut, (1 == nWhole) ? pCur->pszOne : pCur->pszMany);
+		}
+		if (0 != nCents)
+		{
+			if (0 != nWhole)
+				_normPutWord(pOut, &g_normAnd);
+			_normCardinal(pOut, nCents);
+			_normPut(pOut, (1 == nCents) ? pCur->pszCent : pCur->pszCents);
+		}
+		return nPos;
+	}
+	if (nDigits > 1 && '0' == pszText[nIdx] && !bGrouped)
+	{
+		//'007' is 'zero zero seven'
+		for (size_t nIdxDigit = nIdx; nIdxDigit < nIdx + nDigits; ++nIdxDigit)
+			_normPutWord(pOut, &g_aNormOnes[pszText[nIdxDigit] - '0']);
+	}
+	else if (bYear)
+		_normYear(pOut, (uint32_t)nWhole);
+	else
+		_normCardinal(pOut, nWhole);
+	if (0 != nFrac)
+	{
+		_normPutWord(pOut, &g_normPoint);
+		for (size_t nIdxDigit = nIdxFrac; nIdxDigit < nIdxFrac + nFrac; ++nIdxDigit)
+			_normPutWord(pOut, &g_aNormOnes[pszText[nIdxDigit] - '0']);
+	}
+	if (NULL != pCur)
+		_normPut(pOut, pCur->pszMany);	//(no cents, or too many places for them)
+	if (bOrdinal)
+		_normOrdinal(pOut);
+	else if (bPlural)
+		_normPlural(pOut);
+	return nPos;
+}
+
+
+//the currency whose symbol is at nIdx, if any, and the length of that symbol
+static const TTSNormCurrency* _normCurrency(const char* pszText, size_t nIdx, size_t nLen,
+		size_t* pnSymbol, int* pbShort)
+{
+	for (size_t nIdxCur = 0; nIdxCur < NORM_COUNTOF(g_aNormCurrency); ++nIdxCur)
+	{
+		const char* pszSymbol = g_aNormCurrency[nIdxCur].pszSymbol;
+		size_t nMatch = 0;
+		while (0 != pszSymbol[nMatch] &&
+				pszSymbol[nMatch] == _normAt(pszText, nIdx + nMatch, nLen, pbShort))
+			++nMatch;
+		if (0 == pszSymbol[nMatch])
+		{
+			*pnSymbol = nMatch;
+			return &g_aNormCurrency[nIdxCur];
+		}
+	}
+	return NULL;
+}
+
+
+//the abbreviation starting at nIdx, if any.  returns its length, or 0 if the
+//text ends too soon to tell, or (size_t)-1 if there's none.
+static size_t _normAbbrev(const char* pszText, size_t nIdx, size_t nLen, int bEnd,
+		TTSNormOut* pOut)
+{
+	size_t nLo = 0;
+	size_t nHi = NORM_COUNTOF(g_aNormAbbrev);
+	while (nLo < nHi)
+	{
+		size_t nMid = (nLo + nHi) / 2;
+		const char* pszFrom = g_aNormAbbrev[nMid].pszFrom;
+		int bShort = 0;
+		size_t nMatch = 0;
+		char ch = 0;
+		while (0 != pszFrom[nMatch] &&
+				pszFrom[nMatch] == (ch = _normLower(_normAt(pszText, nIdx + nMatch, nLen, &bShort))))
+			++nMatch;
+		if (0 == pszFrom[nMatch])
+		{
+			_normPut(pOut, g_aNormAbbrev[nMid].pszTo);
+			return nMatch;
+		}
+		if (bShort && !bEnd)
+			return 0;	//(the text ran out before it differed)
+		if ((uint8_t)pszFrom[nMatch] < (uint8_t)ch)
+			nLo = nMid + 1;
+		else
+			nHi = nMid;
+	}
+	return (size_t)-1;
+}
+
+
+
+void ttsNormalizeInit(TTSNormalizer* pNorm)
+{
+	pNorm->_chPrev = 0;
+	pNorm->_chPrev2 = 0;
+	pNorm->_chOut = 0;
+	pNorm->_bWordOut = 0;
+	pNorm->_bSpelling = 0;
+}
+
+
+int ttsNormalize(TTSNormalizer* pNorm,
+		const char* pszText, int nTextLen, int bEnd,
+		char* pszOut, size_t nOutLen,
+		int* pnConsumed)
+{
+	if (nTextLen < 0)
+	{
+		nTextLen = (int)strlen(pszText);
+	}
+	size_t nLen = (size_t)nTextLen;
+	size_t nIdx = 0;
+	size_t nOut = 0;
+	int bWordOut = pNorm->_bWordOut;
+	int bSpelling = pNorm->_bSpelling;
+	//the text last copied as-is, which is also the end of the output; a word
+	//at its end can be taken back if it turns out to be an abbreviation
+	size_t nIdxPlain = 0;
+	size_t nIdxPlainEnd = 0;
+	TTSNormOut out;
+	for (;;)
+	{
+		//copy what needs nothing done
+		size_t nIdxRun = nIdx;
+		while (nIdx < nLen && NORM_COPY == g_abyNormClass[(uint8_t)pszText[nIdx]])
+			++nIdx;
+		int bStop = (nIdx == nLen && !bEnd);
+		size_t nSpace = (nIdx > nIdxRun && bWordOut && _isNormAlnum(pszText[nIdxRun])) ? 1 : 0;
+		if (nSpace + nIdx - nIdxRun > nOutLen - nOut)
+		{
+			nIdx = nIdxRun + ((nOutLen - nOut > nSpace) ? nOutLen - nOut - nSpace : 0);
+			bStop = 1;
+		}
+		if (bStop)
+		{
+			//stop before a short word, which might yet be followed by a '.'
+			size_t nIdxWord = nIdx;
+			while (nIdxWord > nIdxRun && nIdx - nIdxWord <= TTS_NORM_MAXABBREV &&
+					_isNormLetter(pszText[nIdxWord - 1]))
+				--nIdxWord;
+			if (nIdx - nIdxWord <= TTS_NORM_MAXABBREV)
+				nIdx = nIdxWord;
+		}
+		size_t nRun = nIdx - nIdxRun;
+		if (0 != nRun)
+		{
+			if (0 != nSpace)
+				pszOut[nOut++] = ' ';
+			memcpy(&pszOut[nOut], &pszText[nIdxRun], nRun);
+			nOut += nRun;
+			bWordOut = 0;
+			bSpelling = 0;
+		}
+		nIdxPlain = nIdxRun;
+		nIdxPlainEnd = nIdx;
+		if (bStop || nIdx == nLen)
+			break;
+
+		//something to look at
+		char ch = pszText[nIdx];
+		char chBefore = (nIdx > 0) ? pszText[nIdx - 1] : pNorm->_chPrev;
+		size_t nTake = 0;	//how much text the expansion is of; 0 if it can't be told yet
+		size_t nIdxFrom = nIdx;	//where that starts
+		int bShort = 0;
+		out._nLen = 0;
+		switch (g_abyNormClass[(uint8_t)ch])
+		{
+		case NORM_DIGIT:
+			if ((0 == nIdx && bSpelling) || _normDigitRun(pszText, nIdx, nLen) > TTS_NORM_MAXDIGITS)
+			{
+				//too long to be a number; say each digit (as many as there's room for)
+				while (nIdx < nLen && _isNormDigit(pszText[nIdx]))
+				{
+					const TTSNormWord* pDigit = &g_aNormOnes[pszText[nIdx] - '0'];
+					char chOut = (nOut > 0) ? pszOut[nOut - 1] : pNorm->_chOut;
+					size_t nSkip = _isNormAlnum(chOut) ? 0 : 1;	//(the space)
+					if (pDigit->nLen - nSkip > nOutLen - nOut)
+						break;
+					memcpy(&pszOut[nOut], &pDigit->ach[nSkip], pDigit->nLen - nSkip);
+					nOut += pDigit->nLen - nSkip;
+					++nIdx;
+					bWordOut = 1;
+					bSpelling = 1;
+				}
+				if (nIdx < nLen && _isNormDigit(pszText[nIdx]))
+					break;	//out of room
+				continue;
+			}
+			{
+				char chBefore2 = (nIdx > 1) ? pszText[nIdx - 2] :
+						(1 == nIdx) ? pNorm->_chPrev : pNorm->_chPrev2;
+				int bAfterGroup = ' ' == chBefore && _isNormDigit(chBefore2);
+				size_t nEnd = _normNumber(pszText, nIdx, nLen, bEnd, 0, NULL, bAfterGroup, &out);
+				nTake = (0 != nEnd) ? nEnd - nIdx : 0;
+			}
+			break;
+
+		case NORM_DOT:
+			nTake = 1;	//(just the '.', unless it ends an abbreviation)
+			if (nIdxPlainEnd == nIdx)
+			{
+				size_t nIdxWord = nIdx;
+				while (nIdxWord > nIdxPlain && nIdx - nIdxWord <= TTS_NORM_MAXABBREV &&
+						_isNormLetter(pszText[nIdxWord - 1]))
+					--nIdxWord;
+				char chWordBefore = (nIdxWord > 0) ? pszText[nIdxWord - 1] : pNorm->_chPrev;
+				if (nIdxWord < nIdx && nIdx - nIdxWord <= TTS_NORM_MAXABBREV &&
+						!_isNormAlnum(chWordBefore))
+				{
+					size_t nAbbrev = _normAbbrev(pszText, nIdxWord, nLen, bEnd, &out);
+					if ((size_t)-1 != nAbbrev)
+					{
+						//take the word back out; it's either this, or not known yet
+						nOut -= nIdx - nIdxWord;
+						nIdx = nIdxWord;
+						nIdxFrom = nIdxWord;
+						nTake = nAbbrev;
+					}
+				}
+			}
+			break;
+
+		case NORM_MINUS:
+			nTake = 1;
+			{
+				char chNext = _normAt(pszText, nIdx + 1, nLen, &bShort);
+				if (bShort && !bEnd)
+					nTake = 0;
+				else if (_isNormAlnum(chBefore))
+				{
+					//a hyphen; copied
+				}
+				else if (_isNormDigit(chNext))
+				{
+					if (!_normIsNumber(pszText, nIdx + 1, nLen, 0, &bShort))
+					{
+						//too many digits; just the '-' is copied
+					}
+					else if (bShort && !bEnd)
+						nTake = 0;
+					else
+					{
+						size_t nEnd = _normNumber(pszText, nIdx + 1, nLen, bEnd, 1, NULL, 0, &out);
+						nTake = (0 != nEnd) ? nEnd - nIdx : 0;
+					}
+				}
+				else if (NORM_CURRENCY == g_abyNormClass[(uint8_t)chNext])
+				{
+					//'-$5' is 'minus five dollars'
+					size_t nSymbol = 0;
+					const TTSNormCurrency* pCur = _normCurrency(pszText, nIdx + 1, nLen, &nSymbol, &bShort);
+					int bNumber = NULL != pCur && _normIsNumber(pszText, nIdx + 1 + nSymbol, nLen, 1, &bShort);
+					if (bShort && !bEnd)
+						nTake = 0;
+					else if (bNumber)
+					{
+						size_t nEnd = _normNumber(pszText, nIdx + 1 + nSymbol, nLen, bEnd, 1, pCur, 0, &out);
+						nTake = (0 != nEnd) ? nEnd - nIdx : 0;
+					}
+				}
+			}
+			break;
+
+		case NORM_SYMBOL:
+			nTake = 1;
+			for (size_t nIdxSym = 0; nIdxSym < NORM_COUNTOF(g_aNormSymbol); ++nIdxSym)
+			{
+				if (ch == g_aNormSymbol[nIdxSym].pszFrom[0])
+					_normPut(&out, g_aNormSymbol[nIdxSym].pszTo);
+			}
+			break;
+
+		case NORM_CURRENCY:
+			nTake = 1;
+			{
+				size_t nSymbol = 0;
+				const TTSNormCurrency* pCur = _normCurrency(pszText, nIdx, nLen, &nSymbol, &bShort);
+				if (NULL != pCur)
+				{
+					int bNumber = _normIsNumber(pszText, nIdx + nSymbol, nLen, 1, &bShort);
+					if (bShort && !bEnd)
+						nTake = 0;
+					else if (bNumber)
+					{
+						size_t nEnd = _normNumber(pszText, nIdx + nSymbol, nLen, bEnd, 0, pCur, 0, &out);
+						nTake = (0 != nEnd) ? nEnd - nIdx : 0;
+					}
+					else
+					{
+						_normPut(&out, pCur->pszMany);
+						nTake = nSymbol;
+					}
+				}
+				else if (bShort && !bEnd)
+					nTake = 0;
+			}
+			break;
+		}
+		if (0 == nTake)
+			break;	//need more text
+
+		if (0 == out._nLen)
+		{
+			//nothing to be done after all; it's copied
+			if (nOut == nOutLen)
+				break;
+			pszOut[nOut++] = ch;
+			bWordOut = 0;
+		}
+		else
+		{
+			char chOut = (nOut > 0) ? pszOut[nOut - 1] : pNorm->_chOut;
+			size_t nSkip = _isNormAlnum(chOut) ? 0 : 1;	//(the space)
+			if (out._nLen - nSkip > nOutLen - nOut)
+				break;	//out of room
+			memcpy(&pszOut[nOut], &out._ach[nSkip], out._nLen - nSkip);
+			nOut += out._nLen - nSkip;
+			bWordOut = 1;
+		}
+		bSpelling = 0;
+		nIdx = nIdxFrom + nTake;
+	}
+
+	if (nIdx > 1)
+		pNorm->_chPrev2 = pszText[nIdx - 2];
+	else if (1 == nIdx)
+		pNorm->_chPrev2 = pNorm->_chPrev;
+	if (nIdx > 0)
+		pNorm->_chPrev = pszText[nIdx - 1];
+	if (nOut > 0)
+		pNorm->_chOut = pszOut[nOut - 1];
+	pNorm->_bWordOut = (uint8_t)bWordOut;
+	pNorm->_bSpelling = (uint8_t)bSpelling;
+	if (NULL != pnConsumed)
+		*pnConsumed = (int)nIdx;
+	return (int)nOut;
+}
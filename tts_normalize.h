@@ -0,0 +1,67 @@
+
+
+
+#ifndef __TTS_NORMALIZE_H
+#define __TTS_NORMALIZE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+//an optional stage in front of the tokenizer (ttsText/pluckWord).  That only
+//knows letters and a little punctuation; digits and symbols are class 0 to it
+//(see _classifyChar) and are simply dropped, so "call 555 1234" is "call".
+//Here numbers (cardinals, ordinals, years, decimals), amounts of money, a few
+//symbols, and a table of abbreviations are spelled out as lower-case words,
+//and everything else is copied through as it is.  e.g.
+//	Dr. Smith paid $3.50 on May 21st, 1984 (10% off)
+//becomes
+//	doctor Smith paid three dollars and fifty cents on May twenty first, nineteen eighty four (ten percent off)
+//It streams, from a buffer of text into a buffer of text, as ttsText does:  it
+//stops before anything that runs up to the end of the text, unless told that
+//it is the end, and that must be given again with more after it.  It doesn't
+//allocate; an expansion is made in a small buffer on the stack, from tables.
+
+
+//the most text one expansion is taken from.  Given at least this much, there
+//is always some progress.
+#define TTS_NORM_MAXTOKEN	64
+
+//the most text one expansion makes.  Given room for at least this much, there
+//is always some progress.
+#define TTS_NORM_MAXOUT	384
+
+
+typedef struct TTSNormalizer
+{
+	char	_chPrev;	//the last character taken
+	char	_chPrev2;	//and the one before
+	char	_chOut;	//the last character made
+	uint8_t	_bWordOut;	//what was made last was a spelled-out word
+	uint8_t	_bSpelling;	//in a run of digits that is being read one by one
+} TTSNormalizer;
+
+
+//set up for a new stream
+void ttsNormalizeInit(TTSNormalizer* pNorm);
+
+
+//normalize some text (nTextLen < 0 means nul-terminated) into pszOut, which
+//has room for nOutLen.  bEnd says there is no more text after this.  returns
+//how many characters were placed in pszOut, and sets *pnConsumed to how many
+//of the text were used; the rest should be given again, with more after it.
+int ttsNormalize(TTSNormalizer* pNorm,
+		const char* pszText, int nTextLen, int bEnd,
+		char* pszOut, size_t nOutLen,
+		int* pnConsumed);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,146 @@
+#include "tts_parallel.h"
+#include "text_to_speech.h"
+
+#include <string>
+#include <thread>
+#include <atomic>
+
+
+//a piece of the document, and what it turned into
+struct TTSChunk
+{
+	size_t	nStart;
+	size_t	nLen;
+	size_t	nConsumed;
+	VEC_BYTE	abyPhon;
+};
+typedef std::vector<TTSChunk>	VEC_CHUNK;
+
+
+
+//split the text into chunks of about nChunkLen.  Each chunk is extended to
+//just past a word-bounding character (_classifyChar() of 0), so that every
+//word is wholly in one chunk, and is complete there if it was complete in the
+//whole text.
+void splitChunks(const char* pszText, size_t nTextLen, size_t nChunkLen,
+		VEC_CHUNK& chunks)
+{
+	size_t nIdxStart = 0;
+	while (nIdxStart < nTextLen)
+	{
+		size_t nIdxEnd = nIdxStart + nChunkLen;
+		if (nIdxEnd >= nTextLen)
+		{
+			nIdxEnd = nTextLen;
+		}
+		else
+		{
+			while (nIdxEnd < nTextLen && 0 != _classifyChar(pszText[nIdxEnd]))
+				nIdxEnd += 1;
+			if (nIdxEnd < nTextLen)
+				nIdxEnd += 1;	//take the bounding character too
+		}
+		TTSChunk chunk;
+		chunk.nStart = nIdxStart;
+		chunk.nLen = nIdxEnd - nIdxStart;
+		chunk.nConsumed = 0;
+		chunks.push_back(chunk);
+		nIdxStart = nIdxEnd;
+	}
+}
+
+
+
+//convert one chunk, growing its phoneme buffer as needed
+void convertChunk(char* pszText, TTSChunk& chunk, const uint8_t* pbyTTSRulesBlob)
+{
+	//most words make fewer phonemes than they have letters; start there
+	chunk.abyPhon.resize(chunk.nLen + 16);
+	size_t nProduced = 0;
+	char* pszNow = &pszText[chunk.nStart];
+	int nRemain = (int)chunk.nLen;
+	for (;;)
+	{
+		int nConsumed = 0;
+		int nRet = ttsText(pszNow, nRemain, pbyTTSRulesBlob,
+				&chunk.abyPhon[nProduced], chunk.abyPhon.size() - nProduced,
+				&nConsumed);
+		if (nRet < 0)
+		{
+			//not even one word fit; make room for at least that much more
+			chunk.abyPhon.resize(chunk.abyPhon.size() * 2 - nRet);
+			continue;
+		}
+		nProduced += nRet;
+		pszNow += nConsumed;
+		nRemain -= nConsumed;
+		chunk.nConsumed += nConsumed;
+		if (0 == nRemain || (0 == nRet && 0 == nConsumed))
+			break;	//all done, or just a partial word left
+		//otherwise we ran out of space part way; going round again will
+		//either grow the buffer or find that only a partial word is left
+	}
+	chunk.abyPhon.resize(nProduced);
+}
+
+
+
+size_t ttsDocument(const char* pszText, size_t nTextLen,
+		const uint8_t* pbyTTSRulesBlob,
+		VEC_BYTE& abyPhon,
+		unsigned int nThreads,
+		size_t nChunkLen)
+{
+	abyPhon.clear();
+	if (0 == nTextLen)
+		return 0;
+	if (0 == nChunkLen)
+		nChunkLen = 1;
+	if (0 == nThreads)
+		nThreads = std::thread::hardware_concurrency();
+	if (0 == nThreads)
+		nThreads = 1;
+
+	//ttsText lower-cases in place, so work on our own copy.  the chunks are
+	//disjoint, so the threads don't step on each other.  (the copy starts
+	//with a space, because the rules look a character to the left of a word,
+	//and the first word may be at the very start.)
+	std::string strText(" ");
+	strText.append(pszText, nTextLen);
+	VEC_CHUNK chunks;
+	splitChunks(&strText[1], nTextLen, nChunkLen, chunks);
+	if (nThreads > chunks.size())
+		nThreads = (unsigned int)chunks.size();
+
+	//each thread takes the next chunk nobody has claimed, so the fast ones
+	//take up the slack of the slow ones.
+	std::atomic<size_t> nNextChunk(0);
+	auto worker = [&]()
+	{
+		size_t nIdxChunk;
+		while ((nIdxChunk = nNextChunk.fetch_add(1)) < chunks.size())
+		{
+			convertChunk(&strText[1], chunks[nIdxChunk], pbyTTSRulesBlob);
+		}
+	};
+	std::vector<std::thread> threads;
+	for (unsigned int nIdxThread = 1; nIdxThread < nThreads; ++nIdxThread)
+		threads.push_back(std::thread(worker));
+	worker();	//we can help too
+	for (std::thread& thread : threads)
+		thread.join();
+
+	//stitch it back together in order
+	size_t nTotal = 0;
+	for (const TTSChunk& chunk : chunks)
+		nTotal += chunk.abyPhon.size();
+	abyPhon.reserve(nTotal);
+	size_t nConsumed = 0;
+	for (const TTSChunk& chunk : chunks)
+	{
+		abyPhon.insert(abyPhon.end(), chunk.abyPhon.begin(), chunk.abyPhon.end());
+		nConsumed = chunk.nStart + chunk.nConsumed;
+	}
+
+	return nConsumed;
+}
@@ -0,0 +1,26 @@
+#ifndef __TTS_PARALLEL_H
+#define __TTS_PARALLEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+typedef std::vector<uint8_t>	VEC_BYTE;
+
+//convert a whole document to speech using several threads.  The text is split
+//into chunks at word-bounding characters, the chunks are converted with
+//ttsText by a pool of threads (all sharing the one read-only rules blob), and
+//the phonemes are put back together in order.  The result is exactly what the
+//sequential pluckWord/ttsWord loop would produce -- including that a word at
+//the very end of the text, with nothing bounding it, is not converted.
+//The text is not modified (a private copy is lower-cased).
+//nThreads of 0 means use as many as the hardware has.
+//returns how much of the text was consumed (see pluckWord).
+size_t ttsDocument(const char* pszText, size_t nTextLen,
+		const uint8_t* pbyTTSRulesBlob,
+		VEC_BYTE& abyPhon,
+		unsigned int nThreads = 0,
+		size_t nChunkLen = 64 * 1024);
+
+
+#endif
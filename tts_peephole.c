@@ -0,0 +1,77 @@
+#include "tts_peephole.h"
+#include "sp0256.h"
+
+
+
+void ttsPeepholeInit(TTSPeephole* pPeep, uint32_t nMaxPauseMs)
+{
+	pPeep->_nHeldMs = 0;
+	pPeep->_nRunMs = 0;
+	pPeep->_nMaxPauseMs = nMaxPauseMs;
+}
+
+
+//send the silence held back, longest pauses first.  (For the SP0256's pauses,
+//taking the longest that fits each time also takes the fewest.)  Anything
+//shorter than PA1 is dropped; that can only be from the limit.
+static int _sendHeld(TTSPeephole* pPeep, uint8_t* pbyOut)
+{
+	int nOut = 0;
+	for (int nPause = SP0256_PA5; nPause >= SP0256_PA1; --nPause)
+	{
+		while (pPeep->_nHeldMs >= g_anSP0256DurMs[nPause])
+		{
+			pbyOut[nOut++] = (uint8_t)nPause;
+			pPeep->_nHeldMs -= g_anSP0256DurMs[nPause];
+			pPeep->_nRunMs += g_anSP0256DurMs[nPause];
+		}
+	}
+	pPeep->_nHeldMs = 0;
+	return nOut;
+}
+
+
+int ttsPeephole(TTSPeephole* pPeep,
+		const uint8_t* pbyIn, size_t nIn,
+		uint8_t* pbyOut)
+{
+	int nOut = 0;
+	for (size_t nIdx = 0; nIdx < nIn; ++nIdx)
+	{
+		uint8_t byPhon = pbyIn[nIdx];
+		if ( ! SP0256_ISPAUSE(byPhon) )
+		{
+			//the run is over
+			nOut += _sendHeld(pPeep, &pbyOut[nOut]);
+			pPeep->_nRunMs = 0;
+			pbyOut[nOut++] = byPhon;
+			continue;
+		}
+		uint32_t nAddMs = g_anSP0256DurMs[byPhon];
+		if (0 != pPeep->_nMaxPauseMs)
+		{
+			uint32_t nRunMs = pPeep->_nRunMs + pPeep->_nHeldMs;
+			if (nRunMs >= pPeep->_nMaxPauseMs)
+				nAddMs = 0;
+			else if (nAddMs > pPeep->_nMaxPauseMs - nRunMs)
+				nAddMs = pPeep->_nMaxPauseMs - nRunMs;
+		}
+		pPeep->_nHeldMs += nAddMs;
+		//the longest pause can go now; there's no doing better than it
+		while (pPeep->_nHeldMs >= g_anSP0256DurMs[SP0256_PA5])
+		{
+			pbyOut[nOut++] = SP0256_PA5;
+			pPeep->_nHeldMs -= g_anSP0256DurMs[SP0256_PA5];
+			pPeep->_nRunMs += g_anSP0256DurMs[SP0256_PA5];
+		}
+	}
+	return nOut;
+}
+
+
+int ttsPeepholeFlush(TTSPeephole* pPeep, uint8_t* pbyOut)
+{
+	int nOut = _sendHeld(pPeep, pbyOut);
+	pPeep->_nRunMs = 0;
+	return nOut;
+}
@@ -0,0 +1,62 @@
+
+
+#ifndef __TTS_PEEPHOLE_H
+#define __TTS_PEEPHOLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+//an optional pass over the phonemes coming out of ttsWord/ttsText, before they
+//go to the chip.  The rules make a lot of pauses, and they pile up where words
+//join:  a '.' is PA5 PA5 PA4, and '?!' or '. -' make longer chains still.
+//Every one of those is a byte on the link.  Here each run of pauses is
+//replaced by the fewest pauses that make the same silence (by the durations in
+//g_anSP0256DurMs), longest first.  Optionally a run can also be cut short, so
+//that e.g. '...' or '!!!' is no more silence than is useful.
+//It is streaming, and holds back very little:  a PA5 goes out as soon as the
+//run has 200ms of silence, so what is held is always less than that, which is
+//at most TTS_PEEPHOLE_MAXHELD pauses.  Nothing else is delayed at all.
+//The rest of the phonemes are untouched; the rules repeat allophones on
+//purpose (e.g. AE AE for a long vowel), so a repeat can't be taken for waste.
+
+
+//the most pauses that the silence held back can come out as (100+50+30+10ms)
+#define TTS_PEEPHOLE_MAXHELD	4
+
+
+typedef struct TTSPeephole
+{
+	uint32_t	_nHeldMs;	//silence in this run not yet sent
+	uint32_t	_nRunMs;	//silence in this run already sent
+	uint32_t	_nMaxPauseMs;	//longest run to send, or 0 for no limit
+} TTSPeephole;
+
+
+//set up for a new stream.  nMaxPauseMs is the most silence that a run of
+//pauses will be turned into (rounded down to what the pauses can make), or 0
+//to keep it all.
+void ttsPeepholeInit(TTSPeephole* pPeep, uint32_t nMaxPauseMs);
+
+
+//pass some phonemes through.  The output must have room for
+//nIn + TTS_PEEPHOLE_MAXHELD.  returns the number of phonemes placed there.
+int ttsPeephole(TTSPeephole* pPeep,
+		const uint8_t* pbyIn, size_t nIn,
+		uint8_t* pbyOut);
+
+
+//at the end of the stream, send whatever silence is held back.  The output
+//must have room for TTS_PEEPHOLE_MAXHELD.  returns the number placed there.
+int ttsPeepholeFlush(TTSPeephole* pPeep, uint8_t* pbyOut);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
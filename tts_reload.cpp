@@ -0,0 +1,111 @@
+#include "tts_reload.h"
+#include "tts_blob.h"
+
+#include <thread>
+
+
+
+TTSRuleset* ttsRulesetOpen(const char* pszFile, int* pnErr)
+{
+	TTSBlobFile blobfile;
+	*pnErr = ttsBlobOpen(&blobfile, pszFile);
+	if (TTS_BLOB_OK != *pnErr)
+		return NULL;
+	TTSRuleset* pRuleset = new TTSRuleset;
+	pRuleset->_pbyTTSRulesBlob = blobfile._pbyTTSRulesBlob;
+	pRuleset->_nLen = blobfile._nLen;
+	pRuleset->_bMapped = true;
+	pRuleset->_nRefs = 1;
+	return pRuleset;
+}
+
+
+TTSRuleset* ttsRulesetFromBlob(const VEC_BYTE& abyBlob, int* pnErr)
+{
+	TTSRuleset* pRuleset = new TTSRuleset;
+	pRuleset->_abyBlob = abyBlob;	//(vector storage is suitably aligned)
+	pRuleset->_pbyTTSRulesBlob = pRuleset->_abyBlob.data();
+	pRuleset->_nLen = pRuleset->_abyBlob.size();
+	pRuleset->_bMapped = false;
+	pRuleset->_nRefs = 1;
+	*pnErr = ttsBlobValidate(pRuleset->_pbyTTSRulesBlob, pRuleset->_nLen);
+	if (TTS_BLOB_OK != *pnErr)
+	{
+		delete pRuleset;
+		return NULL;
+	}
+	return pRuleset;
+}
+
+
+void ttsRulesetRelease(TTSRuleset* pRuleset)
+{
+	//(acq_rel, so that the last one sees everything the others did with it)
+	if (1 != pRuleset->_nRefs.fetch_sub(1, std::memory_order_acq_rel))
+		return;
+	if (pRuleset->_bMapped)
+	{
+		TTSBlobFile blobfile = { pRuleset->_pbyTTSRulesBlob, pRuleset->_nLen };
+		ttsBlobClose(&blobfile);
+	}
+	delete pRuleset;
+}
+
+
+
+void ttsRulesetSlotInit(TTSRulesetSlot& slot, TTSRuleset* pRuleset)
+{
+	slot._pCurrent = pRuleset;
+	slot._nEpoch = 0;
+	slot._anAcquiring[0] = 0;
+	slot._anAcquiring[1] = 0;
+}
+
+
+void ttsRulesetSlotFini(TTSRulesetSlot& slot)
+{
+	TTSRuleset* pRuleset = slot._pCurrent.exchange(NULL);
+	if (NULL != pRuleset)
+		ttsRulesetRelease(pRuleset);
+}
+
+
+//The danger in acquiring is that between reading _pCurrent and adding our
+//reference, a swap could release the slot's reference and free the ruleset.
+//So we are counted as acquiring for that time, and a swap waits until no one
+//that might have read the old pointer still is.  The counting is in halves by
+//epoch so that a steady stream of new acquires (which can only see the new
+//pointer) can't keep a swap waiting forever.  (All seq_cst, which this
+//depends on:  our count must be visible before our read of _pCurrent, and
+//the swap's exchange before its read of our count.)
+TTSRuleset* ttsRulesetAcquire(TTSRulesetSlot& slot)
+{
+	unsigned int nEpoch;
+	for (;;)
+	{
+		nEpoch = slot._nEpoch.load();
+		slot._anAcquiring[nEpoch & 1].fetch_add(1);
+		if (nEpoch == slot._nEpoch.load())
+			break;
+		//a swap flipped it under us; it might already be waiting on the
+		//other half, so count ourselves there instead
+		slot._anAcquiring[nEpoch & 1].fetch_sub(1);
+	}
+	TTSRuleset* pRuleset = slot._pCurrent.load();
+	pRuleset->_nRefs.fetch_add(1, std::memory_order_relaxed);
+	slot._anAcquiring[nEpoch & 1].fetch_sub(1);
+	return pRuleset;
+}
+
+
+void ttsRulesetSwap(TTSRulesetSlot& slot, TTSRuleset* pRuleset)
+{
+	std::lock_guard<std::mutex> lock(slot._mtxSwap);
+	TTSRuleset* pOld = slot._pCurrent.exchange(pRuleset);
+	//anyone who could have read pOld counted themselves in this epoch's
+	//half before it changed; new acquires go in the other half.
+	unsigned int nEpoch = slot._nEpoch.fetch_add(1);
+	while (0 != slot._anAcquiring[nEpoch & 1].load())
+		std::this_thread::yield();
+	ttsRulesetRelease(pOld);
+}
@@ -0,0 +1,92 @@
+#ifndef __TTS_RELOAD_H
+#define __TTS_RELOAD_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+typedef std::vector<uint8_t>	VEC_BYTE;
+
+//Replacing the rules of a long-running service without stopping it (host only;
+//C++ and threads).  The engine just takes a blob pointer, so something has to
+//say when a blob is no longer in use.  A TTSRuleset is a blob with a count of
+//references; a TTSRulesetSlot is the one that is current, which can be swapped
+//for another at any time:
+//	TTSRuleset* pRules = ttsRulesetAcquire(slot);
+//	ttsWord(pszWord, nLen, ttsRulesetBlob(pRules), abyPhon, sizeof(abyPhon));
+//	...
+//	ttsRulesetRelease(pRules);
+//Work that acquired the old ruleset carries on with it, work that acquires
+//after a swap gets the new one, and the old one is freed (or unmapped) when
+//the last of its users releases it.  Acquiring and releasing never wait for
+//anything:  they are a few atomic operations, and only a swap has to wait,
+//for any acquires that were in progress as it happened to finish (which is
+//the 'grace period' of RCU, but only ever a few instructions long).
+//Things keyed on the blob pointer (e.g. a TTSWordCache) must be reset when
+//the ruleset they were made for is swapped out.
+
+
+//a rules blob, and how many are using it
+struct TTSRuleset
+{
+	const uint8_t*	_pbyTTSRulesBlob;
+	size_t	_nLen;
+	bool	_bMapped;	//from ttsBlobOpen, else _abyBlob is it
+	VEC_BYTE	_abyBlob;
+	std::atomic<unsigned int>	_nRefs;
+};
+
+
+//the current ruleset.  An acquire counts itself in the half of _anAcquiring
+//of the current _nEpoch while it gets its reference; a swap flips the epoch
+//and waits for the other half to drain.
+struct TTSRulesetSlot
+{
+	std::atomic<TTSRuleset*>	_pCurrent;
+	std::atomic<unsigned int>	_nEpoch;
+	std::atomic<unsigned int>	_anAcquiring[2];
+	std::mutex	_mtxSwap;	//(only swaps take this)
+};
+
+
+//make a ruleset from a blob file (see ttsBlobOpen), with one reference.
+//returns NULL if it can't, with *pnErr set to the TTS_BLOB_Exxx code.
+TTSRuleset* ttsRulesetOpen(const char* pszFile, int* pnErr);
+
+//make a ruleset from a copy of a blob in memory (e.g. from
+//make_compact_ruleset), with one reference.  It is validated just the same.
+TTSRuleset* ttsRulesetFromBlob(const VEC_BYTE& abyBlob, int* pnErr);
+
+
+//the blob, for ttsWord et al.
+inline const uint8_t* ttsRulesetBlob(const TTSRuleset* pRuleset)
+{
+	return pRuleset->_pbyTTSRulesBlob;
+}
+
+
+//let go of a reference; the last one frees the ruleset
+void ttsRulesetRelease(TTSRuleset* pRuleset);
+
+
+//set up a slot with its first ruleset, whose reference it takes over
+void ttsRulesetSlotInit(TTSRulesetSlot& slot, TTSRuleset* pRuleset);
+
+//release the slot's ruleset.  Nothing may be using the slot any more (though
+//rulesets acquired from it may still be in use).
+void ttsRulesetSlotFini(TTSRulesetSlot& slot);
+
+
+//get a reference to the current ruleset; this must be released
+TTSRuleset* ttsRulesetAcquire(TTSRulesetSlot& slot);
+
+
+//make pRuleset current (taking over its reference), and release the slot's
+//reference to the old one.  Swaps may be made from any thread, concurrently
+//with acquires.
+void ttsRulesetSwap(TTSRulesetSlot& slot, TTSRuleset* pRuleset);
+
+
+#endif
@@ -0,0 +1,362 @@
+#include "tts_render.h"
+#include "sp0256.h"
+
+#include <math.h>
+
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+		(defined(__i386__) && defined(__SSE2__)) || \
+		(defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TTS_RENDER_SSE
+#include <xmmintrin.h>
+#endif
+
+
+
+//where the filter heads for, at some point in an allophone
+typedef struct TTSRenderTarget
+{
+	uint16_t	nF1;	//formants (Hz)
+	uint16_t	nF2;
+	uint16_t	nF3;
+	uint16_t	nFF;	//centre of the frication (Hz)
+	uint8_t	nAV;	//amplitude of voicing
+	uint8_t	nAH;	//amplitude of aspiration (noise through the formants)
+	uint8_t	nAF;	//amplitude of frication (noise through its own resonator)
+} TTSRenderTarget;
+
+
+//an allophone:  it holds at its start for the first nHold percent, then
+//glides (the formants) or steps (the amplitudes) to its end.  For a stop, the
+//start is the closure, and the end is the burst.
+typedef struct TTSRenderPhon
+{
+	TTSRenderTarget	tStart;
+	TTSRenderTarget	tEnd;
+	uint8_t	nHold;
+} TTSRenderPhon;
+
+
+#define TARGET(f1, f2, f3, ff, av, ah, af)	{ f1, f2, f3, ff, av, ah, af }
+#define VOWEL(f1, f2, f3, av)	TARGET(f1, f2, f3, 4000, av, 0, 0)
+#define STEADY(f1, f2, f3, ff, av, ah, af)	{ TARGET(f1, f2, f3, ff, av, ah, af), TARGET(f1, f2, f3, ff, av, ah, af), 100 }
+#define STEADYV(f1, f2, f3, av)	{ VOWEL(f1, f2, f3, av), VOWEL(f1, f2, f3, av), 100 }
+#define GLIDE(f1, f2, f3, g1, g2, g3, av, hold)	{ VOWEL(f1, f2, f3, av), VOWEL(g1, g2, g3, av), hold }
+//a stop:  silence (or a voice bar, vb) while closed, then the burst
+#define STOP(f2, ff, vb, ah, af, hold)	{ TARGET(300, f2, 2500, ff, vb, 0, 0), TARGET(400, f2, 2500, ff, vb * 2, ah, af), hold }
+
+//(formants from the usual tables of American English; the amplitudes are by ear)
+static const TTSRenderPhon g_aRenderPhon[SP0256_ALLOPHONES] = {
+	STEADYV(500, 1500, 2500, 0),	//PA1
+	STEADYV(500, 1500, 2500, 0),	//PA2
+	STEADYV(500, 1500, 2500, 0),	//PA3
+	STEADYV(500, 1500, 2500, 0),	//PA4
+	STEADYV(500, 1500, 2500, 0),	//PA5
+	GLIDE(570, 840, 2410, 300, 2200, 2900, 60, 40),	//OY
+	GLIDE(730, 1090, 2440, 350, 2100, 2800, 60, 40),	//AY
+	STEADYV(530, 1840, 2480, 60),	//EH
+	STOP(1600, 2000, 0, 20, 45, 60),	//KK3
+	STOP(1000, 1200, 0, 15, 35, 70),	//PP
+	{ TARGET(300, 1800, 2500, 2600, 15, 0, 0), TARGET(300, 1800, 2500, 2600, 35, 0, 40), 40 },	//JH
+	STEADYV(270, 1500, 2600, 40),	//NN1
+	STEADYV(390, 1990, 2550, 58),	//IH
+	STOP(1700, 4200, 0, 20, 45, 70),	//TT2
+	STEADYV(400, 1150, 1600, 50),	//RR1
+	STEADYV(500, 1450, 2450, 55),	//AX
+	STEADYV(270, 1000, 2200, 40),	//MM
+	STOP(1700, 4200, 0, 15, 40, 50),	//TT1
+	STEADY(350, 1600, 2600, 4200, 35, 0, 20),	//DH1
+	STEADYV(270, 2290, 3010, 55),	//IY
+	GLIDE(480, 1900, 2500, 320, 2200, 2900, 58, 45),	//EY
+	STOP(1700, 4000, 15, 0, 35, 60),	//DD1
+	STEADYV(320, 1000, 2240, 55),	//UW1
+	STEADYV(570, 840, 2410, 60),	//AO
+	STEADYV(730, 1090, 2440, 62),	//AA
+	STEADYV(260, 2100, 3000, 45),	//YY2
+	STEADYV(660, 1720, 2410, 62),	//AE
+	STEADY(500, 1500, 2500, 4000, 0, 40, 0),	//HH1
+	STOP(900, 1200, 15, 0, 25, 60),	//BB1
+	STEADY(400, 1600, 2600, 4200, 0, 0, 25),	//TH
+	STEADYV(440, 1020, 2240, 58),	//UH
+	STEADYV(300, 870, 2240, 55),	//UW2
+	GLIDE(730, 1090, 2440, 350, 800, 2300, 60, 40),	//AW
+	STOP(1700, 4000, 15, 0, 35, 60),	//DD2
+	STOP(1600, 2000, 15, 0, 35, 60),	//GG3
+	STEADY(300, 1100, 2300, 4000, 40, 0, 20),	//VV
+	STOP(2000, 2600, 15, 0, 35, 60),	//GG1
+	STEADY(400, 1800, 2500, 2600, 0, 0, 55),	//SH
+	STEADY(300, 1800, 2500, 2600, 35, 0, 40),	//ZH
+	STEADYV(400, 1200, 1600, 50),	//RR2
+	STEADY(400, 1100, 2300, 4200, 0, 0, 25),	//FF
+	STOP(1400, 1800, 0, 20, 45, 60),	//KK2
+	STOP(2200, 2600, 0, 20, 45, 60),	//KK1
+	STEADY(300, 1600, 2600, 4500, 35, 0, 40),	//ZZ
+	STEADYV(270, 2300, 2750, 40),	//NG
+	STEADYV(360, 1000, 2700, 48),	//LL
+	STEADYV(300, 650, 2200, 45),	//WW
+	GLIDE(530, 1840, 2480, 490, 1350, 1690, 58, 40),	//XR
+	STEADY(300, 650, 2200, 4000, 20, 30, 0),	//WH
+	STEADYV(260, 2100, 3000, 45),	//YY1
+	{ TARGET(400, 1800, 2500, 2600, 0, 0, 0), TARGET(400, 1800, 2500, 2600, 0, 0, 55), 40 },	//CH
+	STEADYV(490, 1350, 1690, 55),	//ER1
+	STEADYV(490, 1350, 1690, 55),	//ER2
+	GLIDE(500, 900, 2400, 350, 750, 2300, 60, 45),	//OW
+	STEADY(350, 1600, 2600, 4200, 35, 0, 20),	//DH2
+	STEADY(400, 1700, 2600, 4600, 0, 0, 55),	//SS
+	STEADYV(270, 1500, 2600, 40),	//NN2
+	STEADY(500, 1500, 2500, 4000, 0, 40, 0),	//HH2
+	GLIDE(570, 840, 2410, 490, 1350, 1690, 58, 40),	//OR
+	GLIDE(730, 1090, 2440, 490, 1350, 1690, 60, 45),	//AR
+	GLIDE(300, 2200, 2900, 490, 1350, 1690, 55, 35),	//YR
+	STOP(1600, 2000, 15, 0, 35, 60),	//GG2
+	GLIDE(450, 1000, 2500, 360, 850, 2700, 52, 40),	//EL
+	STOP(900, 1200, 15, 0, 25, 50),	//BB2
+};
+
+
+//fixed bandwidths (Hz), and the gain (and sign, so that neighbours don't
+//cancel where they overlap) of each resonator.  The pulse is flat, and the
+//radiation rises 6dB an octave, so the higher formants are turned down to
+//give about the fall of a real voice.
+static const float g_afRenderBw[TTS_RENDER_RES] = { 90.0f, 110.0f, 170.0f, 1000.0f };
+static const float g_afRenderGain[TTS_RENDER_RES] = { 1.0f, -0.35f, 0.1f, 1.0f };
+
+//from the table's amplitudes to the source's
+#define RENDER_VOICE_GAIN	(480000.0f / 64.0f)
+#define RENDER_ASPIRATE_GAIN	(36000.0f / 64.0f)
+#define RENDER_FRICATE_GAIN	(4800.0f / 64.0f)
+
+//added to every resonator's input.  As a sound dies away the resonators would
+//otherwise decay into denormals, which are very slow; this keeps them above.
+#define RENDER_TINY	1e-20f
+
+//how far the formants and amplitudes move toward their targets each frame
+#define RENDER_GLIDE	0.5f
+#define RENDER_PI	3.14159265f
+
+
+
+void ttsRenderInit(TTSRender* pRender, unsigned int nPitchHz)
+{
+	for (int nRes = 0; nRes < TTS_RENDER_RES; ++nRes)
+	{
+		pRender->_afY1[nRes] = 0.0f;
+		pRender->_afY2[nRes] = 0.0f;
+		pRender->_afB[nRes] = 0.0f;
+		pRender->_afC[nRes] = 0.0f;
+		pRender->_afInV[nRes] = 0.0f;
+		pRender->_afInN[nRes] = 0.0f;
+	}
+	pRender->_afFreq[0] = 500.0f;
+	pRender->_afFreq[1] = 1500.0f;
+	pRender->_afFreq[2] = 2500.0f;
+	pRender->_afFreq[3] = 4000.0f;
+	pRender->_fAV = 0.0f;
+	pRender->_fAH = 0.0f;
+	pRender->_fAF = 0.0f;
+	pRender->_fPrev = 0.0f;
+	pRender->_nNoise = 0x2545f491;
+	if (0 == nPitchHz)
+		nPitchHz = 100;
+	pRender->_nPeriod = TTS_RENDER_RATE / nPitchHz;
+	if (pRender->_nPeriod < 2)
+		pRender->_nPeriod = 2;
+	pRender->_nPhase = 0;
+	pRender->_nDone = 0;
+}
+
+
+size_t ttsRenderLength(const uint8_t* pbyPhon, size_t nPhon)
+{
+	size_t nLen = 0;
+	for (size_t nIdx = 0; nIdx < nPhon; ++nIdx)
+	{
+		if (pbyPhon[nIdx] < SP0256_ALLOPHONES)
+			nLen += (size_t)g_anSP0256DurMs[pbyPhon[nIdx]] * (TTS_RENDER_RATE / 1000);
+	}
+	return nLen;
+}
+
+
+//move a setting part of the way toward its target.  (Once it's close, it is
+//put there; an amplitude left dwindling toward 0 would become denormal.)
+static __inline float _toward(float fFrom, float fTo)
+{
+	float f = fFrom + RENDER_GLIDE * (fTo - fFrom);
+	return (fabsf(fTo - f) < 0.01f) ? fTo : f;
+}
+
+
+//set up the filter for the frame starting nDone samples into an allophone of
+//nLen samples
+static void _setFrame(TTSRender* pRender, const TTSRenderPhon* pPhon,
+		uint32_t nDone, uint32_t nLen)
+{
+	//where we are headed
+	uint32_t nHold = nLen * pPhon->nHold / 100;
+	const TTSRenderTarget* pAmp = &pPhon->tStart;
+	float fAt = 0.0f;	//how far along, from start to end
+	if (nDone >= nHold)
+	{
+		pAmp = &pPhon->tEnd;
+		fAt = (float)(nDone - nHold + TTS_RENDER_FRAME) / (float)(nLen - nHold);
+	}
+	float afTo[TTS_RENDER_RES] = {
+		pPhon->tStart.nF1 + fAt * ((float)pPhon->tEnd.nF1 - pPhon->tStart.nF1),
+		pPhon->tStart.nF2 + fAt * ((float)pPhon->tEnd.nF2 - pPhon->tStart.nF2),
+		pPhon->tStart.nF3 + fAt * ((float)pPhon->tEnd.nF3 - pPhon->tStart.nF3),
+		pPhon->tStart.nFF + fAt * ((float)pPhon->tEnd.nFF - pPhon->tStart.nFF),
+	};
+
+	//move toward it
+	pRender->_fAV = _toward(pRender->_fAV, pAmp->nAV);
+	pRender->_fAH = _toward(pRender->_fAH, pAmp->nAH);
+	pRender->_fAF = _toward(pRender->_fAF, pAmp->nAF);
+	for (int nRes = 0; nRes < TTS_RENDER_RES; ++nRes)
+	{
+		pRender->_afFreq[nRes] = _toward(pRender->_afFreq[nRes], afTo[nRes]);
+
+		//a two-pole resonator, y = a*x + b*y1 + c*y2, with a set for a gain
+		//of about 1 at its peak
+		float fR = expf(-RENDER_PI * g_afRenderBw[nRes] / TTS_RENDER_RATE);
+		float fTheta = 2.0f * RENDER_PI * pRender->_afFreq[nRes] / TTS_RENDER_RATE;
+		float fA = (1.0f - fR) * sqrtf(1.0f - 2.0f * fR * cosf(2.0f * fTheta) + fR * fR);
+		pRender->_afB[nRes] = 2.0f * fR * cosf(fTheta);
+		pRender->_afC[nRes] = -fR * fR;
+
+		//the formants get voicing and aspiration; the last, frication
+		fA *= g_afRenderGain[nRes];
+		if (nRes < TTS_RENDER_RES - 1)
+		{
+			pRender->_afInV[nRes] = fA * pRender->_fAV * RENDER_VOICE_GAIN;
+			pRender->_afInN[nRes] = fA * pRender->_fAH * RENDER_ASPIRATE_GAIN;
+		}
+		else
+		{
+			pRender->_afInV[nRes] = 0.0f;
+			pRender->_afInN[nRes] = fA * pRender->_fAF * RENDER_FRICATE_GAIN;
+		}
+	}
+}
+
+
+//the next noise sample, in [-1,1)
+static __inline float _noise(TTSRender* pRender)
+{
+	uint32_t n = pRender->_nNoise;
+	n ^= n << 13;
+	n ^= n >> 17;
+	n ^= n << 5;
+	pRender->_nNoise = n;
+	return (float)(int32_t)n * (1.0f / 2147483648.0f);
+}
+
+
+//the next pulse sample:  1 at the start of each pitch period
+static __inline float _pulse(TTSRender* pRender)
+{
+	float fPulse = (0 == pRender->_nPhase) ? 1.0f : 0.0f;
+	if (++pRender->_nPhase == pRender->_nPeriod)
+		pRender->_nPhase = 0;
+	return fPulse;
+}
+
+
+//from the sum of the resonators to a sample:  the radiation from the lips
+//(a first difference), and clipping
+static __inline int16_t _sample(TTSRender* pRender, float fY)
+{
+	float fOut = fY - pRender->_fPrev;
+	pRender->_fPrev = fY;
+	if (fOut > 32767.0f)
+		fOut = 32767.0f;
+	else if (fOut < -32768.0f)
+		fOut = -32768.0f;
+	return (int16_t)fOut;
+}
+
+
+//make nLen samples with the filter as it is
+#ifdef TTS_RENDER_SSE
+
+static void _renderRun(TTSRender* pRender, int16_t* pnOut, size_t nLen)
+{
+	__m128 vy1 = _mm_loadu_ps(pRender->_afY1);
+	__m128 vy2 = _mm_loadu_ps(pRender->_afY2);
+	__m128 vb = _mm_loadu_ps(pRender->_afB);
+	__m128 vc = _mm_loadu_ps(pRender->_afC);
+	__m128 vinv = _mm_loadu_ps(pRender->_afInV);
+	__m128 vinn = _mm_loadu_ps(pRender->_afInN);
+	__m128 vtiny = _mm_set1_ps(RENDER_TINY);
+	for (size_t nIdx = 0; nIdx < nLen; ++nIdx)
+	{
+		__m128 vx = _mm_add_ps(_mm_mul_ps(vinv, _mm_set1_ps(_pulse(pRender))),
+				_mm_add_ps(_mm_mul_ps(vinn, _mm_set1_ps(_noise(pRender))), vtiny));
+		__m128 vy = _mm_add_ps(vx, _mm_add_ps(_mm_mul_ps(vb, vy1), _mm_mul_ps(vc, vy2)));
+		vy2 = vy1;
+		vy1 = vy;
+		__m128 vsum = _mm_add_ps(vy, _mm_movehl_ps(vy, vy));
+		vsum = _mm_add_ss(vsum, _mm_shuffle_ps(vsum, vsum, 1));
+		pnOut[nIdx] = _sample(pRender, _mm_cvtss_f32(vsum));
+	}
+	_mm_storeu_ps(pRender->_afY1, vy1);
+	_mm_storeu_ps(pRender->_afY2, vy2);
+}
+
+#else
+
+static void _renderRun(TTSRender* pRender, int16_t* pnOut, size_t nLen)
+{
+	for (size_t nIdx = 0; nIdx < nLen; ++nIdx)
+	{
+		float fPulse = _pulse(pRender);
+		float fNoise = _noise(pRender);
+		float fSum = 0.0f;
+		for (int nRes = 0; nRes < TTS_RENDER_RES; ++nRes)
+		{
+			float fY = pRender->_afInV[nRes] * fPulse + pRender->_afInN[nRes] * fNoise + RENDER_TINY +
+					pRender->_afB[nRes] * pRender->_afY1[nRes] +
+					pRender->_afC[nRes] * pRender->_afY2[nRes];
+			pRender->_afY2[nRes] = pRender->_afY1[nRes];
+			pRender->_afY1[nRes] = fY;
+			fSum += fY;
+		}
+		pnOut[nIdx] = _sample(pRender, fSum);
+	}
+}
+
+#endif
+
+
+size_t ttsRender(TTSRender* pRender,
+		const uint8_t* pbyPhon, size_t nPhon,
+		int16_t* pnOut, size_t nOutLen,
+		size_t* pnConsumed)
+{
+	size_t nOut = 0;
+	size_t nIdx;
+	for (nIdx = 0; nIdx < nPhon; ++nIdx)
+	{
+		uint8_t byPhon = pbyPhon[nIdx];
+		if (byPhon >= SP0256_ALLOPHONES)
+			continue;	//(not an allophone; it makes nothing)
+		uint32_t nLen = (uint32_t)g_anSP0256DurMs[byPhon] * (TTS_RENDER_RATE / 1000);
+		while (pRender->_nDone < nLen && nOut < nOutLen)
+		{
+			uint32_t nInFrame = pRender->_nDone % TTS_RENDER_FRAME;
+			if (0 == nInFrame)
+				_setFrame(pRender, &g_aRenderPhon[byPhon], pRender->_nDone, nLen);
+			size_t nRun = TTS_RENDER_FRAME - nInFrame;
+			if (nRun > nOutLen - nOut)
+				nRun = nOutLen - nOut;
+			_renderRun(pRender, &pnOut[nOut], nRun);
+			nOut += nRun;
+			pRender->_nDone += (uint32_t)nRun;
+		}
+		if (pRender->_nDone < nLen)
+			break;	//no more room; carry on with this one next time
+		pRender->_nDone = 0;
+	}
+	*pnConsumed = nIdx;
+	return nOut;
+}
@@ -0,0 +1,83 @@
+
+
+
+#ifndef __TTS_RENDER_H
+#define __TTS_RENDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+//a software stand-in for the SP0256-AL2 (host only), to hear what the rules
+//say without the chip, or to render a corpus to audio on a build machine.
+//Like the chip, it makes 16-bit samples at 10kHz from a source (a pulse each
+//pitch period, or noise, or both) through a digital filter whose settings are
+//changed every few milliseconds, and each allophone lasts as long as it does
+//on the chip (g_anSP0256DurMs).  The chip's ROM data isn't reproduced; each
+//allophone is instead a pair of formant targets (start and end, for the
+//diphthongs and the stops), which the filter glides between.
+//The filter is four two-pole resonators side by side (three formants, and one
+//for frication), which run together in one SSE register, a sample at a time.
+//It streams, as ttsWord does:  the output can be any size, and an allophone
+//that doesn't fit is carried on with next time.
+
+
+//samples per second, as the chip
+#define TTS_RENDER_RATE	10000
+
+//samples per filter update (5ms); every allophone is a whole number of these
+#define TTS_RENDER_FRAME	50
+
+//the resonators:  three formants, and frication
+#define TTS_RENDER_RES	4
+
+
+typedef struct TTSRender
+{
+	float	_afY1[TTS_RENDER_RES];	//the resonators' last output
+	float	_afY2[TTS_RENDER_RES];	//and the one before
+	float	_afB[TTS_RENDER_RES];	//coefficients for this frame
+	float	_afC[TTS_RENDER_RES];
+	float	_afInV[TTS_RENDER_RES];	//how much of the pulse goes into each
+	float	_afInN[TTS_RENDER_RES];	//how much of the noise goes into each
+	float	_afFreq[TTS_RENDER_RES];	//the formants, as they glide (Hz)
+	float	_fAV;	//the amplitudes, likewise
+	float	_fAH;
+	float	_fAF;
+	float	_fPrev;	//last filter output (for the radiation)
+	uint32_t	_nNoise;	//noise generator
+	uint32_t	_nPeriod;	//samples per pitch period
+	uint32_t	_nPhase;	//samples into this pitch period
+	uint32_t	_nDone;	//samples of the first allophone given already made
+} TTSRender;
+
+
+//set up for a new stream.  nPitchHz is the voice's pitch, or 0 for the
+//default (about the chip's).
+void ttsRenderInit(TTSRender* pRender, unsigned int nPitchHz);
+
+
+//the number of samples that some phonemes make
+size_t ttsRenderLength(const uint8_t* pbyPhon, size_t nPhon);
+
+
+//render some phonemes into pnOut, which has room for nOutLen samples.
+//returns the number of samples placed there, and sets *pnConsumed to how many
+//of the phonemes were finished.  The rest should be given again (with more
+//after them, if there are any); the first of them may be partly done, which
+//is remembered.
+size_t ttsRender(TTSRender* pRender,
+		const uint8_t* pbyPhon, size_t nPhon,
+		int16_t* pnOut, size_t nOutLen,
+		size_t* pnConsumed);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,13 @@
 #include <stddef.h>
 
 
+//The tables can also be compiled as C++ constexpr, so that the compact blob can
+//be made from them at compile time (see tts_rules_compact_constexpr.h).
+#ifndef TTS_RULES_CONSTEXPR
+#define TTS_RULES_CONSTEXPR
+#endif
+
+
 //=========================================================================
 //Text2Speech rules
 
@@ -160,7 +167,7 @@ document "AD/A021 929".
 
 
 //0 - punctuation
-const TTSRule r_punc[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_punc[] = {
 	{ Anything,		" ",		Anything,		PHONESEQ( PA4 PA3 )},
 	{ Anything,		"-",		Anything,		PHONESEQ( PA4 ) },
 	{ ".",			"'s",		Anything,		PHONESEQ( ZZ ) },
@@ -182,7 +189,7 @@ const TTSRule r_punc[] = {
 
 
 //1 - a
-const TTSRule r_a[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_a[] = {
 	{ Nothing,		"a",		Nothing,		PHONESEQ( EH EY ) },
 	{ Anything,		"ahead",	Anything,		PHONESEQ( AX HH1 EH EH DD1 ) },
 	{ Anything,		"apropos",	Anything,		PHONESEQ( AE PP ER1 OW PP OW ) },
@@ -259,7 +266,7 @@ const TTSRule r_a[] = {
 };
 
 //2 - b
-const TTSRule r_b[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_b[] = {
 	{ "b",			"b",		Anything,		Silent },
 	{ Anything,		"bi",		"cycle",		PHONESEQ( BB2 AY ) },
 	{ Anything,		"bi",		"cycle",		PHONESEQ( BB2 AY ) },
@@ -298,7 +305,7 @@ const TTSRule r_b[] = {
 };
 
 //3 - c
-const TTSRule r_c[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_c[] = {
 	{ Anything,		"chinese",	Anything,		PHONESEQ( CH AY NN1 IY SS ) },
 	{ Anything,		"country",	Anything,		PHONESEQ( KK1 AX AX NN1 TT2 ER1 IY ) },
 	{ Anything,		"christ",	Nothing,		PHONESEQ( KK3 ER1 AY SS TT2 ) },
@@ -347,7 +354,7 @@ const TTSRule r_c[] = {
 };
 
 //4 - d
-const TTSRule r_d[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_d[] = {
 	{ Anything,		"dead",		Anything,		PHONESEQ( DD2 EH EH DD1 ) },
 	{ Nothing,		"dogged",	Anything,		PHONESEQ( DD2 AO GG1 PA1 EH DD1 ) },
 	{ "#:",			"ded",		Nothing,		PHONESEQ( DD2 IH DD1 ) },
@@ -370,7 +377,7 @@ const TTSRule r_d[] = {
 };
 
 //5 - e
-const TTSRule r_e[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_e[] = {
 	{ Nothing,		"eye",		Anything,		PHONESEQ( AA AY ) },
 	{ Anything,		"ered",		Nothing,		PHONESEQ( ER2 DD1 ) },
 	{ Nothing,		"ego",		Anything,		PHONESEQ( IY GG1 OW ) },
@@ -451,7 +458,7 @@ const TTSRule r_e[] = {
 };
 
 //6 - f
-const TTSRule r_f[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_f[] = {
 	{ Anything,		"fnord",	Anything,		PHONESEQ( FF NN1 AO OR DD1 ) },
 	{ Anything,		"four",		Anything,		PHONESEQ( FF OW ER1 ) },
 	{ Anything,		"ful",		Anything,		PHONESEQ( PA1 FF UH LL ) },
@@ -465,7 +472,7 @@ const TTSRule r_f[] = {
 };
 
 //7 - g
-const TTSRule r_g[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_g[] = {
 	{ Anything,		"gadget",	Anything,		PHONESEQ( GG2 AE AE DD1 PA2 JH EH EH TT2 ) },
 	{ Anything,		"god",		Anything,		PHONESEQ( GG3 AA AA DD1 ) },
 	{ Anything,		"get",		Anything,		PHONESEQ( GG3 EH EH TT2 ) },
@@ -510,7 +517,7 @@ const TTSRule r_g[] = {
 };
 
 //8 - h
-const TTSRule r_h[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_h[] = {
 	{ Anything,		"honor",	Anything,		PHONESEQ( AO NN1 ER2 ) },
 	{ Anything,		"heard",	Anything,		PHONESEQ( HH1 ER2 DD1 ) },
 	{ Anything,		"height",	Anything,		PHONESEQ( HH1 AY TT2 ) },
@@ -540,7 +547,7 @@ const TTSRule r_h[] = {
 };
 
 //9 - i
-const TTSRule r_i[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_i[] = {
 	{ Nothing,		"i",		Nothing,		PHONESEQ( AO AY ) },
 	{ Nothing,		"ii",		Nothing,		PHONESEQ( TT2 UW2 ) },
 	{ Nothing,		"iii",		Nothing,		PHONESEQ( TH ER1 IY ) },
@@ -623,7 +630,7 @@ const TTSRule r_i[] = {
 };
 
 //10 - j
-const TTSRule r_j[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_j[] = {
 	{ Anything,		"japanese",	Anything,		PHONESEQ( JH AX PP AE AE NN1 IY SS SS ) },
 	{ Anything,		"japan",	Anything,		PHONESEQ( JH AX PP AE AE NN1 ) },
 	{ Anything,		"july",		Anything,		PHONESEQ( JH UW2 LL AE AY ) },
@@ -633,7 +640,7 @@ const TTSRule r_j[] = {
 };
 
 //11 - k
-const TTSRule r_k[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_k[] = {
 	{ Nothing,		"k",		"n",			Silent },
 
 	{ Anything,		"k",		"u",			PHONESEQ( KK3 ) },
@@ -653,7 +660,7 @@ const TTSRule r_k[] = {
 };
 
 //12 - l
-const TTSRule r_l[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_l[] = {
 	{ "l",			"l",		Anything,		Silent },
 	{ Nothing,		"lion",		Anything,		PHONESEQ( LL AY AX NN1 ) },
 	{ Anything,		"lead",		Anything,		PHONESEQ( LL IY DD1 ) },
@@ -673,7 +680,7 @@ const TTSRule r_l[] = {
 };
 
 //13 - m
-const TTSRule r_m[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_m[] = {
 	{ "m",			"m",		Anything,		Silent },
 	{ Nothing,		"my",		Nothing,		PHONESEQ( MM AY ) },
 	{ Nothing,		"mary",		Nothing,		PHONESEQ( MM EY XR IY ) },
@@ -691,7 +698,7 @@ const TTSRule r_m[] = {
 };
 
 //14 - n
-const TTSRule r_n[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_n[] = {
 	{ "n",			"n",		Anything,		Silent },
 	{ Nothing,		"now",		Nothing,		PHONESEQ( NN1 AW ) },
 	{ "#",			"ng",		"+",			PHONESEQ( NN1 JH ) },
@@ -713,7 +720,7 @@ const TTSRule r_n[] = {
 };
 
 //15 - o
-const TTSRule r_o[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_o[] = {
 	{ Nothing,		"only",		Anything,		PHONESEQ( OW NN1 LL IY ) },
 	{ Nothing,		"once",		Anything,		PHONESEQ( WW AH NN1 SS ) },
 	{ Nothing,		"oh",		Nothing,		PHONESEQ( OW ) },
@@ -801,7 +808,7 @@ const TTSRule r_o[] = {
 };
 
 //16 - p
-const TTSRule r_p[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_p[] = {
 	{ Nothing,		"pi",		Nothing,		PHONESEQ( PP AY ) },
 	{ Anything,		"put",		Nothing,		PHONESEQ( PP UH TT2 ) },
 	{ Anything,		"prove",	Anything,		PHONESEQ( PP ER1 UW2 VV ) },
@@ -817,7 +824,7 @@ const TTSRule r_p[] = {
 };
 
 //17 - q
-const TTSRule r_q[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_q[] = {
 	{ Anything,		"quar",		Anything,		PHONESEQ( KK3 WW AO ER1 ) },
 	{ Anything,		"que",		Nothing,		PHONESEQ( KK2 ) },
 	{ Anything,		"que",		"s",			PHONESEQ( KK2 ) },
@@ -827,7 +834,7 @@ const TTSRule r_q[] = {
 };
 
 //18 - r
-const TTSRule r_r[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_r[] = {
 	{ Nothing,		"rugged",	Anything,		PHONESEQ( ER1 AX GG1 PA1 EH DD1 ) },
 	{ Nothing,		"russia",	Anything,		PHONESEQ( ER1 AX SH PA1 AX ) },
 	{ Nothing,		"reality",	Anything,		PHONESEQ( ER1 IY AE LL IH TT2 IY ) },
@@ -843,7 +850,7 @@ const TTSRule r_r[] = {
 };
 
 //19 - s
-const TTSRule r_s[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_s[] = {
 	{ Anything,		"said",		Anything,		PHONESEQ( SS EH DD1 ) },
 	{ Anything,		"secret",	Anything,		PHONESEQ( SS IY KK1 ER1 EH TT2 ) },
 	{ Nothing,		"sly",		Anything,		PHONESEQ( SS LL AY ) },
@@ -879,7 +886,7 @@ const TTSRule r_s[] = {
 };
 
 //20 - t
-const TTSRule r_t[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_t[] = {
 	{ Nothing,		"the",		Nothing,		PHONESEQ( DH1 IY ) },
 	{ Nothing,		"this",		Nothing,		PHONESEQ( DH2 IH IH SS SS ) },
 	{ Nothing,		"than",		Nothing,		PHONESEQ( DH2 AE AE NN1 ) },
@@ -932,7 +939,7 @@ const TTSRule r_t[] = {
 };
 
 //21 - u
-const TTSRule r_u[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_u[] = {
 	{ Nothing,		"un",		Nothing,		PHONESEQ( YY2 UW2 PA3 AE NN1 ) },
 	{ Nothing,		"usa",		Nothing,		PHONESEQ( YY2 UW2 PA3 AE SS SS PA3 EH EY ) },
 	{ Nothing,		"ussr",		Nothing,		PHONESEQ( YY2 UW2 PA3 AE SS SS PA3 AE SS SS PA3 AA AR ) },
@@ -989,7 +996,7 @@ const TTSRule r_u[] = {
 };
 
 //22 - v
-const TTSRule r_v[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_v[] = {
 	{ Anything,		"view",		Anything,		PHONESEQ( VV YY2 UW2 ) },
 	{ Nothing,		"very",		Nothing,		PHONESEQ( VV EH ER2 PA1 IY ) },
 	{ Anything,		"vary",		Anything,		PHONESEQ( VV EY PA1 ER1 IY ) },
@@ -998,7 +1005,7 @@ const TTSRule r_v[] = {
 };
 
 //23 - w
-const TTSRule r_w[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_w[] = {
 	{ Nothing,		"were",		Anything,		PHONESEQ( WW ER2 ) },
 	{ Anything,		"weigh",	Anything,		PHONESEQ( WW EH EY ) },
 	{ Anything,		"wood",		Anything,		PHONESEQ( WW UH UH DD1 ) },
@@ -1030,13 +1037,13 @@ const TTSRule r_w[] = {
 };
 
 //24 - x
-const TTSRule r_x[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_x[] = {
 	{ Anything,		"x",		Anything,		PHONESEQ( KK1 SS ) },
 	{ NULL, NULL, NULL, { NULL, 0 } },	//sentinel
 };
 
 //25 - y
-const TTSRule r_y[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_y[] = {
 	{ Anything,		"young",	Anything,		PHONESEQ( YY2 AH NG ) },
 	{ Nothing,		"your",		Anything,		PHONESEQ( YY2 UH ER2 ) },
 	{ Nothing,		"you",		Anything,		PHONESEQ( YY2 UW2 ) },
@@ -1064,7 +1071,7 @@ const TTSRule r_y[] = {
 };
 
 //26 - z
-const TTSRule r_z[] = {
+TTS_RULES_CONSTEXPR const TTSRule r_z[] = {
 	{ "z",			"z",		Anything,		Silent },
 	{ Anything,		"z",		Anything,		PHONESEQ( ZZ ) },
 	{ NULL, NULL, NULL, { NULL, 0 } },	//sentinel
@@ -1072,7 +1079,7 @@ const TTSRule r_z[] = {
 
 
 
-const TTSRule* _rules[27] = {
+TTS_RULES_CONSTEXPR const TTSRule* _rules[27] = {
 	r_punc,
 	r_a, r_b, r_c, r_d, r_e, r_f, r_g, r_h,
 	r_i, r_j, r_k, r_l, r_m, r_n, r_o, r_p,
@@ -1082,4 +1089,76 @@ const TTSRule* _rules[27] = {
 
 
 
+//the phoneme names are just for writing the rules; keep them from leaking into
+//anything that includes this
+#undef Silent
+#undef PA1
+#undef PA2
+#undef PA3
+#undef PA4
+#undef PA5
+#undef OY
+#undef AY
+#undef EH
+#undef KK3
+#undef PP
+#undef JH
+#undef NN1
+#undef IH
+#undef TT2
+#undef RR1
+#undef AX
+#undef AH
+#undef MM
+#undef TT1
+#undef DH1
+#undef IY
+#undef EY
+#undef DD1
+#undef UW1
+#undef AO
+#undef AA
+#undef YY2
+#undef AE
+#undef HH1
+#undef BB1
+#undef TH
+#undef UH
+#undef UW2
+#undef AW
+#undef DD2
+#undef GG3
+#undef VV
+#undef GG1
+#undef SH
+#undef ZH
+#undef RR2
+#undef FF
+#undef KK2
+#undef KK1
+#undef ZZ
+#undef NG
+#undef LL
+#undef WW
+#undef XR
+#undef WH
+#undef YY1
+#undef CH
+#undef ER1
+#undef ER2
+#undef OW
+#undef DH2
+#undef SS
+#undef NN2
+#undef HH2
+#undef OR
+#undef AR
+#undef YR
+#undef GG2
+#undef EL
+#undef BB2
+#undef PHONESEQ
+
+
+
 
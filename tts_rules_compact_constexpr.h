@@ -0,0 +1,32 @@
+#ifndef __TTS_RULES_COMPACT_CONSTEXPR_H
+#define __TTS_RULES_COMPACT_CONSTEXPR_H
+
+//The compact rules blob, g_abyTTS, made at compile time (C++20) straight from
+//tts_rules.c, rather than generated by text2speech001 into
+//tts_rules_compact.h/.c.  So there is no generator step, and the blob can't be
+//stale.  It is a constant, so it goes in read-only data, with nothing to do
+//at run time.  Use g_abyTTS.data() where the blob is wanted, e.g.
+//	ttsWord(pszWord, nLen, g_abyTTS.data(), abyPhon, sizeof(abyPhon));
+//Include this in just the one translation unit that would have had
+//tts_rules_compact.c (and don't link that, or tts_rules.c, as well).
+
+#include "make_compact_ruleset_constexpr.h"
+
+
+//the rule tables, as constexpr
+namespace tts_rules_constexpr
+{
+#define TTS_RULES_CONSTEXPR constexpr
+#include "tts_rules.c"
+#undef TTS_RULES_CONSTEXPR
+}
+
+
+alignas(uint32_t) constexpr std::array<uint8_t,
+		mcr_constexpr::ruleset_blob_size(tts_rules_constexpr::_rules)> g_abyTTS =
+		mcr_constexpr::make_ruleset_blob<
+				mcr_constexpr::ruleset_blob_size(tts_rules_constexpr::_rules)>(
+				tts_rules_constexpr::_rules);
+
+
+#endif
@@ -0,0 +1,140 @@
+#include "tts_stats.h"
+#include "text_to_speech.h"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+
+
+#ifdef TTS_STATS
+
+//the per-rule counts that g_ttsStats points at
+static std::vector<uint32_t> g_anRuleHits;
+
+
+//the text of a rule, e.g. "#:[e]d"
+std::string ruleText(const uint8_t* pbyTTSRulesBlob, int nIdxRuleSect, int nIdxRule)
+{
+	TTSRule_compact rule;
+	_reconstitute_rule(pbyTTSRulesBlob, nIdxRuleSect, nIdxRule, &rule);
+	return std::string((const char*)rule._left, rule._nLeft) + "[" +
+			std::string((const char*)rule._bracket, rule._nBracket) + "]" +
+			std::string((const char*)rule._right, rule._nRight);
+}
+
+
+//the section's name; its letter, or 'punc'
+std::string sectName(int nIdxRuleSect)
+{
+	return (0 == nIdxRuleSect) ? std::string("punc") : std::string(1, (char)('a' + nIdxRuleSect - 1));
+}
+
+
+//JSON (and our CSV) string quoting
+std::string quoted(const std::string& str, char chEscape)
+{
+	std::string strRet("\"");
+	for (char ch : str)
+	{
+		if ('"' == ch || ('\\' == ch && '\\' == chEscape))
+			strRet += chEscape;
+		strRet += ch;
+	}
+	return strRet + "\"";
+}
+
+
+
+void ttsStatsWriteCSV(std::ostream& os, const uint8_t* pbyTTSRulesBlob)
+{
+	os << "kind,section,rule,text,count,probes" << std::endl;
+	int nIdxRuleAll = 0;
+	for (int nIdxRuleSect = 0; nIdxRuleSect < 27; ++nIdxRuleSect)
+	{
+		os << "section," << sectName(nIdxRuleSect) << ",,," <<
+				g_ttsStats._anSectCalls[nIdxRuleSect] << "," <<
+				g_ttsStats._anSectProbes[nIdxRuleSect] << std::endl;
+		int nRuleSecLen = _getRuleSectionLength(pbyTTSRulesBlob, nIdxRuleSect);
+		for (int nIdxRule = 0; nIdxRule < nRuleSecLen; ++nIdxRule, ++nIdxRuleAll)
+		{
+			if ((uint32_t)nIdxRuleAll >= g_ttsStats._nRuleHits)
+				break;
+			os << "rule," << sectName(nIdxRuleSect) << "," << nIdxRule << "," <<
+					quoted(ruleText(pbyTTSRulesBlob, nIdxRuleSect, nIdxRule), '"') << "," <<
+					g_ttsStats._anRuleHits[nIdxRuleAll] << "," << std::endl;
+		}
+	}
+	for (int nIdxHist = 0; nIdxHist < TTS_STATS_MAXPROBES; ++nIdxHist)
+	{
+		os << "probehist,,," << nIdxHist << "," << g_ttsStats._anProbeHist[nIdxHist] << "," << std::endl;
+	}
+	//(nonzero if rules are missing above; their hits are only totalled)
+	os << "lost,,,," << g_ttsStats._nRuleHitsLost << "," << std::endl;
+}
+
+
+
+void ttsStatsWriteJSON(std::ostream& os, const uint8_t* pbyTTSRulesBlob)
+{
+	os << "{" << std::endl << "\"sections\": {" << std::endl;
+	int nIdxRuleAll = 0;
+	for (int nIdxRuleSect = 0; nIdxRuleSect < 27; ++nIdxRuleSect)
+	{
+		os << "  " << quoted(sectName(nIdxRuleSect), '\\') << ": { \"lookups\": " <<
+				g_ttsStats._anSectCalls[nIdxRuleSect] << ", \"probes\": " <<
+				g_ttsStats._anSectProbes[nIdxRuleSect] << ", \"rules\": [";
+		int nRuleSecLen = _getRuleSectionLength(pbyTTSRulesBlob, nIdxRuleSect);
+		for (int nIdxRule = 0; nIdxRule < nRuleSecLen; ++nIdxRule, ++nIdxRuleAll)
+		{
+			if ((uint32_t)nIdxRuleAll >= g_ttsStats._nRuleHits)
+				break;
+			os << (0 == nIdxRule ? "" : ",") << std::endl << "    { \"index\": " << nIdxRule <<
+					", \"text\": " << quoted(ruleText(pbyTTSRulesBlob, nIdxRuleSect, nIdxRule), '\\') <<
+					", \"hits\": " << g_ttsStats._anRuleHits[nIdxRuleAll] << " }";
+		}
+		os << " ] }" << (26 == nIdxRuleSect ? "" : ",") << std::endl;
+	}
+	os << "}," << std::endl << "\"probehist\": [";
+	for (int nIdxHist = 0; nIdxHist < TTS_STATS_MAXPROBES; ++nIdxHist)
+	{
+		os << (0 == nIdxHist ? "" : ", ") << g_ttsStats._anProbeHist[nIdxHist];
+	}
+	os << "]," << std::endl << "\"lost\": " << g_ttsStats._nRuleHitsLost << std::endl << "}" << std::endl;
+}
+
+
+
+void ttsStatsReset(const uint8_t* pbyTTSRulesBlob)
+{
+	if (NULL != pbyTTSRulesBlob)
+	{
+		g_anRuleHits.resize(_getRuleIndexAll(pbyTTSRulesBlob, 26, 0) +
+				_getRuleSectionLength(pbyTTSRulesBlob, 26));
+	}
+	std::fill(g_anRuleHits.begin(), g_anRuleHits.end(), 0);
+	memset(&g_ttsStats, 0, sizeof(g_ttsStats));
+	g_ttsStats._anRuleHits = g_anRuleHits.data();
+	g_ttsStats._nRuleHits = (uint32_t)g_anRuleHits.size();
+}
+
+
+#else
+
+
+void ttsStatsWriteCSV(std::ostream& os, const uint8_t* /*pbyTTSRulesBlob*/)
+{
+	os << "# not built with TTS_STATS" << std::endl;
+}
+
+void ttsStatsWriteJSON(std::ostream& os, const uint8_t* /*pbyTTSRulesBlob*/)
+{
+	os << "{}" << std::endl;
+}
+
+void ttsStatsReset(const uint8_t* /*pbyTTSRulesBlob*/)
+{
+}
+
+
+#endif
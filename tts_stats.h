@@ -0,0 +1,20 @@
+#ifndef __TTS_STATS_H
+#define __TTS_STATS_H
+
+#include <stdint.h>
+#include <ostream>
+
+//write out what the engine counted (see TTS_STATS in text_to_speech.h).
+//Rules are keyed by section and index in section, and their text is recovered
+//from the blob as 'left[bracket]right'.  The blob must be the one that was
+//used while counting.  These do nothing useful unless built with TTS_STATS.
+
+void ttsStatsWriteCSV(std::ostream& os, const uint8_t* pbyTTSRulesBlob);
+void ttsStatsWriteJSON(std::ostream& os, const uint8_t* pbyTTSRulesBlob);
+
+//zero the counters, and make room to count every rule of the blob given (or
+//keep the room there is, for NULL)
+void ttsStatsReset(const uint8_t* pbyTTSRulesBlob);
+
+
+#endif